@@ -0,0 +1,742 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Times the parts of Scene Lab whose speed depends on the size of the scene:
+// saving, the FlatBuffer editor, struct parsing, asset directory scanning and
+// picking. Scenes are made up with MemoryAdapter, and Scene Lab runs
+// headless, so no window or GPU is needed. Run it from a scratch directory:
+// it writes entity files and temporary directories into the current one.
+//
+// Usage:
+//   scene_lab_benchmarks [--filter TEXT] [--min_time SECONDS] [--threads N]
+//                        [--include DIR]... [--template FILE] [--json FILE]
+//                        [BINARY_SCHEMA [TEXT_SCHEMA]]
+//
+// BINARY_SCHEMA (.bfbs) and TEXT_SCHEMA (.fbs) describe your entity files,
+// laid out as MemoryAdapter expects, e.g. the sample's components schema.
+// Without BINARY_SCHEMA only the benchmarks that don't need entities are
+// run, and without TEXT_SCHEMA saving doesn't export JSON. --include adds a
+// directory to search for files the text schema includes.
+//
+// --template is an entity file from your game for the SaveScene benchmarks'
+// entities to copy their component data from (see
+// MemoryAdapter::LoadComponentTemplatesFromMemory()). Without it, every
+// component has all its fields at their defaults, so the timings will be
+// far lower than saving a real scene of the same size.
+//
+// Only benchmarks whose names contain --filter are run. Each is run for at
+// least --min_time seconds (default 0.5). --threads sets how many worker
+// threads SaveScene() uses (default 0). --json writes the results in the
+// same layout as Google Benchmark's JSON output, so runs from different
+// releases can be compared with its tools.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "flatbuffers/flatbuffers.h"
+#include "flatbuffers/reflection.h"
+#include "flatbuffers/util.h"
+#include "scene_lab/editor_controller.h"
+#include "scene_lab/editor_input.h"
+#include "scene_lab/flatbuffer_editor.h"
+#include "scene_lab/memory/memory_adapter.h"
+#include "scene_lab/scene_lab.h"
+#include "scene_lab/util.h"
+#include "scene_lab_config_generated.h"
+#if defined(_MSC_VER)
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif  // defined(_MSC_VER)
+
+using scene_lab::EditorController;
+using scene_lab::FlatbufferEditor;
+using scene_lab::GenericCamera;
+using scene_lab::GenericEntityId;
+using scene_lab::GenericTransform;
+using scene_lab::SceneLab;
+using scene_lab::ScriptedEditorInput;
+using scene_lab::ViewportSettings;
+using scene_lab_memory::MemoryAdapter;
+
+namespace scene_lab {
+
+// Forwards to the private helpers being timed. SceneLab and FlatbufferEditor
+// declare this class a friend.
+class BenchmarkAccess {
+ public:
+  static bool IntersectRayToPlane(const mathfu::vec3& ray_origin,
+                                  const mathfu::vec3& ray_direction,
+                                  const mathfu::vec3& point_on_plane,
+                                  const mathfu::vec3& plane_normal,
+                                  mathfu::vec3* intersection_point) {
+    return SceneLab::IntersectRayToPlane(ray_origin, ray_direction,
+                                         point_on_plane, plane_normal,
+                                         intersection_point);
+  }
+  static std::string StructToString(const reflection::Schema& schema,
+                                    const reflection::Object& objectdef,
+                                    const flatbuffers::Struct& struct_ptr,
+                                    bool field_names_only) {
+    return FlatbufferEditor::StructToString(schema, objectdef, struct_ptr,
+                                            field_names_only);
+  }
+  static bool ParseStringIntoStruct(const std::string& string,
+                                    const reflection::Schema& schema,
+                                    const reflection::Object& objectdef,
+                                    flatbuffers::Struct* struct_ptr) {
+    return FlatbufferEditor::ParseStringIntoStruct(string, schema, objectdef,
+                                                   struct_ptr);
+  }
+};
+
+}  // namespace scene_lab
+
+using scene_lab::BenchmarkAccess;
+
+// Scene sizes to save, as files x entities.
+static const size_t kSaveSceneSizes[][2] = {
+    {1, 1000}, {10, 1000}, {10, 10000}, {100, 10000}};
+// Entities in the tables given to the FlatBuffer editor, and in the scenes
+// picked from.
+static const size_t kTableSizes[] = {100, 1000, 10000};
+// Files in each directory scanned.
+static const size_t kDirectorySizes[] = {100, 1000, 10000};
+// Screen points per ray casting iteration, on each axis.
+static const int kRayGridSize = 64;
+// Structs converted per string conversion iteration.
+static const int kStructConversions = 1000;
+// Stop timing a benchmark after this many iterations, however fast it is.
+static const size_t kMaxIterations = 1000000;
+
+// Saved entity files get this extension, as the config doesn't set one.
+static const char kBinaryEntityFileExtension[] = "bin";
+
+// Results are added to this, so the compiler can't skip the work.
+static volatile double g_sink;
+
+static void PrintUsage(const char* program) {
+  fprintf(stderr,
+          "Usage: %s [--filter TEXT] [--min_time SECONDS] [--threads N] "
+          "[--include DIR]... [--template FILE] [--json FILE] "
+          "[BINARY_SCHEMA [TEXT_SCHEMA]]\n",
+          program);
+}
+
+struct BenchmarkResult {
+  std::string name;
+  size_t iterations;
+  double mean_ns;
+  double min_ns;
+  double max_ns;
+  double cpu_ns;
+  double items_per_second;
+};
+
+// Runs each benchmark repeatedly and collects its timings.
+class BenchmarkRunner {
+ public:
+  BenchmarkRunner(const std::string& filter, double min_seconds)
+      : filter_(filter), min_seconds_(min_seconds) {}
+
+  // Should this benchmark be run?
+  bool Enabled(const std::string& name) const {
+    return name.find(filter_) != std::string::npos;
+  }
+
+  // Time `body`, which processes `items` items each time it's called. If
+  // `setup` isn't empty, it's called untimed before each call to `body`. One
+  // untimed call is made first, to warm up caches and create files.
+  void Run(const std::string& name, double items,
+           const std::function<void()>& setup,
+           const std::function<void()>& body);
+
+  const std::vector<BenchmarkResult>& results() const { return results_; }
+
+  // Write the results to a JSON file. Returns true on success.
+  bool WriteJson(const std::string& filename, const char* executable) const;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  std::string filter_;
+  double min_seconds_;
+  std::vector<BenchmarkResult> results_;
+};
+
+void BenchmarkRunner::Run(const std::string& name, double items,
+                          const std::function<void()>& setup,
+                          const std::function<void()>& body) {
+  if (!Enabled(name)) return;
+  if (setup) setup();
+  body();
+
+  BenchmarkResult result;
+  result.name = name;
+  result.iterations = 0;
+  result.min_ns = 0;
+  result.max_ns = 0;
+  double total_ns = 0;
+  clock_t cpu_ticks = 0;
+  do {
+    if (setup) setup();
+    clock_t cpu_start = clock();
+    Clock::time_point start = Clock::now();
+    body();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start)
+                    .count();
+    cpu_ticks += clock() - cpu_start;
+    if (result.iterations == 0 || ns < result.min_ns) result.min_ns = ns;
+    if (result.iterations == 0 || ns > result.max_ns) result.max_ns = ns;
+    total_ns += ns;
+    result.iterations++;
+  } while (total_ns < min_seconds_ * 1e9 && result.iterations < kMaxIterations);
+
+  result.mean_ns = total_ns / result.iterations;
+  result.cpu_ns =
+      1e9 * cpu_ticks / CLOCKS_PER_SEC / static_cast<double>(result.iterations);
+  result.items_per_second =
+      result.mean_ns > 0 ? items * 1e9 / result.mean_ns : 0;
+  results_.push_back(result);
+  printf("%-56s %10.0f ns %10.0f ns %8d %12.0f items/s\n", name.c_str(),
+         result.mean_ns, result.cpu_ns, static_cast<int>(result.iterations),
+         result.items_per_second);
+  fflush(stdout);
+}
+
+bool BenchmarkRunner::WriteJson(const std::string& filename,
+                                const char* executable) const {
+  FILE* file = fopen(filename.c_str(), "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Couldn't open '%s' for writing.\n", filename.c_str());
+    return false;
+  }
+  char date[64] = "";
+  time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&now));
+#if defined(NDEBUG)
+  const char* build_type = "release";
+#else
+  const char* build_type = "debug";
+#endif  // defined(NDEBUG)
+  // Benchmark names and the executable path can't contain anything that
+  // needs escaping in JSON, other than backslashes in Windows paths.
+  std::string executable_json(executable);
+  for (size_t i = 0; i < executable_json.length(); i++) {
+    if (executable_json[i] == '\\') executable_json.insert(i++, 1, '\\');
+  }
+  fprintf(file,
+          "{\n"
+          "  \"context\": {\n"
+          "    \"date\": \"%s\",\n"
+          "    \"executable\": \"%s\",\n"
+          "    \"num_cpus\": %u,\n"
+          "    \"library_build_type\": \"%s\"\n"
+          "  },\n"
+          "  \"benchmarks\": [",
+          date, executable_json.c_str(), std::thread::hardware_concurrency(),
+          build_type);
+  for (size_t i = 0; i < results_.size(); i++) {
+    const BenchmarkResult& result = results_[i];
+    fprintf(file,
+            "%s\n"
+            "    {\n"
+            "      \"name\": \"%s\",\n"
+            "      \"iterations\": %d,\n"
+            "      \"real_time\": %.1f,\n"
+            "      \"cpu_time\": %.1f,\n"
+            "      \"min_real_time\": %.1f,\n"
+            "      \"max_real_time\": %.1f,\n"
+            "      \"time_unit\": \"ns\",\n"
+            "      \"items_per_second\": %.1f\n"
+            "    }",
+            i == 0 ? "" : ",", result.name.c_str(),
+            static_cast<int>(result.iterations), result.mean_ns, result.cpu_ns,
+            result.min_ns, result.max_ns, result.items_per_second);
+  }
+  fprintf(file, "\n  ]\n}\n");
+  bool success = ferror(file) == 0;
+  if (fclose(file) != 0) success = false;
+  if (!success) fprintf(stderr, "Couldn't write '%s'.\n", filename.c_str());
+  return success;
+}
+
+static std::string SizeName(const char* label, size_t size) {
+  return std::string(label) + ":" + flatbuffers::NumToString(size);
+}
+
+// A MemoryAdapter holding a made up scene of `entity_count` entities, whose
+// components are copied from those in the entity list `component_templates`
+// if it's not empty.
+static std::unique_ptr<MemoryAdapter> CreateAdapter(
+    const std::string& binary_schema, const std::string& text_schema,
+    const std::string& component_templates, size_t file_count,
+    size_t entity_count, std::vector<GenericEntityId>* ids_out) {
+  std::unique_ptr<MemoryAdapter> adapter(new MemoryAdapter());
+  MemoryAdapter::SceneOptions options;
+  options.file_count = file_count;
+  options.entity_count = entity_count;
+  if (!adapter->SetSchema(binary_schema, text_schema)) return nullptr;
+  const uint8_t* templates =
+      reinterpret_cast<const uint8_t*>(component_templates.c_str());
+  if (!component_templates.empty() &&
+      adapter->LoadComponentTemplatesFromMemory(
+          templates, component_templates.size()) == 0) {
+    fprintf(stderr, "No components found in the template file.\n");
+    return nullptr;
+  }
+  if (!adapter->CreateScene(options, ids_out)) return nullptr;
+  return adapter;
+}
+
+// Build a SceneLabConfig in `fbb` for saving with `threads` worker threads.
+static const scene_lab::SceneLabConfig* CreateConfig(
+    const std::string& text_schema_file,
+    const std::vector<std::string>& include_paths, int threads, bool json,
+    flatbuffers::FlatBufferBuilder* fbb) {
+  auto schema_file_text = fbb->CreateString(text_schema_file);
+  std::vector<flatbuffers::Offset<flatbuffers::String>> includes;
+  for (size_t i = 0; i < include_paths.size(); i++) {
+    includes.push_back(fbb->CreateString(include_paths[i]));
+  }
+  auto schema_include_paths = fbb->CreateVector(includes);
+  scene_lab::SceneLabConfigBuilder builder(*fbb);
+  builder.add_schema_file_text(schema_file_text);
+  builder.add_schema_include_paths(schema_include_paths);
+  builder.add_viewport_angle_degrees(45.0f);
+  builder.add_save_worker_threads(threads);
+  builder.add_export_json_on_save(json);
+  fbb->Finish(builder.Finish());
+  return scene_lab::GetSceneLabConfig(fbb->GetBufferPointer());
+}
+
+// Save N files x M entities, both after every entity has been edited and
+// with nothing changed, which only serializes and compares with what's on
+// disk.
+static void BenchmarkSaveScene(BenchmarkRunner* runner,
+                               const std::string& binary_schema,
+                               const std::string& text_schema,
+                               const std::string& text_schema_file,
+                               const std::vector<std::string>& include_paths,
+                               const std::string& component_templates,
+                               int threads) {
+  bool json = !text_schema.empty();
+  for (size_t i = 0;
+       i < sizeof(kSaveSceneSizes) / sizeof(kSaveSceneSizes[0]); i++) {
+    size_t file_count = kSaveSceneSizes[i][0];
+    size_t entity_count = kSaveSceneSizes[i][1];
+    std::string prefix =
+        "SaveScene/" + SizeName("files", file_count) + "/" +
+        SizeName("entities", entity_count) + "/" +
+        SizeName("threads", static_cast<size_t>(threads)) + "/";
+    std::string edited = prefix + (json ? "edited_json" : "edited");
+    std::string unchanged = prefix + (json ? "unchanged_json" : "unchanged");
+    std::string cache = prefix + "cache";
+    if (!runner->Enabled(edited) && !runner->Enabled(unchanged) &&
+        !runner->Enabled(cache)) {
+      continue;
+    }
+
+    std::vector<GenericEntityId> ids;
+    std::unique_ptr<MemoryAdapter> adapter =
+        CreateAdapter(binary_schema, text_schema, component_templates,
+                      file_count, entity_count, &ids);
+    if (adapter == nullptr) return;
+    MemoryAdapter* entities = adapter.get();
+    flatbuffers::FlatBufferBuilder fbb;
+    const scene_lab::SceneLabConfig* config =
+        CreateConfig(text_schema_file, include_paths, threads, json, &fbb);
+    std::unique_ptr<SceneLab> scene_lab(new SceneLab());
+    scene_lab->InitializeHeadless(
+        config, std::unique_ptr<scene_lab::EditorInput>(
+                    new ScriptedEditorInput()));
+    scene_lab->SetEntitySystemAdapter(std::move(adapter));
+    SceneLab* lab = scene_lab.get();
+
+    // Move every entity a little, so every file has to be written again.
+    float offset = 0.01f;
+    auto edit_all = [entities, lab, &ids, &offset]() {
+      offset = -offset;
+      for (auto id = ids.begin(); id != ids.end(); ++id) {
+        GenericTransform transform;
+        entities->GetEntityTransform(*id, &transform);
+        transform.position.x += offset;
+        entities->SetEntityTransform(*id, transform);
+      }
+      lab->MarkAllFilesModified();
+    };
+    auto mark_all = [lab]() { lab->MarkAllFilesModified(); };
+    double items = static_cast<double>(entity_count);
+    runner->Run(edited, items, edit_all, [lab]() { lab->SaveScene(true); });
+    runner->Run(unchanged, items, mark_all, [lab]() { lab->SaveScene(true); });
+    runner->Run(cache, items, edit_all, [lab]() { lab->SaveScene(false); });
+    if (!lab->last_save_report().success) {
+      fprintf(stderr, "%s: SaveScene() failed.\n", prefix.c_str());
+    }
+
+    // Clean up the files written.
+    for (size_t file = 0; file < file_count; file++) {
+      std::string name = "generated_" + flatbuffers::NumToString(file);
+      remove((name + "." + kBinaryEntityFileExtension).c_str());
+      remove((name + ".json").c_str());
+    }
+  }
+}
+
+// Copy an entity list into and out of a FlatbufferEditor. Drawing needs
+// FlatUI, and so a window, so isn't covered here.
+static void BenchmarkFlatbufferEditor(BenchmarkRunner* runner,
+                                      const std::string& binary_schema) {
+  for (size_t i = 0; i < sizeof(kTableSizes) / sizeof(kTableSizes[0]); i++) {
+    size_t entity_count = kTableSizes[i];
+    std::string suffix = "/" + SizeName("entities", entity_count);
+    std::string construct = "FlatbufferEditor/construct" + suffix;
+    std::string set_data = "FlatbufferEditor/set_data" + suffix;
+    std::string copy = "FlatbufferEditor/copy" + suffix;
+    if (!runner->Enabled(construct) && !runner->Enabled(set_data) &&
+        !runner->Enabled(copy)) {
+      continue;
+    }
+
+    std::vector<GenericEntityId> ids;
+    std::unique_ptr<MemoryAdapter> adapter =
+        CreateAdapter(binary_schema, "", "", 1, entity_count, &ids);
+    std::vector<uint8_t> table;
+    const reflection::Schema* schema;
+    if (adapter == nullptr || !adapter->SerializeEntities(ids, &table) ||
+        !adapter->GetSchema(&schema)) {
+      return;
+    }
+    const reflection::Object& table_def = *schema->root_table();
+    const void* data = table.data();
+
+    double items = static_cast<double>(entity_count);
+    runner->Run(construct, items, nullptr, [schema, &table_def, data]() {
+      FlatbufferEditor editor(nullptr, *schema, table_def, data);
+      g_sink = g_sink + (editor.HasFlatbufferData() ? 1 : 0);
+    });
+    FlatbufferEditor editor(nullptr, *schema, table_def, data);
+    runner->Run(set_data, items, nullptr,
+                [&editor, data]() { editor.SetFlatbufferData(data); });
+    std::vector<uint8_t> output;
+    runner->Run(copy, items, nullptr, [&editor, &output]() {
+      editor.GetFlatbufferCopy(&output);
+      g_sink = g_sink + output.size();
+    });
+  }
+}
+
+// Convert the biggest struct in the schema to a string and back.
+static void BenchmarkStructStrings(BenchmarkRunner* runner,
+                                   const std::string& binary_schema) {
+  const reflection::Schema* schema =
+      reflection::GetSchema(binary_schema.c_str());
+  const reflection::Object* struct_def = nullptr;
+  for (flatbuffers::uoffset_t i = 0; i < schema->objects()->size(); i++) {
+    const reflection::Object* object = schema->objects()->Get(i);
+    if (object->is_struct() && (struct_def == nullptr ||
+                                object->bytesize() > struct_def->bytesize())) {
+      struct_def = object;
+    }
+  }
+  if (struct_def == nullptr) return;
+
+  // Give every field a value, so it isn't all zeros.
+  std::vector<uint64_t> storage((struct_def->bytesize() + 7) / 8);
+  uint8_t* bytes = reinterpret_cast<uint8_t*>(storage.data());
+  for (int i = 0; i < struct_def->bytesize(); i++) {
+    bytes[i] = static_cast<uint8_t>(i * 37 + 11);
+  }
+  flatbuffers::Struct* data = reinterpret_cast<flatbuffers::Struct*>(bytes);
+  const reflection::Object& def = *struct_def;
+  std::string text =
+      BenchmarkAccess::StructToString(*schema, def, *data, false);
+  std::string suffix = "/" + struct_def->name()->str();
+
+  runner->Run("StructToString" + suffix, kStructConversions, nullptr,
+              [schema, &def, data]() {
+                for (int i = 0; i < kStructConversions; i++) {
+                  g_sink = g_sink + BenchmarkAccess::StructToString(
+                                        *schema, def, *data, false)
+                                        .length();
+                }
+              });
+  runner->Run("ParseStringIntoStruct" + suffix, kStructConversions, nullptr,
+              [schema, &def, data, &text]() {
+                for (int i = 0; i < kStructConversions; i++) {
+                  g_sink = g_sink + BenchmarkAccess::ParseStringIntoStruct(
+                                        text, *schema, def, data);
+                }
+              });
+}
+
+static bool MakeDirectory(const std::string& path) {
+#if defined(_MSC_VER)
+  return _mkdir(path.c_str()) == 0;
+#else
+  return mkdir(path.c_str(), 0755) == 0;
+#endif  // defined(_MSC_VER)
+}
+
+static void RemoveEmptyDirectory(const std::string& path) {
+#if defined(_MSC_VER)
+  _rmdir(path.c_str());
+#else
+  rmdir(path.c_str());
+#endif  // defined(_MSC_VER)
+}
+
+// Scan directories of files for assets to reload, as the editor does.
+static void BenchmarkScanDirectory(BenchmarkRunner* runner) {
+  static const char kExtension[] = ".bin";
+  for (size_t i = 0;
+       i < sizeof(kDirectorySizes) / sizeof(kDirectorySizes[0]); i++) {
+    size_t file_count = kDirectorySizes[i];
+    std::string suffix = "/" + SizeName("files", file_count);
+    std::string scan = "ScanDirectory" + suffix;
+    std::string load_all = "LoadAssetsIfNewer/all" + suffix;
+    std::string load_none = "LoadAssetsIfNewer/none" + suffix;
+    if (!runner->Enabled(scan) && !runner->Enabled(load_all) &&
+        !runner->Enabled(load_none)) {
+      continue;
+    }
+
+    std::string directory = "scan_benchmark_" +
+                            flatbuffers::NumToString(file_count);
+    if (!MakeDirectory(directory)) {
+      fprintf(stderr, "Couldn't create directory '%s'.\n", directory.c_str());
+      return;
+    }
+    std::vector<std::string> files;
+    for (size_t file = 0; file < file_count; file++) {
+      files.push_back(flatbuffers::ConCatPathFileName(
+          directory, "asset_" + flatbuffers::NumToString(file) + kExtension));
+      flatbuffers::SaveFile(files.back().c_str(), files.back(), false);
+    }
+
+    runner->Run(scan, static_cast<double>(file_count), nullptr,
+                [&directory]() {
+                  g_sink = g_sink +
+                           scene_lab::ScanDirectory(directory, kExtension)
+                               .size();
+                });
+    size_t loaded = 0;
+    auto load = [&loaded](const char*) { loaded++; };
+    time_t newest = 0;
+    runner->Run(load_all, static_cast<double>(file_count), nullptr,
+                [&directory, &load, &newest]() {
+                  newest = scene_lab::LoadAssetsIfNewer(0, directory,
+                                                        kExtension, load);
+                });
+    runner->Run(load_none, static_cast<double>(file_count), nullptr,
+                [&directory, &load, &newest]() {
+                  scene_lab::LoadAssetsIfNewer(newest, directory, kExtension,
+                                               load);
+                });
+    g_sink = g_sink + loaded;
+
+    for (auto file = files.begin(); file != files.end(); ++file) {
+      remove(file->c_str());
+    }
+    RemoveEmptyDirectory(directory);
+  }
+}
+
+// Turn screen points into rays and find where they hit the ground, as when
+// dragging an entity, and pick entities with them.
+static void BenchmarkRays(BenchmarkRunner* runner,
+                          const std::string& binary_schema) {
+  flatbuffers::FlatBufferBuilder fbb;
+  const scene_lab::SceneLabConfig* config =
+      CreateConfig("", std::vector<std::string>(), 0, false, &fbb);
+  ScriptedEditorInput input;
+  EditorController controller(config, &input);
+  GenericCamera camera;
+  camera.position = mathfu::vec3(0, -50, 20);
+  camera.facing = mathfu::vec3(0, 1, -0.3f).Normalized();
+  ViewportSettings viewport;
+  viewport.vertical_angle = 45.0f * static_cast<float>(M_PI) / 180.0f;
+  mathfu::vec2i screen_size = input.WindowSize();
+  viewport.aspect_ratio = static_cast<float>(screen_size.x) / screen_size.y;
+
+  std::vector<mathfu::vec2> points;
+  for (int y = 0; y < kRayGridSize; y++) {
+    for (int x = 0; x < kRayGridSize; x++) {
+      points.push_back(mathfu::vec2(
+          (x + 0.5f) * screen_size.x / kRayGridSize,
+          (y + 0.5f) * screen_size.y / kRayGridSize));
+    }
+  }
+  std::vector<mathfu::vec3> origins(points.size());
+  std::vector<mathfu::vec3> directions(points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    controller.ScreenPointToWorldRay(camera, viewport, points[i], screen_size,
+                                     &origins[i], &directions[i]);
+  }
+  double items = static_cast<double>(points.size());
+
+  runner->Run("ScreenPointToWorldRay", items, nullptr, [&]() {
+    mathfu::vec3 origin, direction;
+    for (size_t i = 0; i < points.size(); i++) {
+      controller.ScreenPointToWorldRay(camera, viewport, points[i],
+                                       screen_size, &origin, &direction);
+      g_sink = g_sink + direction.x;
+    }
+  });
+  runner->Run("IntersectRayToPlane", items, nullptr, [&]() {
+    mathfu::vec3 intersection;
+    for (size_t i = 0; i < points.size(); i++) {
+      if (BenchmarkAccess::IntersectRayToPlane(
+              origins[i], directions[i], mathfu::kZeros3f, mathfu::kAxisZ3f,
+              &intersection)) {
+        g_sink = g_sink + intersection.x;
+      }
+    }
+  });
+  runner->Run("ScreenPointToWorldRay+IntersectRayToPlane", items, nullptr,
+              [&]() {
+                mathfu::vec3 origin, direction, intersection;
+                for (size_t i = 0; i < points.size(); i++) {
+                  controller.ScreenPointToWorldRay(camera, viewport, points[i],
+                                                   screen_size, &origin,
+                                                   &direction);
+                  if (BenchmarkAccess::IntersectRayToPlane(
+                          origin, direction, mathfu::kZeros3f,
+                          mathfu::kAxisZ3f, &intersection)) {
+                    g_sink = g_sink + intersection.x;
+                  }
+                }
+              });
+
+  if (binary_schema.empty()) return;
+  for (size_t size = 0; size < sizeof(kTableSizes) / sizeof(kTableSizes[0]);
+       size++) {
+    size_t entity_count = kTableSizes[size];
+    std::string name =
+        "GetRayIntersection/" + SizeName("entities", entity_count);
+    if (!runner->Enabled(name)) continue;
+    std::unique_ptr<MemoryAdapter> adapter =
+        CreateAdapter(binary_schema, "", "", 1, entity_count, nullptr);
+    if (adapter == nullptr) return;
+    MemoryAdapter* entities = adapter.get();
+    runner->Run(name, items, nullptr, [&]() {
+      GenericEntityId entity;
+      mathfu::vec3 intersection;
+      for (size_t i = 0; i < points.size(); i++) {
+        if (entities->GetRayIntersection(origins[i], directions[i], &entity,
+                                         &intersection)) {
+          g_sink = g_sink + intersection.x;
+        }
+      }
+    });
+  }
+}
+
+int main(int argc, char** argv) {
+  std::string filter;
+  double min_seconds = 0.5;
+  int threads = 0;
+  std::vector<std::string> include_paths;
+  std::string template_file;
+  std::string json_file;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--min_time") == 0 && i + 1 < argc) {
+      min_seconds = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--include") == 0 && i + 1 < argc) {
+      include_paths.push_back(argv[++i]);
+    } else if (strcmp(argv[i], "--template") == 0 && i + 1 < argc) {
+      template_file = argv[++i];
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json_file = argv[++i];
+    } else if (argv[i][0] == '-') {
+      PrintUsage(argv[0]);
+      return 1;
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  if (args.size() > 2) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::string binary_schema;
+  if (args.size() >= 1 &&
+      !flatbuffers::LoadFile(args[0].c_str(), true, &binary_schema)) {
+    fprintf(stderr, "Couldn't load binary schema '%s'.\n", args[0].c_str());
+    return 1;
+  }
+  std::string text_schema;
+  std::string text_schema_file = args.size() >= 2 ? args[1] : "";
+  if (!text_schema_file.empty() &&
+      !flatbuffers::LoadFile(text_schema_file.c_str(), false, &text_schema)) {
+    fprintf(stderr, "Couldn't load text schema '%s'.\n",
+            text_schema_file.c_str());
+    return 1;
+  }
+  std::string component_templates;
+  if (!template_file.empty() &&
+      !flatbuffers::LoadFile(template_file.c_str(), true,
+                             &component_templates)) {
+    fprintf(stderr, "Couldn't load template file '%s'.\n",
+            template_file.c_str());
+    return 1;
+  }
+  if (!binary_schema.empty()) {
+    flatbuffers::Verifier verifier(
+        reinterpret_cast<const uint8_t*>(binary_schema.c_str()),
+        binary_schema.length());
+    if (!reflection::VerifySchemaBuffer(verifier)) {
+      fprintf(stderr, "'%s' isn't a binary schema.\n", args[0].c_str());
+      return 1;
+    }
+  }
+
+  BenchmarkRunner runner(filter, min_seconds);
+  printf("%-56s %13s %13s %8s\n", "Benchmark", "Time", "CPU", "Runs");
+  if (!binary_schema.empty()) {
+    if (component_templates.empty()) {
+      fprintf(stderr,
+              "No --template given, so SaveScene's entities have only "
+              "default-valued components.\n");
+    }
+    BenchmarkSaveScene(&runner, binary_schema, text_schema, text_schema_file,
+                       include_paths, component_templates, threads);
+    BenchmarkFlatbufferEditor(&runner, binary_schema);
+    BenchmarkStructStrings(&runner, binary_schema);
+  } else {
+    fprintf(stderr,
+            "No binary schema given, so skipping the SaveScene, "
+            "FlatbufferEditor and struct benchmarks.\n");
+  }
+  BenchmarkScanDirectory(&runner);
+  BenchmarkRays(&runner, binary_schema);
+
+  if (!json_file.empty() && !runner.WriteJson(json_file, argv[0])) return 1;
+  return 0;
+}
@@ -15,6 +15,10 @@
 #ifndef SCENE_LAB_CORGI_CORGI_ADAPTER_H_
 #define SCENE_LAB_CORGI_CORGI_ADAPTER_H_
 
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include "corgi/entity_manager.h"
 #include "corgi_component_library/camera_interface.h"
 #include "corgi_component_library/entity_factory.h"
@@ -31,6 +35,9 @@ namespace scene_lab_corgi {
 // For CorgiAdapter:
 // * GenericEntityId is the entity_id in the entity's MetaData.
 // * GenericComponentId is a string representation of the component ID number.
+// Both are converted to and from strings using EntitySystemAdapter's tables.
+// If your game unloads a scene, call ClearEntityIds() while Scene Lab is
+// inactive, so the IDs of its entities don't stay in memory.
 
 class CorgiAdapter : public scene_lab::EntitySystemAdapter {
  public:
@@ -40,7 +47,9 @@ class CorgiAdapter : public scene_lab::EntitySystemAdapter {
   typedef scene_lab::GenericPrototypeId GenericPrototypeId;
   typedef scene_lab::GenericCamera GenericCamera;
   typedef scene_lab::GenericTransform GenericTransform;
+  typedef scene_lab::GenericTransformArrays GenericTransformArrays;
   typedef scene_lab::ViewportSettings ViewportSettings;
+  typedef scene_lab::SharedFileBuffer SharedFileBuffer;
 
   CorgiAdapter(scene_lab::SceneLab* scene_lab,
                corgi::EntityManager* entity_manager);
@@ -68,6 +77,18 @@ class CorgiAdapter : public scene_lab::EntitySystemAdapter {
   virtual bool SetEntityTransform(const GenericEntityId& id,
                                   const GenericTransform& transform);
 
+  virtual bool GetEntityTransforms(const GenericEntityId* ids, size_t count,
+                                   GenericTransformArrays* transforms_output);
+
+  virtual bool SetEntityTransforms(const GenericEntityId* ids, size_t count,
+                                   const GenericTransformArrays& transforms);
+
+  /// While an entity's transform is being edited, its physics is only brought
+  /// up to date when something needs it, rather than every time it moves.
+  virtual void BeginTransformEdit(const GenericEntityId& id);
+
+  virtual void EndTransformEdit(const GenericEntityId& id);
+
   virtual bool GetEntityChildren(const GenericEntityId& id,
                                  std::vector<GenericEntityId>* children_out);
 
@@ -86,6 +107,11 @@ class CorgiAdapter : public scene_lab::EntitySystemAdapter {
   virtual bool DuplicateEntity(const GenericEntityId& id,
                                GenericEntityId* new_id_output);
 
+  /// Serializes the entity once and loads all of the copies in one go.
+  virtual bool DuplicateEntities(const GenericEntityId& id,
+                                 const GenericTransformArrays& offsets,
+                                 std::vector<GenericEntityId>* new_ids_output);
+
   virtual bool CreateEntity(GenericEntityId* new_id_output);
 
   virtual bool CreateEntityFromPrototype(const GenericPrototypeId& prototype,
@@ -105,13 +131,36 @@ class CorgiAdapter : public scene_lab::EntitySystemAdapter {
 
   virtual bool CycleEntities(int direction, GenericEntityId* next_entity);
 
+  /// Returns a cached list, which is only rebuilt after entities are created
+  /// or deleted through this adapter, or RefreshEntityIDs() is called.
+  ///
+  /// Which components each entity has is cached along with the list, and
+  /// updated when components are changed through this adapter. Rebuilding the
+  /// list keeps what's known about entities that were already in it, so only
+  /// new entities have their components checked. If the game adds or removes
+  /// components while Scene Lab is active, call RefreshEntityIDs().
   virtual bool GetAllEntityIDs(std::vector<GenericEntityId>* ids_out);
 
+  /// Rebuilds the entity ID list and checks every entity's components again.
+  virtual void RefreshEntityIDs() {
+    component_masks_valid_ = false;
+    InvalidateEntityIDs();
+  }
+
+  /// Rebuilds the entity ID list, only checking the components of entities
+  /// that weren't in it before.
+  virtual void RefreshEntityIDList() { InvalidateEntityIDs(); }
+
+  /// Also forgets everything cached by entity ID.
+  virtual void ClearEntityIds();
+
+  virtual uint64_t GetEntityIDsGeneration() { return entity_ids_generation_; }
+
   virtual bool GetAllPrototypeIDs(std::vector<GenericPrototypeId>* ids_out);
 
   virtual bool GetEntityName(const GenericEntityId& id, std::string* name_out) {
     /// Use the ID string.
-    if (name_out != nullptr) *name_out = static_cast<std::string>(id);
+    if (name_out != nullptr) *name_out = EntityIdString(id);
     return true;
   }
 
@@ -128,6 +177,9 @@ class CorgiAdapter : public scene_lab::EntitySystemAdapter {
   virtual bool GetTableObject(const GenericComponentId& id,
                               const reflection::Object** table_out);
 
+  virtual bool GetTableName(const GenericComponentId& id,
+                            std::string* name_out);
+
   virtual bool GetEntityComponentList(
       const GenericEntityId& id,
       std::vector<GenericComponentId>* components_out);
@@ -135,6 +187,10 @@ class CorgiAdapter : public scene_lab::EntitySystemAdapter {
   virtual void GetFullComponentList(
       std::vector<GenericComponentId>* components_out);
 
+  virtual bool GetEntitiesWithComponents(
+      const std::vector<GenericComponentId>& components,
+      std::vector<GenericEntityId>* ids_out);
+
   virtual bool IsEntityComponentFromPrototype(
       const GenericEntityId& entity, const GenericComponentId& component);
 
@@ -152,6 +208,27 @@ class CorgiAdapter : public scene_lab::EntitySystemAdapter {
   virtual void OverrideFileCache(const std::string& filename,
                                  const std::vector<uint8_t>& data);
 
+  virtual void UpdateFileCache(const std::string& filename,
+                               const SharedFileBuffer& data);
+
+  /// Get the cached contents of an entity file that Scene Lab has saved, or
+  /// null if it hasn't saved that file since this adapter was created.
+  SharedFileBuffer GetCachedFile(const std::string& filename) const;
+
+  /// Load all of the entities in an entity file into the EntityManager, the
+  /// way EntityFactory::LoadEntitiesFromFile() does, but using Scene Lab's
+  /// latest saved version of the file if there is one. Use this to (re)load
+  /// levels after editing them, so that edits saved only to the file cache
+  /// (e.g. when Scene Lab is deactivated) are picked up without touching disk.
+  ///
+  /// EntityFactory itself always reads files from disk, so your game must
+  /// load its levels through this for the file cache to have any effect; see
+  /// the sample's Game::Initialize().
+  ///
+  /// Returns the number of entities loaded.
+  int LoadEntitiesFromFile(const std::string& filename,
+                           std::vector<corgi::EntityRef>* entities_out);
+
   /// Add a component to the list of components to update each frame.
   ///
   /// While Scene Lab is activated, you should no longer be calling
@@ -171,8 +248,23 @@ class CorgiAdapter : public scene_lab::EntitySystemAdapter {
   /// Convert a Scene Lab entity ID to a Corgi entity reference.
   /// This is public so that Corgi (particularly EditOptionsComponent) can talk
   /// to Scene Lab properly.
+  ///
+  /// Results are cached until the end of the frame, or until an entity is
+  /// created, deleted or has its components changed through this adapter. If
+  /// you change an entity's ID or delete it yourself mid-frame, call
+  /// ClearEntityRefCache().
   corgi::EntityRef GetEntityRef(const GenericEntityId& id) const;
 
+  /// Forget all cached results of GetEntityRef().
+  void ClearEntityRefCache() { entity_refs_.clear(); }
+
+  /// Recheck which components an entity has, after adding or removing them
+  /// without going through this adapter. Only that entity is checked, unlike
+  /// RefreshEntityIDs(). Does nothing if the entity isn't in the cache yet,
+  /// since it will be checked when it's added.
+  void UpdateComponentMask(const GenericEntityId& id,
+                           const corgi::EntityRef& entity);
+
   /// Convert a Corgi entity reference to a Scene Lab entity ID.
   /// This is public so that Corgi components can talk to Scene Lab properly.
   GenericEntityId GetEntityId(const corgi::EntityRef& entity) const;
@@ -196,6 +288,36 @@ class CorgiAdapter : public scene_lab::EntitySystemAdapter {
 
   void CreateDefaultCamera();
 
+  /// Load `count` copies of `entity`, appending them to `entities_created`,
+  /// and give them new IDs in the same file as the original. Returns false
+  /// if no copies could be made.
+  bool LoadEntityCopies(const corgi::EntityRef& entity, size_t count,
+                        std::vector<corgi::EntityRef>* entities_created);
+
+  /// Add any components registered with the EntityManager since we last
+  /// looked to the component tables. Each component's table name is looked up
+  /// once, so register its type with the EntityFactory before Scene Lab first
+  /// sees it.
+  void UpdateComponentTables() const;
+
+  /// Rebuild the cached entity ID list and component masks if needed.
+  void UpdateEntityCache();
+
+  /// Recompute the component mask of the entity at `index` in entity_ids_.
+  void UpdateComponentMask(size_t index, const corgi::EntityRef& entity);
+
+  /// Bring the physics of all entities moved during transform edits up to
+  /// date.
+  void UpdateStalePhysics();
+
+  /// Mark the cached entity ID list as out of date. The component masks (and
+  /// entity_indices_, to find them) are kept for when it's rebuilt.
+  void InvalidateEntityIDs() {
+    entity_ids_valid_ = false;
+    entity_ids_generation_++;
+    ClearEntityRefCache();
+  }
+
   scene_lab::SceneLab* scene_lab_;
 
   std::unique_ptr<corgi::CameraInterface> camera_;
@@ -205,6 +327,54 @@ class CorgiAdapter : public scene_lab::EntitySystemAdapter {
   std::vector<corgi::ComponentId> components_to_update_;
   corgi::EntityManager::EntityStorageContainer::Iterator entity_cycler_;
 
+  // Cached result of GetAllEntityIDs(), if entity_ids_valid_ is set.
+  std::vector<GenericEntityId> entity_ids_;
+  // Index of each entity in entity_ids_ (as of the last rebuild, if it's out
+  // of date).
+  std::unordered_map<GenericEntityId, size_t> entity_indices_;
+  // Which components each entity in entity_ids_ has: component_mask_words_
+  // 64-bit words per entity, where bit N is set if it has component ID N.
+  std::vector<uint64_t> component_masks_;
+  size_t component_mask_words_;
+  // How many components were registered when the masks were made.
+  size_t component_mask_count_;
+  // Can the masks be kept when the list is rebuilt?
+  bool component_masks_valid_;
+  bool entity_ids_valid_;
+  uint64_t entity_ids_generation_;
+  // An entity was deleted, so the list will change once it's really removed.
+  bool entity_deletion_pending_;
+
+  // What we know about each component, indexed by corgi::ComponentId, and a
+  // map back from GenericComponentId. Built by UpdateComponentTables().
+  struct ComponentInfo {
+    ComponentInfo() : table_object(nullptr) {}
+    GenericComponentId generic_id;
+    // The component's FlatBuffers table name, or "" if it has none.
+    std::string table_name;
+    // The table in the binary schema, or null if it's not there.
+    const reflection::Object* table_object;
+  };
+  mutable std::vector<ComponentInfo> component_info_;
+  mutable std::unordered_map<GenericComponentId, corgi::ComponentId>
+      corgi_component_ids_;
+
+  // Cached results of GetEntityRef(). Only entities that were found are
+  // cached.
+  mutable std::unordered_map<GenericEntityId, corgi::EntityRef> entity_refs_;
+
+  // Spare buffers for SerializeEntities() to serialize entities into, kept
+  // between calls so their memory can be reused. Capped in size and count.
+  std::vector<std::vector<uint8_t>> entity_buffer_pool_;
+
+  // Entities whose transforms are being edited, and those of them that have
+  // moved since their physics was last updated.
+  std::unordered_set<GenericEntityId> transform_edits_;
+  std::unordered_set<GenericEntityId> stale_physics_;
+
+  // Latest saved contents of each entity file, by filename (with extension).
+  std::unordered_map<std::string, SharedFileBuffer> file_cache_;
+
   // For storing the FlatBuffers schema we use for exporting.
   std::string schema_data_;
   std::string schema_text_;
@@ -18,6 +18,7 @@
 #include "fplbase/input.h"
 #include "mathfu/constants.h"
 #include "mathfu/glsl_mappings.h"
+#include "scene_lab/editor_input.h"
 #include "scene_lab/entity_system_adapter.h"
 #include "scene_lab_config_generated.h"
 
@@ -32,11 +33,10 @@ class EditorController {
  public:
   static const int kNumButtons = 10;  // max buttons from fplbase/input.h
 
-  /// Initialize the controller.
-  EditorController(const SceneLabConfig* config,
-                   fplbase::InputSystem* input_system)
+  /// Initialize the controller, reading input from `input`.
+  EditorController(const SceneLabConfig* config, EditorInput* input)
       : config_(config),
-        input_system_(input_system),
+        input_(input),
         mouse_locked_(false),
         facing_current_(mathfu::kZeros3f),
         facing_previous_(mathfu::kZeros3f),
@@ -47,6 +47,9 @@ class EditorController {
     }
   }
 
+  /// Read input from somewhere else from now on.
+  void set_input(EditorInput* input) { input_ = input; }
+
   /// Call this every frame to update the *WentDown() functions.
   void Update();
 
@@ -70,21 +73,21 @@ class EditorController {
   /// KeyWentDown() returns true on the first frame a given key is being
   /// pressed.
   bool KeyWentDown(fplbase::FPL_Keycode key) const {
-    return input_system_->GetButton(key).went_down();
+    return input_->KeyWentDown(key);
   }
   /// KeyWentUp() returns true on the first frame after a given key has stopped
   /// being pressed.
   bool KeyWentUp(fplbase::FPL_Keycode key) const {
-    return input_system_->GetButton(key).went_up();
+    return input_->KeyWentUp(key);
   }
   /// KeyIsDown() returns true while the given key is being held down.
   bool KeyIsDown(fplbase::FPL_Keycode key) const {
-    return input_system_->GetButton(key).is_down();
+    return input_->KeyIsDown(key);
   }
   /// KeyIsUp() returns true while the given key is not being held down.
   /// Equivalent to !KeyIsDown(key).
   bool KeyIsUp(fplbase::FPL_Keycode key) const {
-    return !input_system_->GetButton(key).is_down();
+    return !input_->KeyIsDown(key);
   }
 
   /// Get the direction we are facing. If the mouse is locked, then moving it
@@ -109,14 +112,14 @@ class EditorController {
   /// facing.
   void LockMouse() {
     mouse_locked_ = true;
-    input_system_->SetRelativeMouseMode(true);
+    input_->SetRelativeMouseMode(true);
   }
 
   /// Stop locking the mouse to the middle of the screen; it will no longer
   /// update facing, but will update pointer location instead.
   void UnlockMouse() {
     mouse_locked_ = false;
-    input_system_->SetRelativeMouseMode(false);
+    input_->SetRelativeMouseMode(false);
   }
 
   /// Get the position of a screen point in the world, as a ray from the camera
@@ -135,7 +138,7 @@ class EditorController {
 
  private:
   const SceneLabConfig* config_;
-  fplbase::InputSystem* input_system_;
+  EditorInput* input_;
 
   bool mouse_locked_;
 
@@ -241,6 +241,11 @@ class EditorGui {
   std::vector<std::string> prototype_list_;  // Currently available protoypes.
 
   std::string entity_list_filter_;
+  // The entities shown in the entity list, and what they were built from, so
+  // the list is only rebuilt when the entities or the filter change.
+  std::vector<GenericEntityId> entity_list_;
+  std::string entity_list_built_filter_;
+  uint64_t entity_list_generation_;
   std::string prototype_list_filter_;
   std::string menu_title_string_;
 
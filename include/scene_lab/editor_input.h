@@ -0,0 +1,157 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SCENE_LAB_EDITOR_INPUT_H_
+#define SCENE_LAB_EDITOR_INPUT_H_
+
+#include <unordered_set>
+#include "fplbase/input.h"
+#include "fplbase/renderer.h"
+#include "mathfu/constants.h"
+#include "mathfu/glsl_mappings.h"
+
+namespace scene_lab {
+
+/// @file
+/// Where Scene Lab's keyboard and pointer input comes from. Normally that's
+/// FPLBase's InputSystem, via FplbaseEditorInput, but Scene Lab can also be
+/// driven by a script with ScriptedEditorInput, e.g. when running headless.
+class EditorInput {
+ public:
+  virtual ~EditorInput() {}
+
+  /// Called once a frame, before any input is read for that frame.
+  virtual void Update() {}
+
+  /// Is the key held down?
+  virtual bool KeyIsDown(fplbase::FPL_Keycode key) const = 0;
+  /// Was the key pressed this frame?
+  virtual bool KeyWentDown(fplbase::FPL_Keycode key) const = 0;
+  /// Was the key released this frame?
+  virtual bool KeyWentUp(fplbase::FPL_Keycode key) const = 0;
+
+  /// Is the pointer button held down? The primary button is number 0.
+  virtual bool PointerButtonIsDown(int button) const = 0;
+  /// Pointer position in the window, in pixels.
+  virtual mathfu::vec2 PointerPosition() const = 0;
+  /// How far the pointer moved this frame, in pixels.
+  virtual mathfu::vec2 PointerDelta() const = 0;
+  /// Size of the window PointerPosition() is relative to.
+  virtual mathfu::vec2i WindowSize() const = 0;
+
+  /// In relative mouse mode the pointer is hidden and locked in place, and
+  /// only PointerDelta() changes.
+  virtual void SetRelativeMouseMode(bool relative) = 0;
+};
+
+/// Input from FPLBase, i.e. a real keyboard and mouse.
+class FplbaseEditorInput : public EditorInput {
+ public:
+  FplbaseEditorInput(fplbase::InputSystem* input_system,
+                     fplbase::Renderer* renderer)
+      : input_system_(input_system), renderer_(renderer) {}
+
+  virtual bool KeyIsDown(fplbase::FPL_Keycode key) const {
+    return input_system_->GetButton(key).is_down();
+  }
+  virtual bool KeyWentDown(fplbase::FPL_Keycode key) const {
+    return input_system_->GetButton(key).went_down();
+  }
+  virtual bool KeyWentUp(fplbase::FPL_Keycode key) const {
+    return input_system_->GetButton(key).went_up();
+  }
+  virtual bool PointerButtonIsDown(int button) const {
+    return input_system_->GetPointerButton(button).is_down();
+  }
+  virtual mathfu::vec2 PointerPosition() const {
+    return mathfu::vec2(input_system_->get_pointers()[0].mousepos);
+  }
+  virtual mathfu::vec2 PointerDelta() const {
+    return mathfu::vec2(input_system_->get_pointers()[0].mousedelta);
+  }
+  virtual mathfu::vec2i WindowSize() const { return renderer_->window_size(); }
+  virtual void SetRelativeMouseMode(bool relative) {
+    input_system_->SetRelativeMouseMode(relative);
+  }
+
+ private:
+  fplbase::InputSystem* input_system_;
+  fplbase::Renderer* renderer_;
+};
+
+/// Input set by your own code, for running Scene Lab without a window.
+///
+/// Set the state you want Scene Lab to see in its next frame, then call
+/// SceneLab::AdvanceFrame(). Keys and buttons stay down until you release
+/// them; KeyWentDown() and KeyWentUp() compare each frame with the one
+/// before, just as with a real keyboard.
+class ScriptedEditorInput : public EditorInput {
+ public:
+  ScriptedEditorInput()
+      : pointer_position_(mathfu::kZeros2f),
+        pointer_movement_(mathfu::kZeros2f),
+        pointer_delta_(mathfu::kZeros2f),
+        window_size_(1280, 720),
+        relative_mouse_mode_(false) {}
+
+  /// Press or release a key.
+  void SetKey(fplbase::FPL_Keycode key, bool is_down);
+  /// Press or release a pointer button.
+  void SetPointerButton(int button, bool is_down);
+  /// Release every key and pointer button.
+  void ReleaseAll();
+
+  /// Move the pointer to a position in the window.
+  void SetPointerPosition(const mathfu::vec2& position);
+  /// Move the pointer by `delta` pixels. In relative mouse mode this turns
+  /// the camera rather than moving the pointer.
+  void MovePointer(const mathfu::vec2& delta);
+
+  void set_window_size(const mathfu::vec2i& size) { window_size_ = size; }
+
+  /// Has Scene Lab asked for relative mouse mode?
+  bool relative_mouse_mode() const { return relative_mouse_mode_; }
+
+  virtual void Update();
+  virtual bool KeyIsDown(fplbase::FPL_Keycode key) const;
+  virtual bool KeyWentDown(fplbase::FPL_Keycode key) const;
+  virtual bool KeyWentUp(fplbase::FPL_Keycode key) const;
+  virtual bool PointerButtonIsDown(int button) const;
+  virtual mathfu::vec2 PointerPosition() const { return pointer_position_; }
+  virtual mathfu::vec2 PointerDelta() const { return pointer_delta_; }
+  virtual mathfu::vec2i WindowSize() const { return window_size_; }
+  virtual void SetRelativeMouseMode(bool relative) {
+    relative_mouse_mode_ = relative;
+  }
+
+ private:
+  // Keys and buttons (by number) held down now, as set by the script.
+  std::unordered_set<int> keys_;
+  std::unordered_set<int> buttons_;
+  // Keys and buttons held down this frame and last frame, as of Update().
+  std::unordered_set<int> frame_keys_;
+  std::unordered_set<int> previous_frame_keys_;
+  std::unordered_set<int> frame_buttons_;
+
+  mathfu::vec2 pointer_position_;
+  // Movement since the last Update(), and the movement this frame.
+  mathfu::vec2 pointer_movement_;
+  mathfu::vec2 pointer_delta_;
+  mathfu::vec2i window_size_;
+  bool relative_mouse_mode_;
+};
+
+}  // namespace scene_lab
+
+#endif  // SCENE_LAB_EDITOR_INPUT_H_
@@ -0,0 +1,177 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SCENE_LAB_ENTITY_JSON_WRITER_H_
+#define SCENE_LAB_ENTITY_JSON_WRITER_H_
+
+#include <stdio.h>
+#include <string.h>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "flatbuffers/flatbuffers.h"
+#include "flatbuffers/idl.h"
+#include "flatbuffers/reflection.h"
+#include "scene_lab/util.h"
+
+namespace scene_lab {
+
+/// @file
+/// Converts FlatBuffer data to JSON text and streams it straight to a file,
+/// without ever holding the whole text in memory.
+///
+/// The output is byte-for-byte what flatbuffers::GenerateText() produces with
+/// `strict_json` set and the other options left at their defaults, so files
+/// written either way can be diffed cleanly. The FlatBuffer is walked using
+/// its binary (reflection) schema rather than a parsed text schema.
+///
+/// A few rarely-seen kinds of data (strings containing anything other than
+/// printable ASCII, or union values with no matching type) are escaped
+/// differently by different FlatBuffers versions. Rather than guess, the
+/// writer reports them as kUnsupportedData, and callers should fall back to
+/// GenerateText() for that file.
+///
+/// An EntityJsonWriter is not thread-safe, but it is cheap to create, so use
+/// one per thread.
+class EntityJsonWriter {
+ public:
+  enum Status {
+    kOk,               ///< The JSON text was generated successfully.
+    kFileError,        ///< The output file couldn't be opened or written.
+    kUnsupportedData,  ///< Use GenerateText() for this data instead.
+  };
+
+  /// Default size of the chunks the text is written to disk in.
+  static const size_t kDefaultChunkSize = 64 * 1024;
+
+  /// Create a writer for FlatBuffers whose root type is the root table of
+  /// `schema`. The schema must outlive the writer.
+  explicit EntityJsonWriter(const reflection::Schema* schema,
+                            size_t chunk_size = kDefaultChunkSize);
+
+  /// Generate JSON text for `flatbuffer` and write it to the file at `path`.
+  /// If `hash_out` is not null, it receives HashBytes() of the text written.
+  Status WriteFile(const std::string& path, const uint8_t* flatbuffer,
+                   uint64_t* hash_out);
+
+  /// Generate JSON text for `flatbuffer`, but only compute HashBytes() of it
+  /// rather than writing it anywhere. Useful for checking whether an existing
+  /// file is already up to date.
+  Status HashText(const uint8_t* flatbuffer, uint64_t* hash_out);
+
+ private:
+  /// Walk the whole FlatBuffer, sending the text to the current output.
+  Status Generate(const uint8_t* flatbuffer);
+
+  /// Output a table or struct, and all of its present fields.
+  void GenObject(const reflection::Object& object, const uint8_t* data,
+                 int indent);
+
+  /// Output a single field of a table or struct. `union_object` is the type
+  /// of the most recent union seen in this table, if any.
+  void GenField(const reflection::Field& field, const uint8_t* data,
+                bool is_struct, const reflection::Object* union_object,
+                int indent);
+
+  /// Output a scalar value, as an enum identifier if it has one.
+  void GenScalar(reflection::BaseType base_type, int enum_index,
+                 const uint8_t* value);
+
+  /// Output a vector, with elements of the given type.
+  void GenVector(const reflection::Type& type, const uint8_t* vec,
+                 int indent);
+
+  /// Output a quoted, escaped string.
+  void GenString(const flatbuffers::String& str);
+
+  /// Get an object's fields in the order they were declared in the schema,
+  /// which is the order GenerateText() outputs them in.
+  const std::vector<const reflection::Field*>& SortedFields(
+      const reflection::Object& object);
+
+  void Write(const char* text, size_t length);
+  void Write(const char* text) { Write(text, strlen(text)); }
+  void Write(const std::string& text) { Write(text.c_str(), text.length()); }
+  void Write(char c) { Write(&c, 1); }
+  void WriteIndent(int indent);
+  /// Send the current chunk to the file and the hash.
+  void Flush();
+
+  const reflection::Schema* schema_;
+  std::unordered_map<const reflection::Object*,
+                     std::vector<const reflection::Field*>> sorted_fields_;
+
+  // Current output. If file_ is null, the text is only hashed.
+  FILE* file_;
+  IncrementalHash hash_;
+  std::vector<char> chunk_;
+  size_t chunk_used_;
+  bool file_error_;
+  bool unsupported_data_;
+};
+
+/// What happened when exporting an entity file to JSON with
+/// ExportEntityJson().
+struct EntityJsonExportResult {
+  EntityJsonExportResult()
+      : written(false),
+        unchanged(false),
+        text_hash(0),
+        generate_seconds(0),
+        write_seconds(0) {}
+
+  /// Was the JSON file written?
+  bool written;
+  /// Was writing skipped because the file already had the same text?
+  bool unchanged;
+  /// HashBytes() of the JSON text, if it was written or found unchanged.
+  uint64_t text_hash;
+  /// Time spent generating JSON text before writing any of it.
+  double generate_seconds;
+  /// Time spent writing the JSON file (including generating streamed text).
+  double write_seconds;
+};
+
+/// Given the hash of some JSON text, return true if the existing file already
+/// has that text, so it needn't be written.
+typedef std::function<bool(uint64_t text_hash)> JsonUnchangedCheck;
+
+/// Convert an entity file's FlatBuffer data to JSON and write it to
+/// `json_path`. This is how Scene Lab writes JSON when saving, and is shared
+/// with the scene_lab_json_export tool so that both produce identical files.
+///
+/// If `binary_schema` is given, the text is streamed to disk with an
+/// EntityJsonWriter. Otherwise, or if the data needs it, the text is built
+/// with flatbuffers::GenerateText() using `text_schema`, which should be a
+/// Parser that has parsed the schema with `strict_json` set. Either schema may
+/// be null, but not both.
+///
+/// The text is written to `json_path` plus ".tmp" and then renamed over
+/// `json_path`, so the existing file is never left partly written. If
+/// `is_unchanged` is set and says the new text is the same, the temporary
+/// file is removed instead and the existing file is left alone. Returns true
+/// if the file was written or was already up to date.
+///
+/// This is safe to call from multiple threads at once, as long as they write
+/// different files.
+bool ExportEntityJson(const std::string& json_path, const uint8_t* flatbuffer,
+                      const flatbuffers::Parser* text_schema,
+                      const reflection::Schema* binary_schema,
+                      const JsonUnchangedCheck& is_unchanged,
+                      EntityJsonExportResult* result);
+
+}  // namespace scene_lab
+
+#endif  // SCENE_LAB_ENTITY_JSON_WRITER_H_
@@ -15,6 +15,7 @@
 #ifndef SCENE_LAB_ENTITY_SYSTEM_ADAPTER_H_
 #define SCENE_LAB_ENTITY_SYSTEM_ADAPTER_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 #include "flatbuffers/flatbuffers.h"
@@ -22,33 +23,41 @@
 #include "mathfu/constants.h"
 #include "mathfu/glsl_mappings.h"
 #include "mathfu/utilities.h"
+#include "scene_lab/interned_id.h"
 
 namespace scene_lab {
 
 /// Generic type to represent an entity ID. Even if your entity IDs are more
 /// complex than this, you should be able to encode them into a string.
 ///
+/// By default this is an InternedId, a handle to a string in a table owned by
+/// your adapter. Scene Lab itself only copies, compares and hashes IDs, which
+/// InternedId makes constant-time; adapters convert their own string IDs with
+/// EntitySystemAdapter::EntityIdFromString() and EntityIdString().
+///
 /// You can change GenericEntityId to be any type that can have its equality
-/// compared via the "==" operator and can be value-copied by the "="
-/// operator. For example, scalar types like uint64_t, or std::string (the
-/// default) are valid.
+/// compared via the "==" operator, can be value-copied by the "=" operator,
+/// and has a std::hash specialization. For example, scalar types like
+/// uint64_t, std::string, or InternedId (the default) are valid.
 ///
-/// If you do change the type from std::string, be sure to change the value for
-/// the kNoEntityId constant in entity_system_adapter.cpp.
-typedef std::string GenericEntityId;
+/// If you do change the type, be sure to change the value for the kNoEntityId
+/// constant in entity_system_adapter.cpp, and the ID conversion functions in
+/// EntitySystemAdapter.
+typedef InternedId GenericEntityId;
 
 /// Generic type representing Component IDs, if you are using a component-based
 /// entity system. If you aren't, you should just use an empty component ID and
 /// serialize everything at once.
 ///
 /// You can change GenericComponentId to be any type that can have its equality
-/// compared via the "==" operator and can be value-copied by the "="
-/// operator. For example, scalar types like uint64_t, or std::string (the
-/// default) are valid.
+/// compared via the "==" operator, can be value-copied by the "=" operator,
+/// and has a std::hash specialization. For example, scalar types like
+/// uint64_t, std::string, or InternedId (the default) are valid.
 ///
-/// If you do change the type from std::string, be sure to change the value for
-/// the kNoComponentId constant in entity_system_adapter.cpp.
-typedef std::string GenericComponentId;
+/// If you do change the type, be sure to change the value for the
+/// kNoComponentId constant in entity_system_adapter.cpp, and the ID conversion
+/// functions in EntitySystemAdapter.
+typedef InternedId GenericComponentId;
 
 /// Generic type representing prototype IDs, if you handle them differently than
 /// entity IDs. In Scene Lab, the difference between a "prototype" and an
@@ -58,9 +67,14 @@ typedef std::string GenericComponentId;
 ///
 /// You can change GenericPrototypeId to be any type that can have its equality
 /// compared via the "==" operator and can be value-copied by the "="
-/// operator. For example, scalar types like uint64_t, or std::string (the
-/// default) are valid.
-typedef std::string GenericPrototypeId;
+/// operator. For example, scalar types like uint64_t, std::string, or
+/// InternedId (the default) are valid.
+typedef InternedId GenericPrototypeId;
+
+/// The contents of a file, shared between everyone who needs them without
+/// being copied. Scene Lab hands these to your file cache when saving; the
+/// data is never modified once it's been shared.
+typedef std::shared_ptr<const std::vector<uint8_t>> SharedFileBuffer;
 
 /// A minimum set of what you need to specify an entity's transform.
 struct GenericTransform {
@@ -74,6 +88,58 @@ struct GenericTransform {
       : position(mathfu::kZeros3f),
         scale(mathfu::kOnes3f),
         orientation(mathfu::kQuatIdentityf) {}
+
+  /// Get this transform moved by `offset`: the positions are added, the
+  /// offset's orientation is applied after this one, and the scales are
+  /// multiplied.
+  GenericTransform Offset(const GenericTransform& offset) const {
+    GenericTransform result;
+    result.position = position + offset.position;
+    result.orientation = offset.orientation * orientation;
+    result.scale = scale * offset.scale;
+    return result;
+  }
+};
+
+/// Transforms for a list of entities, stored as one array per field rather than
+/// one GenericTransform per entity, for reading and writing many at once. Each
+/// array has one element per entity. The arrays use mathfu's packed types so
+/// they can be tightly packed and safely stored in std::vector.
+struct GenericTransformArrays {
+  /// World position of each entity.
+  std::vector<mathfu::vec3_packed> positions;
+  /// Orientation of each entity, as (x, y, z, w), where w is the scalar part.
+  std::vector<mathfu::vec4_packed> orientations;
+  /// Scale of each entity.
+  std::vector<mathfu::vec3_packed> scales;
+
+  size_t size() const { return positions.size(); }
+
+  /// Resize every array to hold `count` transforms.
+  void resize(size_t count) {
+    positions.resize(count);
+    orientations.resize(count);
+    scales.resize(count);
+  }
+
+  /// Get the transform at `index` as a GenericTransform.
+  GenericTransform Get(size_t index) const {
+    GenericTransform transform;
+    transform.position = mathfu::vec3(positions[index]);
+    mathfu::vec4 orientation(orientations[index]);
+    transform.orientation = mathfu::quat(orientation.w(), orientation.x(),
+                                         orientation.y(), orientation.z());
+    transform.scale = mathfu::vec3(scales[index]);
+    return transform;
+  }
+
+  /// Set the transform at `index` from a GenericTransform.
+  void Set(size_t index, const GenericTransform& transform) {
+    positions[index] = mathfu::vec3_packed(transform.position);
+    orientations[index] = mathfu::vec4_packed(mathfu::vec4(
+        transform.orientation.vector(), transform.orientation.scalar()));
+    scales[index] = mathfu::vec3_packed(transform.scale);
+  }
 };
 
 /// A minimum set of what you need for a camera.
@@ -163,6 +229,41 @@ class EntitySystemAdapter {
   virtual bool SetEntityTransform(const GenericEntityId& id,
                                   const GenericTransform& transform) = 0;
 
+  /// Get the transforms of `count` entities at once. `transforms_output` is
+  /// resized to `count`, and element i is the transform of `ids[i]`.
+  ///
+  /// The default implementation calls GetEntityTransform() for each entity;
+  /// override this if your entity system can do better.
+  ///
+  /// @return true if every entity's transform was retrieved. If not, the
+  /// others are still retrieved, and the ones that weren't are left as the
+  /// identity transform.
+  virtual bool GetEntityTransforms(const GenericEntityId* ids, size_t count,
+                                   GenericTransformArrays* transforms_output);
+
+  /// Set the transforms of `count` entities at once, where element i of
+  /// `transforms` is the new transform for `ids[i]`. Behaves the same as
+  /// calling SetEntityTransform() for each entity, which is what the default
+  /// implementation does; override this if your entity system can do better.
+  ///
+  /// @return true if every entity's transform was set. If not, the others are
+  /// still set.
+  virtual bool SetEntityTransforms(const GenericEntityId* ids, size_t count,
+                                   const GenericTransformArrays& transforms);
+
+  /// Called when the user starts interactively editing an entity's transform
+  /// (e.g. dragging it with the mouse), after which SetEntityTransform() will
+  /// likely be called for it every frame until EndTransformEdit().
+  ///
+  /// Your entity system may use this to put off expensive work that follows a
+  /// transform change, such as updating physics, as long as it's done before
+  /// it's needed (e.g. by GetRayIntersection()) and by EndTransformEdit().
+  virtual void BeginTransformEdit(const GenericEntityId& id) { (void)id; }
+
+  /// Called when the user stops editing an entity's transform. The entity may
+  /// have been deleted in the meantime.
+  virtual void EndTransformEdit(const GenericEntityId& id) { (void)id; }
+
   /// Get a list of the entity's child entities (assuming a hierarchical scene).
   ///
   /// @return true if there were any number of children (including zero), or
@@ -207,6 +308,21 @@ class EntitySystemAdapter {
   virtual bool DuplicateEntity(const GenericEntityId& id,
                                GenericEntityId* new_id_output) = 0;
 
+  /// Create `offsets.size()` duplicates of the given entity at once, e.g. to
+  /// place an array of copies. Copy i has the original's transform moved by
+  /// offset i (see GenericTransform::Offset()). The new entities' IDs are
+  /// added to `new_ids_output`, in the same order as the offsets.
+  ///
+  /// The default implementation calls DuplicateEntity() and then
+  /// SetEntityTransform() for each copy; override this if your entity system
+  /// can create many copies more cheaply.
+  ///
+  /// @return true if every copy was made, or false if any couldn't be (in
+  /// which case the copies that were made are still listed).
+  virtual bool DuplicateEntities(const GenericEntityId& id,
+                                 const GenericTransformArrays& offsets,
+                                 std::vector<GenericEntityId>* new_ids_output);
+
   /// Create a new default/blank/empty entity, whatever that means to your
   /// system. Outputs the new entity ID.
   ///
@@ -287,6 +403,27 @@ class EntitySystemAdapter {
   /// Optional: A notice that you should refresh your cached entity ID list.
   virtual void RefreshEntityIDs() {}
 
+  /// Optional: Like RefreshEntityIDs(), but only the list of which entities
+  /// exist needs to be rebuilt; anything else you cache about entities that
+  /// are still there (e.g. their components) may be kept. Scene Lab calls this
+  /// before saving, so entities the game created or deleted are included.
+  ///
+  /// By default this calls RefreshEntityIDs().
+  virtual void RefreshEntityIDList() { RefreshEntityIDs(); }
+
+  /// Returned by GetEntityIDsGeneration() if the adapter doesn't track changes
+  /// to its list of entity IDs.
+  static const uint64_t kEntityIDsUntracked = 0;
+
+  /// Optional: Get a number that changes whenever the list returned by
+  /// GetAllEntityIDs() may have changed, including when RefreshEntityIDs() is
+  /// called. Callers can keep their own copy of the list, and only get it
+  /// again when this changes.
+  ///
+  /// If you don't track this, return kEntityIDsUntracked (the default), and
+  /// callers will get the whole list every time they need it.
+  virtual uint64_t GetEntityIDsGeneration() { return kEntityIDsUntracked; }
+
   /// If your system supports using prototypes, get a list of all of the
   /// prototype IDs in your entity system.
   ///
@@ -377,12 +514,29 @@ class EntitySystemAdapter {
   /// Override whatever file cache you are keeping for the given filename, with
   /// a new copy of the binary (Flatbuffer) file data. Subsequent reads your
   /// entity system performs from <filename> should actually return <data>.
+  ///
+  /// Scene Lab only hands the data over; it's up to your game to load entity
+  /// files through your cache, or edits that were only saved to the cache
+  /// (e.g. when Scene Lab is deactivated) are lost when a level is reloaded.
+  ///
+  /// Scene Lab calls UpdateFileCache() instead, which calls this by default.
+  /// Only override this if your cache needs its own copy of the data anyway.
   virtual void OverrideFileCache(const std::string& filename,
                                  const std::vector<uint8_t>& data) {
     (void)filename;
     (void)data;
   }
 
+  /// Like OverrideFileCache(), but shares the data rather than copying it. Your
+  /// cache can keep a reference to `data` for as long as it likes; Scene Lab
+  /// may still be writing it to disk on another thread, but never changes it.
+  ///
+  /// The default implementation passes a copy to OverrideFileCache().
+  virtual void UpdateFileCache(const std::string& filename,
+                               const SharedFileBuffer& data) {
+    if (data != nullptr) OverrideFileCache(filename, *data);
+  }
+
   /// Get a list of all components the given entity has.
   ///
   /// @return true if it set the component list, false if the entity was not
@@ -395,6 +549,19 @@ class EntitySystemAdapter {
   virtual void GetFullComponentList(
       std::vector<GenericComponentId>* components_out) = 0;
 
+  /// Get all of the entities that have every one of the given components, in
+  /// the same order as GetAllEntityIDs(). If `components` is empty, that's
+  /// every entity.
+  ///
+  /// The default implementation calls GetEntityComponentList() for every
+  /// entity; override this if your entity system can do better.
+  ///
+  /// @return true if it set the entity list, or false if it couldn't get the
+  /// list of entities.
+  virtual bool GetEntitiesWithComponents(
+      const std::vector<GenericComponentId>& components,
+      std::vector<GenericEntityId>* ids_out);
+
   /// Check whether the entity's data for a component is from its prototype.
   ///
   /// @return true if the entity's data for the given component comes
@@ -420,6 +587,45 @@ class EntitySystemAdapter {
   virtual bool DeserializeEntityComponent(const GenericEntityId& entity_id,
                                           const GenericComponentId& component,
                                           const uint8_t* data) = 0;
+
+  /// Forget the strings behind every entity and prototype ID this adapter has
+  /// handed out, e.g. after your game unloads a scene, so they don't use
+  /// memory for the rest of the program. Old IDs don't refer to anything
+  /// afterwards, so only call this while Scene Lab isn't active.
+  ///
+  /// If your adapter caches anything by entity ID, override this to clear
+  /// that too, and call this base version.
+  virtual void ClearEntityIds() { entity_id_table_.Clear(); }
+
+ protected:
+  /// Convert an entity or prototype ID string from your entity system into a
+  /// GenericEntityId, adding it to this adapter's table if needed. "" gives
+  /// kNoEntityId.
+  GenericEntityId EntityIdFromString(const std::string& str) const {
+    return entity_id_table_.Intern(str);
+  }
+  /// The string an entity or prototype ID was made from, or "" for
+  /// kNoEntityId or an ID from before ClearEntityIds().
+  const std::string& EntityIdString(const GenericEntityId& id) const {
+    return entity_id_table_.GetString(id);
+  }
+
+  /// Convert a component ID string into a GenericComponentId. Component IDs
+  /// are kept for the life of the adapter, so don't make them from an
+  /// unbounded set of strings. "" gives kNoComponentId.
+  GenericComponentId ComponentIdFromString(const std::string& str) const {
+    return component_id_table_.Intern(str);
+  }
+  /// The string a component ID was made from, or "" for kNoComponentId.
+  const std::string& ComponentIdString(const GenericComponentId& id) const {
+    return component_id_table_.GetString(id);
+  }
+
+ private:
+  // The strings behind the IDs this adapter has handed out. Mutable so that
+  // const lookups can convert IDs.
+  mutable InternedIdTable entity_id_table_;
+  mutable InternedIdTable component_id_table_;
 };
 
 }  // namespace scene_lab
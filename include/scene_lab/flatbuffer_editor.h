@@ -204,6 +204,9 @@ class FlatbufferEditor {
   /// @cond SCENELAB_INTERNAL
   FPL_DISALLOW_COPY_AND_ASSIGN(FlatbufferEditor);
 
+  // Lets scene_lab_benchmarks time the struct conversions directly.
+  friend class BenchmarkAccess;
+
   /// How VisitFlatbuffer* should traverse the table.
   /// kCheckEdits: Traverse and check if fields have changed, but don't commit
   /// any changes.
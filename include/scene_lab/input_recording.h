@@ -0,0 +1,181 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SCENE_LAB_INPUT_RECORDING_H_
+#define SCENE_LAB_INPUT_RECORDING_H_
+
+#include <stdint.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "editor_input_recording_generated.h"
+#include "scene_lab/editor_input.h"
+
+namespace scene_lab {
+
+/// @file
+/// Record the input Scene Lab reads during a session, and play it back later,
+/// e.g. to compare frame times across builds on exactly the same edits.
+///
+/// To record, wrap the usual input after initializing Scene Lab:
+///
+///     recorder = new RecordingEditorInput(std::unique_ptr<EditorInput>(
+///         new FplbaseEditorInput(input_system, renderer)));
+///     scene_lab->SetEditorInput(std::unique_ptr<EditorInput>(recorder));
+///     ...
+///     recorder->SaveRecording("session.slinput");
+///
+/// To play it back, run Scene Lab headless with a ReplayEditorInput:
+///
+///     replay = new ReplayEditorInput();
+///     replay->LoadRecording("session.slinput");
+///     scene_lab->InitializeHeadless(config, std::unique_ptr<EditorInput>(
+///         replay));
+///     scene_lab->Activate();
+///     while (!replay->finished()) {
+///       scene_lab->AdvanceFrame(replay->NextFrameDeltaSeconds());
+///     }
+///
+/// Only keys Scene Lab actually asks about are recorded, so a recording is
+/// only exact when played back through a build that reads the same keys.
+/// Edits made in the GUI aren't recorded, and pointer clicks on the GUI are
+/// played back as clicks in the world, so recorded sessions should stick to
+/// editing in the world itself.
+
+/// Version of the recording format written by RecordingEditorInput.
+static const uint32_t kInputRecordingVersion = 1;
+
+/// Passes input through from another EditorInput, recording every frame.
+class RecordingEditorInput : public EditorInput {
+ public:
+  /// Record input from `input`.
+  explicit RecordingEditorInput(std::unique_ptr<EditorInput> input);
+
+  /// The input being recorded.
+  EditorInput* wrapped() const { return wrapped_.get(); }
+
+  /// How many complete frames have been recorded.
+  size_t frame_count() const { return frames_.size(); }
+
+  /// Forget everything recorded so far and start again from the next frame.
+  void ClearRecording();
+
+  /// Write the frames recorded so far, including the one in progress, to a
+  /// file. Returns true on success.
+  bool SaveRecording(const std::string& filename) const;
+
+  virtual void Update();
+  virtual bool KeyIsDown(fplbase::FPL_Keycode key) const;
+  virtual bool KeyWentDown(fplbase::FPL_Keycode key) const;
+  virtual bool KeyWentUp(fplbase::FPL_Keycode key) const;
+  virtual bool PointerButtonIsDown(int button) const;
+  virtual mathfu::vec2 PointerPosition() const;
+  virtual mathfu::vec2 PointerDelta() const;
+  virtual mathfu::vec2i WindowSize() const;
+  virtual void SetRelativeMouseMode(bool relative);
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  /// Everything read from the wrapped input during one frame.
+  struct Frame {
+    Frame()
+        : delta_seconds(0),
+          pointer_buttons(0),
+          pointer_position(mathfu::kZeros2f),
+          pointer_delta(mathfu::kZeros2f),
+          window_size(mathfu::kZeros2i) {}
+    float delta_seconds;
+    uint16_t pointer_buttons;
+    mathfu::vec2 pointer_position;
+    mathfu::vec2 pointer_delta;
+    mathfu::vec2i window_size;
+    std::vector<RecordedKey> keys;
+  };
+
+  /// Look up a key in the wrapped input, and record it in the current frame
+  /// if this is the first time it's been asked about. Returns its state bits.
+  uint8_t ReadKey(fplbase::FPL_Keycode key) const;
+
+  std::unique_ptr<EditorInput> wrapped_;
+  std::vector<Frame> frames_;
+  // Keys are recorded as Scene Lab asks about them, from const methods.
+  mutable Frame frame_;
+  // Every key asked about this frame, whether or not it's in frame_.keys.
+  mutable std::vector<int> keys_read_;
+  // Has Update() been called since the recording started?
+  bool in_frame_;
+  Clock::time_point frame_start_;
+};
+
+/// Plays back input recorded by RecordingEditorInput, one frame per Update().
+/// After the last frame, every key and button reads as released.
+class ReplayEditorInput : public EditorInput {
+ public:
+  ReplayEditorInput() : next_frame_(0), frame_(nullptr), past_end_(false) {}
+
+  /// Load a recording from a file. Returns false if it couldn't be read or
+  /// isn't a valid recording.
+  bool LoadRecording(const std::string& filename);
+
+  /// Use recording data already in memory. Returns false if it isn't valid.
+  bool SetRecording(const std::string& data);
+
+  /// Number of frames in the recording.
+  size_t frame_count() const;
+
+  /// How many frames have been played back so far.
+  size_t frames_played() const { return next_frame_; }
+
+  /// Have all frames been played back?
+  bool finished() const { return next_frame_ >= frame_count(); }
+
+  /// Time the frame the next Update() will play took when it was recorded.
+  /// Pass this to SceneLab::AdvanceFrame() so the replay runs exactly as the
+  /// session was recorded.
+  double NextFrameDeltaSeconds() const;
+
+  /// Go back to the first frame.
+  void Rewind();
+
+  virtual void Update();
+  virtual bool KeyIsDown(fplbase::FPL_Keycode key) const;
+  virtual bool KeyWentDown(fplbase::FPL_Keycode key) const;
+  virtual bool KeyWentUp(fplbase::FPL_Keycode key) const;
+  virtual bool PointerButtonIsDown(int button) const;
+  virtual mathfu::vec2 PointerPosition() const;
+  virtual mathfu::vec2 PointerDelta() const;
+  virtual mathfu::vec2i WindowSize() const;
+  virtual void SetRelativeMouseMode(bool /*relative*/) {}
+
+ private:
+  /// State bits of a key in the current frame.
+  uint8_t KeyState(fplbase::FPL_Keycode key) const;
+
+  const InputRecording* recording() const {
+    return GetInputRecording(data_.c_str());
+  }
+
+  std::string data_;
+  size_t next_frame_;
+  // The frame being played, or null before the first. Once past the end this
+  // is the last frame, but only its pointer position is used.
+  const RecordedInputFrame* frame_;
+  bool past_end_;
+};
+
+}  // namespace scene_lab
+
+#endif  // SCENE_LAB_INPUT_RECORDING_H_
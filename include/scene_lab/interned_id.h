@@ -0,0 +1,128 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SCENE_LAB_INTERNED_ID_H_
+#define SCENE_LAB_INTERNED_ID_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace scene_lab {
+
+class InternedIdTable;
+
+/// @file
+/// A handle for a string ID: an index into the InternedIdTable that made it,
+/// so that copying, comparing and hashing IDs costs the same as doing so for
+/// an integer.
+///
+/// Only an InternedIdTable can turn a string into an InternedId or back, so
+/// the conversion happens in one place, usually an EntitySystemAdapter (see
+/// EntitySystemAdapter::EntityIdFromString()). IDs from different tables must
+/// not be mixed.
+class InternedId {
+ public:
+  /// The empty ID, which every table converts to and from "".
+  InternedId() : index_(0), generation_(0) {}
+
+  bool empty() const { return index_ == 0; }
+
+  /// A hash of the ID, which is constant-time to compute. It is only stable
+  /// within a single run of the program.
+  size_t hash() const {
+    return std::hash<uint64_t>()(static_cast<uint64_t>(generation_) << 32 |
+                                 index_);
+  }
+
+  friend bool operator==(const InternedId& a, const InternedId& b) {
+    return a.index_ == b.index_ && a.generation_ == b.generation_;
+  }
+  friend bool operator!=(const InternedId& a, const InternedId& b) {
+    return !(a == b);
+  }
+  /// Orders IDs by when they were interned, not by their strings, so that
+  /// they can be kept in ordered containers.
+  friend bool operator<(const InternedId& a, const InternedId& b) {
+    return a.generation_ != b.generation_ ? a.generation_ < b.generation_
+                                          : a.index_ < b.index_;
+  }
+
+ private:
+  friend class InternedIdTable;
+
+  InternedId(uint32_t index, uint32_t generation)
+      : index_(index), generation_(generation) {}
+
+  // 1 + the string's index in the table, or 0 for the empty ID.
+  uint32_t index_;
+  // The table's generation when this ID was made, so that IDs from before the
+  // table was cleared never match new ones.
+  uint32_t generation_;
+};
+
+/// Converts strings to InternedIds and back. Each distinct string is stored
+/// once, until Clear() is called.
+///
+/// This isn't thread-safe; each table should only be used by one thread at a
+/// time, like the adapter that owns it.
+class InternedIdTable {
+ public:
+  InternedIdTable() : generation_(1) {}
+
+  /// Get the ID for `str`, adding it to the table if it isn't there yet. ""
+  /// always gives the empty ID.
+  InternedId Intern(const std::string& str);
+
+  /// Get the ID for `str` if it's in the table, or the empty ID if not.
+  InternedId Find(const std::string& str) const;
+
+  /// The string an ID was made from. Returns "" for the empty ID, and for IDs
+  /// made by another table or before the last Clear(). The reference is valid
+  /// until the next Clear().
+  const std::string& GetString(const InternedId& id) const;
+
+  /// How many strings are in the table.
+  size_t size() const { return strings_.size(); }
+
+  /// Forget every string, and free the memory they use. IDs made before this
+  /// no longer refer to anything: GetString() returns "" for them, and they
+  /// never equal IDs made afterwards.
+  void Clear();
+
+ private:
+  // Each string, keyed to its ID's index. Keys never move, so strings_ can
+  // point at them.
+  std::unordered_map<std::string, uint32_t> indices_;
+  // The string for each index, starting from 1.
+  std::vector<const std::string*> strings_;
+  uint32_t generation_;
+};
+
+}  // namespace scene_lab
+
+namespace std {
+
+/// Allows InternedId to be used as a key in unordered containers.
+template <>
+struct hash<scene_lab::InternedId> {
+  size_t operator()(const scene_lab::InternedId& id) const { return id.hash(); }
+};
+
+}  // namespace std
+
+#endif  // SCENE_LAB_INTERNED_ID_H_
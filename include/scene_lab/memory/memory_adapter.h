@@ -0,0 +1,450 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SCENE_LAB_MEMORY_MEMORY_ADAPTER_H_
+#define SCENE_LAB_MEMORY_MEMORY_ADAPTER_H_
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "flatbuffers/flatbuffers.h"
+#include "flatbuffers/reflection.h"
+#include "mathfu/glsl_mappings.h"
+#include "scene_lab/entity_system_adapter.h"
+
+namespace scene_lab_memory {
+
+/// @file
+/// MemoryAdapter is an entity system that lives entirely in memory, with no
+/// renderer, physics or assets. It's for testing and benchmarking Scene Lab's
+/// own logic on machines that can't run a real game, and as a reference for
+/// writing your own adapter.
+///
+/// Entity files are read and written using the FlatBuffers binary schema you
+/// give it, which must be laid out like the sample's components.fbs: a root
+/// table with a vector of entity tables, each with a vector of tables holding
+/// a union of every component's table. Two components are understood rather
+/// than just stored:
+/// * corgi.MetaDef: `entity_id` is the entity's ID, and `prototype` the
+///   prototype it was made from.
+/// * corgi.TransformDef: `position`, `orientation` (Euler angles in degrees,
+///   or a quaternion if it has 4 elements) and `scale` make up the transform,
+///   relative to the entity's parent, and `child_ids` its children.
+/// Other fields of those components aren't kept. All other components are
+/// kept as they were loaded or last edited.
+///
+/// Ray intersections are found by testing every entity's bounding box, which
+/// is a unit cube around its origin unless set with SetEntityBounds().
+///
+/// For MemoryAdapter:
+/// * GenericEntityId is the entity_id in the entity's corgi.MetaDef.
+/// * GenericComponentId is the name of the component's table in the schema,
+///   e.g. "corgi.TransformDef".
+/// Entity IDs are freed by Clear(), so a long run that keeps making scenes
+/// doesn't use more and more memory for them.
+class MemoryAdapter : public scene_lab::EntitySystemAdapter {
+ public:
+  // Allow these to be easily accessed from this namespace.
+  typedef scene_lab::GenericEntityId GenericEntityId;
+  typedef scene_lab::GenericComponentId GenericComponentId;
+  typedef scene_lab::GenericPrototypeId GenericPrototypeId;
+  typedef scene_lab::GenericCamera GenericCamera;
+  typedef scene_lab::GenericTransform GenericTransform;
+  typedef scene_lab::ViewportSettings ViewportSettings;
+  typedef scene_lab::SharedFileBuffer SharedFileBuffer;
+
+  /// Options for generating a scene with CreateScene().
+  struct SceneOptions {
+    SceneOptions()
+        : entity_count(1000),
+          file_count(1),
+          components_per_entity(2),
+          child_fraction(0.25f),
+          max_depth(0),
+          max_children(0),
+          prototype_fraction(0.0f),
+          extent(100.0f),
+          seed(1) {}
+
+    /// How many entities to create.
+    size_t entity_count;
+    /// How many entity files to spread the entities across.
+    size_t file_count;
+    /// How many components each entity has, other than its meta data and
+    /// transform. They're taken in turn from `components`. Their data is
+    /// copied from the component templates, if any have been loaded for
+    /// them (see LoadComponentTemplatesFromMemory()), or otherwise has all
+    /// fields left at their defaults.
+    size_t components_per_entity;
+    /// Names of the component tables to give entities, e.g.
+    /// "corgi.RenderMeshDef". If empty, every component in the schema other
+    /// than the meta data and transform is used, or only those that have
+    /// templates if any templates have been loaded.
+    std::vector<std::string> components;
+    /// Roughly what fraction of the entities are children of another.
+    float child_fraction;
+    /// How many levels of parents an entity can have, or 0 for no limit.
+    size_t max_depth;
+    /// How many children an entity can have, or 0 for no limit.
+    size_t max_children;
+    /// Roughly what fraction of the entities are made from a prototype,
+    /// chosen at random from those loaded or created. These entities get
+    /// all their components, other than meta data and transform, from their
+    /// prototype.
+    float prototype_fraction;
+    /// Entities are placed within this distance of the origin on each axis.
+    float extent;
+    /// Seed for the random numbers, so the same options give the same scene.
+    uint32_t seed;
+  };
+
+  MemoryAdapter();
+  virtual ~MemoryAdapter() {}
+
+  /// Use the given binary (.bfbs) and text (.fbs) schemas for entity data.
+  /// The text schema is optional; without it, Scene Lab can only export JSON
+  /// if it has the binary schema. Returns false if the binary schema isn't
+  /// laid out as described above.
+  bool SetSchema(const std::string& binary_schema,
+                 const std::string& text_schema);
+
+  /// Load the schemas with SetSchema() from files. `text_schema_file` may be
+  /// empty.
+  bool LoadSchema(const std::string& binary_schema_file,
+                  const std::string& text_schema_file);
+
+  /// Load a FlatBuffer entity list as prototypes, keyed by their entity IDs,
+  /// for CreateEntityFromPrototype() and for entities that name a prototype.
+  /// Returns the number of prototypes loaded.
+  ///
+  /// `entity_list` is checked with a flatbuffers::Verifier first, so `size`
+  /// must be its length in bytes; nothing is loaded if it's invalid. The same
+  /// goes for the other *FromMemory() functions.
+  int LoadPrototypesFromMemory(const uint8_t* entity_list, size_t size);
+
+  /// Load a FlatBuffer entity list, adding its entities to the scene as if
+  /// they were loaded from `source_file` (without the file extension). Any
+  /// entity whose ID is missing or already taken is given a new one. The
+  /// new entities' IDs are added to `ids_out` if it's not null. Returns the
+  /// number of entities loaded.
+  int LoadEntitiesFromMemory(const uint8_t* entity_list, size_t size,
+                             const std::string& source_file,
+                             std::vector<GenericEntityId>* ids_out);
+
+  /// Load an entity file with LoadEntitiesFromMemory(), from the file cache if
+  /// Scene Lab has saved it, or from disk if not.
+  int LoadEntitiesFromFile(const std::string& filename,
+                           std::vector<GenericEntityId>* ids_out);
+
+  /// Use the components of the entities in a FlatBuffer entity list, e.g.
+  /// one of the game's real entity files, as templates for the components
+  /// CreateScene() and CreatePrototypes() make up. Without them, generated
+  /// components have every field at its default, e.g. meshes with no mesh,
+  /// so scenes cost much less to save, load and render than real ones. Each
+  /// kind of component cycles through the templates found for it. Returns
+  /// the number of templates read.
+  int LoadComponentTemplatesFromMemory(const uint8_t* entity_list,
+                                       size_t size);
+
+  /// Load component templates from an entity file. Returns the number read,
+  /// or 0 if the file couldn't be loaded.
+  int LoadComponentTemplatesFromFile(const std::string& filename);
+
+  /// Add `options.entity_count` new entities to the scene, with made up
+  /// transforms, hierarchy and component data. The entities are put in files
+  /// named "generated_0", "generated_1", etc. Their IDs are added to `ids_out`
+  /// if it's not null. Returns false if no schema has been set or a
+  /// component in `options` isn't in it.
+  bool CreateScene(const SceneOptions& options,
+                   std::vector<GenericEntityId>* ids_out);
+
+  /// Add `count` new prototypes, named "prototype_0", "prototype_1", etc.,
+  /// each with `options.components_per_entity` components taken in turn from
+  /// `options.components`. Their IDs are added to `ids_out` if it's not null.
+  /// Returns false if no schema has been set or a component isn't in it.
+  bool CreatePrototypes(size_t count, const SceneOptions& options,
+                        std::vector<GenericPrototypeId>* ids_out);
+
+  /// Serialize every prototype as an entity list, in the order they were
+  /// loaded or created, e.g. to save as the game's entity library.
+  bool SerializePrototypes(std::vector<uint8_t>* buffer_out);
+
+  /// Remove every entity, and free their IDs. Prototypes are kept, but get
+  /// new IDs.
+  void Clear();
+
+  /// Entities are found by their IDs, so this calls Clear().
+  virtual void ClearEntityIds() { Clear(); }
+
+  /// Set the box an entity is hit by rays in, relative to its transform.
+  bool SetEntityBounds(const GenericEntityId& id, const mathfu::vec3& min,
+                       const mathfu::vec3& max);
+
+  /// Get an entity's transform in world space, taking its parents into
+  /// account.
+  bool GetEntityWorldTransform(const GenericEntityId& id,
+                               GenericTransform* transform_output) const;
+
+  /// Is this entity highlighted, i.e. selected in Scene Lab?
+  bool IsEntityHighlighted(const GenericEntityId& id) const;
+
+  /// Number of entities in the scene.
+  size_t entity_count() const { return entity_ids_.size(); }
+
+  void set_viewport_settings(const ViewportSettings& viewport) {
+    viewport_ = viewport;
+  }
+
+  virtual bool EntityExists(const GenericEntityId& id);
+
+  virtual bool GetEntityTransform(const GenericEntityId& id,
+                                  GenericTransform* transform_output);
+
+  virtual bool SetEntityTransform(const GenericEntityId& id,
+                                  const GenericTransform& transform);
+
+  virtual bool GetEntityChildren(const GenericEntityId& id,
+                                 std::vector<GenericEntityId>* children_out);
+
+  virtual bool GetEntityParent(const GenericEntityId& id,
+                               GenericEntityId* parent_out);
+
+  virtual bool SetEntityParent(const GenericEntityId& child,
+                               const GenericEntityId& parent);
+
+  virtual bool GetCamera(GenericCamera* camera);
+
+  virtual bool SetCamera(const GenericCamera& camera);
+
+  virtual bool GetViewportSettings(ViewportSettings* viewport);
+
+  /// The copy has the same parent as the original, but no children.
+  virtual bool DuplicateEntity(const GenericEntityId& id,
+                               GenericEntityId* new_id_output);
+
+  virtual bool CreateEntity(GenericEntityId* new_id_output);
+
+  virtual bool CreateEntityFromPrototype(const GenericPrototypeId& prototype,
+                                         GenericEntityId* new_id_output);
+
+  /// The entity's children are left without a parent.
+  virtual bool DeleteEntity(const GenericEntityId& id);
+
+  virtual bool SetEntityHighlighted(const GenericEntityId& id,
+                                    bool is_highlighted);
+
+  virtual bool GetRayIntersection(const mathfu::vec3& start_point,
+                                  const mathfu::vec3& direction,
+                                  GenericEntityId* entity_output,
+                                  mathfu::vec3* intersection_point_output);
+
+  virtual bool CycleEntities(int direction, GenericEntityId* next_entity);
+
+  virtual bool GetAllEntityIDs(std::vector<GenericEntityId>* ids_out);
+
+  virtual uint64_t GetEntityIDsGeneration() { return entity_ids_generation_; }
+
+  virtual bool GetAllPrototypeIDs(std::vector<GenericPrototypeId>* ids_out);
+
+  virtual bool GetEntityName(const GenericEntityId& id, std::string* name_out);
+
+  /// The description is the entity's prototype, if it has one.
+  virtual bool GetEntityDescription(const GenericEntityId& id,
+                                    std::string* description_out);
+
+  virtual bool GetEntitySourceFile(const GenericEntityId& id,
+                                   std::string* source_file_out);
+
+  virtual bool GetSchema(const reflection::Schema** schema_out);
+
+  virtual bool GetTextSchema(std::string* schema_out);
+
+  virtual bool GetTableObject(const GenericComponentId& id,
+                              const reflection::Object** table_out);
+
+  virtual bool GetTableName(const GenericComponentId& id,
+                            std::string* name_out);
+
+  virtual bool SerializeEntities(const std::vector<GenericEntityId>& id,
+                                 std::vector<uint8_t>* buffer_out);
+
+  virtual void OverrideFileCache(const std::string& filename,
+                                 const std::vector<uint8_t>& data);
+
+  virtual void UpdateFileCache(const std::string& filename,
+                               const SharedFileBuffer& data);
+
+  virtual bool GetEntityComponentList(
+      const GenericEntityId& id,
+      std::vector<GenericComponentId>* components_out);
+
+  virtual void GetFullComponentList(
+      std::vector<GenericComponentId>* components_out);
+
+  virtual bool IsEntityComponentFromPrototype(
+      const GenericEntityId& entity, const GenericComponentId& component);
+
+  virtual bool SerializeEntityComponent(const GenericEntityId& entity_id,
+                                        const GenericComponentId& component,
+                                        flatbuffers::unique_ptr_t* data_out);
+
+  virtual bool DeserializeEntityComponent(const GenericEntityId& entity_id,
+                                          const GenericComponentId& component,
+                                          const uint8_t* data);
+
+ private:
+  /// A component other than the meta data or transform.
+  struct Component {
+    Component() : from_prototype(false) {}
+    GenericComponentId id;
+    /// A FlatBuffer with the component's table as its root.
+    std::vector<uint8_t> data;
+    /// Was this copied unchanged from the entity's prototype?
+    bool from_prototype;
+  };
+
+  struct Entity {
+    Entity();
+    GenericEntityId id;
+    GenericPrototypeId prototype;
+    std::string source_file;
+    GenericEntityId parent;
+    std::vector<GenericEntityId> children;
+    bool has_transform;
+    /// Relative to the parent, if there is one.
+    GenericTransform transform;
+    mathfu::vec3 bounds_min;
+    mathfu::vec3 bounds_max;
+    bool highlighted;
+    std::vector<Component> components;
+  };
+
+  /// A component table in the schema's component union.
+  struct ComponentType {
+    GenericComponentId id;
+    const reflection::Object* object;
+    uint8_t union_type;
+  };
+
+  static const int kNoComponentType = -1;
+
+  Entity* GetEntity(const GenericEntityId& id);
+  const Entity* GetEntity(const GenericEntityId& id) const;
+
+  /// Get the index in component_types_ of a component, or kNoComponentType.
+  int GetComponentType(const GenericComponentId& id) const;
+
+  /// Get the indices in component_types_ of the components `options` says
+  /// to give generated entities. Returns false if one isn't in the schema.
+  bool GetGeneratedComponentTypes(const SceneOptions& options,
+                                  std::vector<int>* types_out) const;
+
+  /// Give a generated entity or prototype `count` components, taken in turn
+  /// from `types` starting at `first`, copying their data from the component
+  /// templates if there are any.
+  void AddGeneratedComponents(const std::vector<int>& types, size_t first,
+                              size_t count, Entity* entity) const;
+
+  /// Write entities to an entity list FlatBuffer in `builder_`, and copy it
+  /// to `buffer_out`.
+  bool SerializeEntityList(const std::vector<const Entity*>& entities,
+                           std::vector<uint8_t>* buffer_out);
+
+  /// Make up an entity ID that isn't in use yet.
+  GenericEntityId NewEntityId();
+
+  /// Add a new entity to the scene, giving it a new ID if it doesn't have one
+  /// or its ID is taken.
+  Entity* AddEntity(Entity* entity);
+
+  /// Give an entity a new ID, updating everything that refers to it.
+  void RenameEntity(const GenericEntityId& old_id,
+                    const GenericEntityId& new_id);
+
+  /// Remove `child` from its parent's list of children.
+  void DetachFromParent(Entity* child);
+
+  /// Read entities from a FlatBuffer entity list of `size` bytes, after
+  /// verifying it against the schema. Each entity's child IDs are added to the
+  /// matching element of `child_ids_out`.
+  bool ReadEntityList(const uint8_t* entity_list, size_t size,
+                      std::vector<Entity>* out,
+                      std::vector<std::vector<std::string>>* child_ids_out);
+
+  /// Give an entity copies of any of its prototype's components that it
+  /// doesn't have itself.
+  void ApplyPrototype(Entity* entity) const;
+
+  /// Read a corgi.MetaDef or corgi.TransformDef table into `entity`.
+  void ReadMeta(const flatbuffers::Table& table, Entity* entity) const;
+  void ReadTransform(const flatbuffers::Table& table, Entity* entity,
+                     std::vector<std::string>* child_ids) const;
+
+  /// Write an entity's meta data or transform to `builder` as a table, and
+  /// return its offset.
+  flatbuffers::uoffset_t WriteMeta(const Entity& entity,
+                                   flatbuffers::FlatBufferBuilder* builder);
+  flatbuffers::uoffset_t WriteTransform(
+      const Entity& entity, flatbuffers::FlatBufferBuilder* builder);
+
+  /// Write one component of an entity to `builder` as a table, and return
+  /// its offset, or 0 if the entity doesn't have the component.
+  flatbuffers::uoffset_t WriteComponent(
+      const Entity& entity, int component_type,
+      flatbuffers::FlatBufferBuilder* builder);
+
+  void InvalidateEntityIDs() { entity_ids_generation_++; }
+
+  // Schema data, and where to find things in it. Set up by SetSchema().
+  std::string schema_data_;
+  std::string schema_text_;
+  const reflection::Schema* schema_;
+  const reflection::Field* entity_list_field_;
+  const reflection::Object* entity_object_;
+  const reflection::Field* component_list_field_;
+  const reflection::Object* instance_object_;
+  const reflection::Field* data_field_;
+  const reflection::Field* data_type_field_;
+  std::vector<ComponentType> component_types_;
+  // Data to give generated components, by index in component_types_. Set by
+  // LoadComponentTemplatesFromMemory(); empty for components without any.
+  std::vector<std::vector<std::vector<uint8_t>>> component_templates_;
+  int meta_type_;
+  int transform_type_;
+
+  std::unordered_map<GenericEntityId, Entity> entities_;
+  // Every entity's ID, in the order they were added.
+  std::vector<GenericEntityId> entity_ids_;
+  uint64_t entity_ids_generation_;
+  uint64_t next_entity_number_;
+  size_t cycle_index_;
+
+  // Prototypes by ID, and their IDs in the order they were loaded.
+  std::unordered_map<GenericPrototypeId, Entity> prototypes_;
+  std::vector<GenericPrototypeId> prototype_ids_;
+
+  // Latest saved contents of each entity file, by filename (with extension).
+  std::unordered_map<std::string, SharedFileBuffer> file_cache_;
+
+  // Reused by SerializeEntities().
+  flatbuffers::FlatBufferBuilder builder_;
+
+  GenericCamera camera_;
+  ViewportSettings viewport_;
+};
+
+}  // namespace scene_lab_memory
+
+#endif  // SCENE_LAB_MEMORY_MEMORY_ADAPTER_H_
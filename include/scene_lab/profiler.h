@@ -0,0 +1,131 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SCENE_LAB_PROFILER_H_
+#define SCENE_LAB_PROFILER_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include "fplbase/fpl_common.h"
+
+namespace scene_lab {
+
+/// @file
+/// A lightweight profiler for finding editor hitches. Scene Lab marks the
+/// code that runs each frame (AdvanceFrame, Render, drawing the GUI, saving,
+/// and every adapter call made through a ProfilingEntitySystemAdapter) with
+/// timing zones. While the profiler is enabled, each zone is recorded into a
+/// ring buffer belonging to the thread it ran on, and the most recent zones
+/// on every thread can be written out as a Chrome trace whenever you like:
+///
+///     Profiler::SetEnabled(true);
+///     ...
+///     Profiler::WriteChromeTrace("scene_lab.trace.json");
+///
+/// Load the file in chrome://tracing (or any viewer that reads the Chrome
+/// trace_event format) to see each frame's zones on a timeline.
+///
+/// While the profiler is disabled, which is the default, a zone costs one
+/// relaxed atomic load. Define SCENE_LAB_DISABLE_PROFILER (or set the CMake
+/// option scene_lab_disable_profiler) to compile the zones out entirely.
+class Profiler {
+ public:
+  /// How many zones each thread keeps. Once a thread's buffer is full, each
+  /// new zone replaces its oldest one.
+  static const size_t kZonesPerThread = 16384;
+
+  /// Most threads whose zones are kept. After that many threads have
+  /// recorded zones, each new thread takes over the buffer of the thread that
+  /// exited longest ago, losing its zones. If none have exited, the new
+  /// thread doesn't record zones.
+  static const size_t kMaxThreads = 16;
+
+  /// Is the profiler recording zones?
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  /// Start or stop recording zones. Zones already recorded are kept.
+  static void SetEnabled(bool enabled);
+
+  /// Forget every zone recorded so far.
+  static void Clear();
+
+  /// Name the calling thread in traces. By default, threads are named in the
+  /// order they first record a zone.
+  static void SetThreadName(const std::string& name);
+
+  /// Get every zone still held, on every thread, as Chrome trace_event JSON.
+  static std::string GetChromeTrace();
+
+  /// Write GetChromeTrace() to a file. Returns true if it was written.
+  static bool WriteChromeTrace(const std::string& filename);
+
+  /// Record a zone on the calling thread. `name` and `category` must be
+  /// string literals, or otherwise outlive the profiler, as only the
+  /// pointers are kept. Times are from Now().
+  static void RecordZone(const char* name, const char* category,
+                         int64_t start_ns, int64_t end_ns);
+
+  /// The current time, in nanoseconds, as used for zones.
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+ private:
+  static std::atomic<bool> enabled_;
+};
+
+/// Times its scope as a zone, if the profiler is enabled when it's created.
+/// Usually used through SCENE_LAB_PROFILE_ZONE().
+class ProfileZone {
+ public:
+  /// `name` and `category` must be string literals; see RecordZone().
+  explicit ProfileZone(const char* name, const char* category = "scene_lab")
+      : name_(Profiler::enabled() ? name : nullptr),
+        category_(category),
+        start_ns_(name_ != nullptr ? Profiler::Now() : 0) {}
+  ~ProfileZone() {
+    if (name_ != nullptr) {
+      Profiler::RecordZone(name_, category_, start_ns_, Profiler::Now());
+    }
+  }
+
+ private:
+  FPL_DISALLOW_COPY_AND_ASSIGN(ProfileZone);
+
+  // Null if the profiler was disabled when the zone started.
+  const char* name_;
+  const char* category_;
+  int64_t start_ns_;
+};
+
+}  // namespace scene_lab
+
+#define SCENE_LAB_PROFILE_CONCAT_INNER(a, b) a##b
+#define SCENE_LAB_PROFILE_CONCAT(a, b) SCENE_LAB_PROFILE_CONCAT_INNER(a, b)
+
+/// Time the rest of the enclosing scope as a zone called `name`, which must
+/// be a string literal.
+#if defined(SCENE_LAB_DISABLE_PROFILER)
+#define SCENE_LAB_PROFILE_ZONE(name)
+#else
+#define SCENE_LAB_PROFILE_ZONE(name)                                 \
+  ::scene_lab::ProfileZone SCENE_LAB_PROFILE_CONCAT(scene_lab_zone_, \
+                                                    __LINE__)(name)
+#endif  // defined(SCENE_LAB_DISABLE_PROFILER)
+
+#endif  // SCENE_LAB_PROFILER_H_
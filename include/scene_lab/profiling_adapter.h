@@ -0,0 +1,293 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SCENE_LAB_PROFILING_ADAPTER_H_
+#define SCENE_LAB_PROFILING_ADAPTER_H_
+
+#include <stdint.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "scene_lab/entity_system_adapter.h"
+#include "scene_lab/profiler.h"
+
+namespace scene_lab {
+
+/// @file
+/// An EntitySystemAdapter that passes every call through to another adapter,
+/// timing each one, so you can see which calls take up the editor's time. To
+/// use it, wrap your adapter before giving it to Scene Lab:
+///
+///     std::unique_ptr<EntitySystemAdapter> adapter(new MyAdapter(...));
+///     profiler = new ProfilingEntitySystemAdapter(std::move(adapter));
+///     scene_lab->SetEntitySystemAdapter(
+///         std::unique_ptr<EntitySystemAdapter>(profiler));
+///
+/// Only calls made through this adapter are counted, so if your adapter's
+/// methods call each other, the time is counted against the outer call.
+///
+/// A "frame" here runs from one AdvanceFrame() call to the next.
+///
+/// While the Profiler is enabled, each call is also recorded as a zone in the
+/// "adapter" category, so it shows up within Scene Lab's own zones in traces.
+///
+/// Like other adapters, this must only be called from one thread at a time.
+class ProfilingEntitySystemAdapter : public EntitySystemAdapter {
+ public:
+  /// The calls that are timed: one for each EntitySystemAdapter method.
+  enum Call {
+    kAdvanceFrame,
+    kRender,
+    kOnActivate,
+    kOnDeactivate,
+    kOnEntityUpdated,
+    kOnEntityCreated,
+    kOnEntityDeleted,
+    kEntityExists,
+    kGetEntityTransform,
+    kSetEntityTransform,
+    kGetEntityTransforms,
+    kSetEntityTransforms,
+    kBeginTransformEdit,
+    kEndTransformEdit,
+    kGetEntityChildren,
+    kGetEntityParent,
+    kSetEntityParent,
+    kGetCamera,
+    kSetCamera,
+    kGetViewportSettings,
+    kDuplicateEntity,
+    kDuplicateEntities,
+    kCreateEntity,
+    kCreateEntityFromPrototype,
+    kDeleteEntity,
+    kSetEntityHighlighted,
+    kDebugDrawPhysics,
+    kGetRayIntersection,
+    kCycleEntities,
+    kGetAllEntityIDs,
+    kRefreshEntityIDs,
+    kRefreshEntityIDList,
+    kGetEntityIDsGeneration,
+    kGetAllPrototypeIDs,
+    kRefreshPrototypeIDs,
+    kGetEntityName,
+    kGetEntityDescription,
+    kFilterShowEntityID,
+    kGetEntitySourceFile,
+    kGetSchema,
+    kGetTextSchema,
+    kGetTableObject,
+    kGetTableName,
+    kSerializeEntities,
+    kOverrideFileCache,
+    kUpdateFileCache,
+    kGetEntityComponentList,
+    kGetFullComponentList,
+    kGetEntitiesWithComponents,
+    kIsEntityComponentFromPrototype,
+    kSerializeEntityComponent,
+    kDeserializeEntityComponent,
+    kClearEntityIds,
+    kCallCount
+  };
+
+  /// Number of buckets in CallStats::frame_histogram.
+  static const int kHistogramBuckets = 16;
+
+  /// Everything measured about one kind of call.
+  struct CallStats {
+    CallStats();
+
+    /// How many times the call was made.
+    uint64_t count;
+    /// Total, shortest and longest time taken by a single call.
+    double total_seconds;
+    double min_seconds;
+    double max_seconds;
+    /// How many frames the call took up a given amount of time in, adding up
+    /// all of the calls in each frame. Bucket 0 counts frames with less than
+    /// 1 microsecond; each bucket after that up to twice as long as the one
+    /// before (see HistogramBucketLimit()), and the last bucket all frames
+    /// longer than that. Frames where the call wasn't made aren't counted.
+    uint64_t frame_histogram[kHistogramBuckets];
+  };
+
+  /// Profile `wrapped`, which receives every call made to this adapter.
+  explicit ProfilingEntitySystemAdapter(
+      std::unique_ptr<EntitySystemAdapter> wrapped);
+  virtual ~ProfilingEntitySystemAdapter() {}
+
+  /// The adapter being profiled.
+  EntitySystemAdapter* wrapped() const { return wrapped_.get(); }
+
+  /// Get the stats so far for one kind of call.
+  const CallStats& stats(Call call) const { return stats_[call]; }
+
+  /// How many frames have been completed since the stats were last reset.
+  uint64_t frame_count() const { return frame_count_; }
+
+  /// The name of a call, e.g. "GetEntityTransform".
+  static const char* CallName(Call call);
+
+  /// The upper limit, in seconds, of the time counted in a histogram bucket.
+  /// The last bucket has no limit.
+  static double HistogramBucketLimit(int bucket);
+
+  /// Forget all stats so far, e.g. to measure just one editing session.
+  void ResetStats();
+
+  /// Log the stats of every call that has been made, slowest total first.
+  void LogStats() const;
+
+  /// Write the stats of every call that has been made to a CSV file, with
+  /// one row per call. Returns true if the file was written.
+  bool WriteStatsFile(const std::string& filename) const;
+
+  virtual void AdvanceFrame(double delta_seconds);
+  virtual void Render();
+  virtual void OnActivate();
+  virtual void OnDeactivate();
+  virtual void OnEntityUpdated(const GenericEntityId& id);
+  virtual void OnEntityCreated(const GenericEntityId& id);
+  virtual void OnEntityDeleted(const GenericEntityId& id);
+  virtual bool EntityExists(const GenericEntityId& id);
+  virtual bool GetEntityTransform(const GenericEntityId& id,
+                                  GenericTransform* transform_output);
+  virtual bool SetEntityTransform(const GenericEntityId& id,
+                                  const GenericTransform& transform);
+  virtual bool GetEntityTransforms(const GenericEntityId* ids, size_t count,
+                                   GenericTransformArrays* transforms_output);
+  virtual bool SetEntityTransforms(const GenericEntityId* ids, size_t count,
+                                   const GenericTransformArrays& transforms);
+  virtual void BeginTransformEdit(const GenericEntityId& id);
+  virtual void EndTransformEdit(const GenericEntityId& id);
+  virtual bool GetEntityChildren(const GenericEntityId& id,
+                                 std::vector<GenericEntityId>* children_out);
+  virtual bool GetEntityParent(const GenericEntityId& id,
+                               GenericEntityId* parent_out);
+  virtual bool SetEntityParent(const GenericEntityId& child,
+                               const GenericEntityId& parent);
+  virtual bool GetCamera(GenericCamera* camera);
+  virtual bool SetCamera(const GenericCamera& camera);
+  virtual bool GetViewportSettings(ViewportSettings* viewport);
+  virtual bool DuplicateEntity(const GenericEntityId& id,
+                               GenericEntityId* new_id_output);
+  virtual bool DuplicateEntities(const GenericEntityId& id,
+                                 const GenericTransformArrays& offsets,
+                                 std::vector<GenericEntityId>* new_ids_output);
+  virtual bool CreateEntity(GenericEntityId* new_id_output);
+  virtual bool CreateEntityFromPrototype(const GenericPrototypeId& prototype,
+                                         GenericEntityId* new_id_output);
+  virtual bool DeleteEntity(const GenericEntityId& id);
+  virtual bool SetEntityHighlighted(const GenericEntityId& id,
+                                    bool is_highlighted);
+  virtual bool DebugDrawPhysics(const GenericEntityId& id);
+  virtual bool GetRayIntersection(const mathfu::vec3& start_point,
+                                  const mathfu::vec3& direction_normalized,
+                                  GenericEntityId* entity_output,
+                                  mathfu::vec3* intersection_point_output);
+  virtual bool CycleEntities(int direction, GenericEntityId* next_entity);
+  virtual bool GetAllEntityIDs(std::vector<GenericEntityId>* ids_out);
+  virtual void RefreshEntityIDs();
+  virtual void RefreshEntityIDList();
+  virtual uint64_t GetEntityIDsGeneration();
+  virtual bool GetAllPrototypeIDs(std::vector<GenericPrototypeId>* ids_out);
+  virtual void RefreshPrototypeIDs();
+  virtual bool GetEntityName(const GenericEntityId& id, std::string* name_out);
+  virtual bool GetEntityDescription(const GenericEntityId& id,
+                                    std::string* description_out);
+  virtual bool FilterShowEntityID(const GenericEntityId& id,
+                                  const std::string& filter);
+  virtual bool GetEntitySourceFile(const GenericEntityId& id,
+                                   std::string* source_file_out);
+  virtual bool GetSchema(const reflection::Schema** schema_out);
+  virtual bool GetTextSchema(std::string* schema_out);
+  virtual bool GetTableObject(const GenericComponentId& id,
+                              const reflection::Object** table_out);
+  virtual bool GetTableName(const GenericComponentId& id,
+                            std::string* name_out);
+  virtual bool SerializeEntities(const std::vector<GenericEntityId>& id,
+                                 std::vector<uint8_t>* buffer_out);
+  virtual void OverrideFileCache(const std::string& filename,
+                                 const std::vector<uint8_t>& data);
+  virtual void UpdateFileCache(const std::string& filename,
+                               const SharedFileBuffer& data);
+  virtual bool GetEntityComponentList(
+      const GenericEntityId& id,
+      std::vector<GenericComponentId>* components_out);
+  virtual void GetFullComponentList(
+      std::vector<GenericComponentId>* components_out);
+  virtual bool GetEntitiesWithComponents(
+      const std::vector<GenericComponentId>& components,
+      std::vector<GenericEntityId>* ids_out);
+  virtual bool IsEntityComponentFromPrototype(
+      const GenericEntityId& entity, const GenericComponentId& component);
+  virtual bool SerializeEntityComponent(const GenericEntityId& entity_id,
+                                        const GenericComponentId& component,
+                                        flatbuffers::unique_ptr_t* data_out);
+  virtual bool DeserializeEntityComponent(const GenericEntityId& entity_id,
+                                          const GenericComponentId& component,
+                                          const uint8_t* data);
+  virtual void ClearEntityIds();
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  /// Times a call from construction to destruction.
+  class ScopedCall {
+   public:
+    ScopedCall(ProfilingEntitySystemAdapter* profiler, Call call)
+        : profiler_(profiler),
+          call_(call),
+          start_(Clock::now())
+#if !defined(SCENE_LAB_DISABLE_PROFILER)
+          ,
+          zone_(CallName(call), "adapter")
+#endif  // !defined(SCENE_LAB_DISABLE_PROFILER)
+    {
+    }
+    ~ScopedCall() {
+      profiler_->RecordCall(
+          call_, std::chrono::duration<double>(Clock::now() - start_).count());
+    }
+
+   private:
+    ProfilingEntitySystemAdapter* profiler_;
+    Call call_;
+    Clock::time_point start_;
+#if !defined(SCENE_LAB_DISABLE_PROFILER)
+    ProfileZone zone_;
+#endif  // !defined(SCENE_LAB_DISABLE_PROFILER)
+  };
+
+  void RecordCall(Call call, double seconds);
+
+  /// Add the time spent in each call this frame to the histograms.
+  void EndFrame();
+
+  std::unique_ptr<EntitySystemAdapter> wrapped_;
+  CallStats stats_[kCallCount];
+  // Time spent in each call so far this frame, and whether it was made.
+  double frame_seconds_[kCallCount];
+  bool frame_called_[kCallCount];
+  uint64_t frame_count_;
+  // Has AdvanceFrame() been called yet, i.e. have we started a frame?
+  bool in_frame_;
+};
+
+}  // namespace scene_lab
+
+#endif  // SCENE_LAB_PROFILING_ADAPTER_H_
@@ -16,10 +16,16 @@
 #define SCENE_LAB_SCENE_LAB_H_
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include "flatbuffers/idl.h"
 #include "flatui/flatui.h"
 #include "fplbase/asset_manager.h"
 #include "fplbase/input.h"
@@ -28,17 +34,147 @@
 #include "mathfu/vector.h"
 #include "scene_lab/editor_controller.h"
 #include "scene_lab/editor_gui.h"
+#include "scene_lab/editor_input.h"
 #include "scene_lab/entity_system_adapter.h"
+#include "scene_lab/util.h"
+#include "scene_lab/worker_pool.h"
 #include "scene_lab_config_generated.h"
 
 namespace scene_lab {
 
 typedef std::function<void(const GenericEntityId& entity)> EntityCallback;
 typedef std::function<void()> EditorCallback;
+/// Called with a batch of `count` entities, e.g. all those created in a frame.
+typedef std::function<void(const GenericEntityId* entities, size_t count)>
+    EntityBatchCallback;
+
+/// The outcome of saving a single entity file, as part of a SaveSceneReport.
+struct EntityFileSaveResult {
+  EntityFileSaveResult()
+      : entity_count(0),
+        serialized(false),
+        binary_written(false),
+        json_written(false),
+        binary_unchanged(false),
+        json_unchanged(false),
+        serialize_seconds(0),
+        binary_write_seconds(0),
+        json_generate_seconds(0),
+        json_write_seconds(0) {}
+
+  /// Entity file name, without the file extension.
+  std::string filename;
+  /// How many entities were saved into this file.
+  size_t entity_count;
+  /// Did the entity system adapter serialize the entities successfully?
+  bool serialized;
+  /// Was the binary file written to disk?
+  bool binary_written;
+  /// Was the JSON file written to disk?
+  bool json_written;
+  /// Was writing the binary file skipped, because it already had the same
+  /// contents on disk?
+  bool binary_unchanged;
+  /// Was writing the JSON file skipped, because it already had the same
+  /// contents on disk?
+  bool json_unchanged;
+  /// If anything went wrong, a description of what it was.
+  std::string error;
+  /// Time spent in the entity system adapter serializing the entities.
+  double serialize_seconds;
+  /// Time spent writing the binary file.
+  double binary_write_seconds;
+  /// Time spent converting the binary data to JSON text.
+  double json_generate_seconds;
+  /// Time spent writing the JSON file.
+  double json_write_seconds;
+};
+
+/// A summary of the most recent call to SaveScene().
+struct SaveSceneReport {
+  SaveSceneReport()
+      : success(false),
+        to_disk(false),
+        worker_threads(0),
+        total_seconds(0),
+        files_skipped(0),
+        writes_done(0),
+        writes_skipped(0) {}
+
+  /// True if every file was serialized and (when saving to disk) written.
+  bool success;
+  /// Was this save written to disk, or only to the file cache?
+  bool to_disk;
+  /// How many worker threads wrote files, or 0 if it was all done inline.
+  int worker_threads;
+  /// Wall clock time for the whole save.
+  double total_seconds;
+  /// How many entity files were left alone because nothing in them changed.
+  size_t files_skipped;
+  /// How many .bin and .json files were written to disk.
+  size_t writes_done;
+  /// How many .bin and .json file writes were skipped because the file on
+  /// disk already had exactly the same contents.
+  size_t writes_skipped;
+  /// One entry per entity file, in no particular order.
+  std::vector<EntityFileSaveResult> files;
+};
+
+typedef std::function<void(size_t files_finished, size_t files_total)>
+    SaveProgressCallback;
+typedef std::function<void(const SaveSceneReport& report)>
+    SaveCompleteCallback;
+
+class SceneLab;
+
+/// A save that may still be writing files in the background. Returned by
+/// SceneLab::SaveSceneAsync().
+///
+/// The entity data is serialized when the save starts, so later edits don't
+/// affect what gets written. All of these accessors are meant to be called
+/// from the thread that owns Scene Lab.
+class SceneSave {
+ public:
+  SceneSave() : files_finished_(0), files_reported_(0), done_(false) {}
+
+  /// Returns true once every file has been written and the report is final.
+  bool done() const { return done_; }
+
+  /// How many files have been written (or failed to write) so far.
+  size_t files_finished() const { return files_finished_; }
+
+  /// How many files this save is writing in total.
+  size_t files_total() const { return report_.files.size(); }
+
+  /// The results of this save. Only valid once done() returns true.
+  const SaveSceneReport& report() const { return report_; }
+
+ private:
+  friend class SceneLab;
+
+  SaveSceneReport report_;
+  // Serialized entity data for each file in report_.files, in the same order.
+  // Shared with the entity system's file cache.
+  std::vector<SharedFileBuffer> buffers_;
+  // Incremented by whichever thread finishes writing each file.
+  std::atomic<size_t> files_finished_;
+  // Main thread only: the files_finished() value last sent to on_progress_.
+  size_t files_reported_;
+  bool done_;
+  std::chrono::steady_clock::time_point start_time_;
+  SaveProgressCallback on_progress_;
+  SaveCompleteCallback on_complete_;
+};
+
+typedef std::shared_ptr<SceneSave> SceneSaveHandle;
 
 /// @file
 class SceneLab {
  public:
+  /// Waits for any asynchronous save to finish, calling its callbacks, and
+  /// stops the save worker threads before anything they use is destroyed.
+  ~SceneLab();
+
   /// Initialize Scene Lab once, when starting your game.
   ///
   /// Call this function as soon as you have an entity manager and font
@@ -48,6 +184,48 @@ class SceneLab {
                   fplbase::InputSystem* input, fplbase::Renderer* renderer,
                   flatui::FontManager* font_manager);
 
+  /// Initialize Scene Lab to run headless, with no window, renderer, fonts
+  /// or GUI, taking its input from `input` instead, e.g. a
+  /// ScriptedEditorInput. Use this instead of the other Initialize() for
+  /// batch processing and automated tests.
+  ///
+  /// Everything but the GUI works as normal: AdvanceFrame() handles input,
+  /// selection, dragging and notifications, and SaveScene() saves. Render()
+  /// does nothing.
+  void InitializeHeadless(const SceneLabConfig* config,
+                          std::unique_ptr<EditorInput> input);
+
+  /// Is Scene Lab running without a GUI? See InitializeHeadless().
+  bool headless() const { return gui_ == nullptr; }
+
+  /// What dragging the selected entity with the mouse does.
+  enum MouseMode {
+    kMoveHorizontal,    // Move along the ground.
+    kMoveVertical,      // Move along a plane perpendicular to the ground and
+                        // perpendicular to the camera.
+    kRotateHorizontal,  // Rotate horizontally--that is, about an axis
+                        // perpendicular to the ground.
+    kRotateVertical,    // Rotate vertically--that is, about an axis parallel to
+                        // the ground that points back towards the camera.
+    kScaleAll,          // Scale on all axes as you drag up and down.
+    kScaleX,            // Scale on the X axis as you drag along the ground.
+    kScaleY,            // Scale on the Y axis as you drag along the ground.
+    kScaleZ,            // Scale on the Z axis as you drag up and down.
+    kMouseModeCount
+  };
+
+  /// The current mouse mode.
+  MouseMode mouse_mode() const { return mouse_mode_; }
+
+  /// Change the mouse mode, as picking one in the GUI's toolbar does. This is
+  /// how headless runs (e.g. from a ScriptedEditorInput) rotate and scale
+  /// entities. Ignored while an entity is being dragged.
+  void set_mouse_mode(MouseMode mode) {
+    if (input_mode_ == kDragging || mode >= kMouseModeCount) return;
+    mouse_mode_ = mode;
+    if (!headless()) gui_->set_mouse_mode_index(mode);
+  }
+
   /// Set which entity system adapter to use.
   void SetEntitySystemAdapter(std::unique_ptr<EntitySystemAdapter> adapter);
 
@@ -60,6 +238,7 @@ class SceneLab {
   void AdvanceFrame(double delta_time_seconds);
 
   /// Render Scene Lab and its GUI; only call this when Scene Lab is active.
+  /// Does nothing when headless.
   ///
   /// While Scene Lab is running, you are still responsible for rendering your
   /// own game world. Call GetCamera() to get the camera you should use for
@@ -106,6 +285,14 @@ class SceneLab {
   ///
   /// If you are saving to disk, entities will be saved to the files they were
   /// initially loaded from.
+  ///
+  /// Only files containing entities that were modified since the last save
+  /// (see MarkEntityModified()) are serialized and written.
+  ///
+  /// If the config's save_worker_threads is nonzero, JSON conversion and file
+  /// writes are done on a pool of worker threads, but this function still
+  /// waits for them to finish before returning. Call last_save_report() to
+  /// see how each file fared.
   bool SaveScene(bool to_disk);
 
   /// Save the current positions and properties to disk.
@@ -113,6 +300,36 @@ class SceneLab {
   /// See SaveScene(bool to_disk) for more details.
   void SaveScene() { SaveScene(true); }
 
+  /// Start saving the scene without waiting for the files to be written.
+  ///
+  /// Modified entities are serialized (and the file cache updated) right
+  /// away, but JSON conversion and file writes happen on a background thread.
+  /// While the save is in progress, `on_progress` is called from
+  /// AdvanceFrame() as files finish, and `on_complete` is called from
+  /// AdvanceFrame() once they are all done. Either callback may be empty.
+  ///
+  /// Only one save runs at a time; starting another save (or calling
+  /// SaveScene) first waits for the previous one to finish. Deactivate() also
+  /// waits, and IsReadyToExit() returns false while a save is in progress.
+  SceneSaveHandle SaveSceneAsync(bool to_disk,
+                                 const SaveProgressCallback& on_progress,
+                                 const SaveCompleteCallback& on_complete);
+
+  /// Write out JSON versions of every entity file, converted from the binary
+  /// files on disk. Use this when the config's export_json_on_save is false
+  /// (so that saving only writes binary files) to bring the JSON files up to
+  /// date; call SaveScene(true) first to include any unsaved changes.
+  ///
+  /// Uses the save worker threads, if any, and waits for them to finish.
+  /// Returns true if every file was exported successfully.
+  bool ExportJson();
+
+  /// Returns true if an asynchronous save is still writing files.
+  bool save_in_progress() const { return pending_save_ != nullptr; }
+
+  /// Block until any asynchronous save has finished, and call its callbacks.
+  void WaitForPendingSave();
+
   /// Request that Scene Lab exit.
   ///
   /// If you haven't saved your changes, it will prompt you to do so, keep them
@@ -127,20 +344,43 @@ class SceneLab {
   void AbortExit();
 
   /// Returns true if we are ready to exit Scene Lab (everything is saved or
-  /// discarded, etc), or false if not. Once it returns true, you can safely
-  /// deactivate the editor.
+  /// discarded, and no save is still being written), or false if not. Once it
+  /// returns true, you can safely deactivate the editor.
   bool IsReadyToExit();
 
   /// Externally mark that some entities have been modified.
   ///
-  /// Generally used by Scene Lab's GUI, but if you change an entity's
-  /// properties some other way, call this function to ensure the user will be
-  /// prompted to save on exiting the editor.
-  void set_entities_modified(bool b) { entities_modified_ = b; }
+  /// If you change an entity's properties outside of Scene Lab, call this
+  /// function to ensure the user will be prompted to save on exiting the
+  /// editor. Since Scene Lab doesn't know which entities you changed, this
+  /// marks every file as needing to be saved; prefer MarkEntityModified() if
+  /// you know which entity it was.
+  void set_entities_modified(bool b) {
+    entities_modified_ = b;
+    if (b) MarkAllFilesModified();
+  }
+
+  /// Mark that the given entity has been modified, so the file it belongs to
+  /// will be saved by the next SaveScene().
+  void MarkEntityModified(const GenericEntityId& entity);
+
+  /// Mark that the given entity file needs to be saved by the next
+  /// SaveScene(), e.g. because an entity was moved out of it.
+  void MarkFileModified(const std::string& filename);
+
+  /// Mark that every entity file needs to be saved by the next SaveScene().
+  void MarkAllFilesModified();
+
+  /// Get the name of the file the given entity will be saved to (without file
+  /// extension), or an empty string if the entity system adapter doesn't know.
+  std::string GetEntitySaveFile(const GenericEntityId& entity);
 
   /// Have entities been modified? If so, prompt the user to save before exit.
   bool entities_modified() const { return entities_modified_; }
 
+  /// Get the results of the most recent SaveScene() call.
+  const SaveSceneReport& last_save_report() const { return last_save_report_; }
+
   /// Specify a callback to call when the editor is opened.
   void AddOnEnterEditorCallback(EditorCallback callback);
 
@@ -156,32 +396,71 @@ class SceneLab {
   /// Specify a callback to call when an entity is deleted.
   void AddOnDeleteEntityCallback(EntityCallback callback);
 
+  /// Specify a callback to call once a frame with all the entities created
+  /// that frame (see DispatchEntityEvents()). If an entity is created and
+  /// deleted in the same frame, it's in neither batch.
+  ///
+  /// Prefer these batch callbacks to the single entity ones if you have work
+  /// to do for each change, as entities may change many times per frame.
+  void AddOnCreateEntitiesCallback(EntityBatchCallback callback);
+
+  /// Specify a callback to call once a frame with all the entities updated
+  /// that frame, other than those that were also created or deleted. Each
+  /// entity is listed once, however many times it was updated.
+  void AddOnUpdateEntitiesCallback(EntityBatchCallback callback);
+
+  /// Specify a callback to call once a frame with all the entities deleted
+  /// that frame. They may no longer exist by the time this is called.
+  void AddOnDeleteEntitiesCallback(EntityBatchCallback callback);
+
+  /// Call the batch callbacks for all entities created, updated or deleted
+  /// since they were last called, so that each is told about each entity at
+  /// most once. Deletions are dispatched first, then creations, then updates.
+  ///
+  /// This is called at the end of AdvanceFrame() and when Scene Lab is
+  /// deactivated, but you can call it yourself if you need listeners to
+  /// catch up sooner.
+  void DispatchEntityEvents();
+
   /// Call all 'EditorEnter' callbacks.
   void NotifyEnterEditor() const;
 
   /// Call all 'EditorExit' callbacks.
   void NotifyExitEditor() const;
 
-  /// Call all 'EntityCreated' callbacks.
-  void NotifyCreateEntity(const GenericEntityId& entity) const;
+  /// Call all 'EntityCreated' callbacks, queue the entity for the batch
+  /// callbacks, and mark the entity as modified.
+  void NotifyCreateEntity(const GenericEntityId& entity);
 
-  /// Call all 'EntityUpdated' callbacks.
-  void NotifyUpdateEntity(const GenericEntityId& entity) const;
+  /// Call all 'EntityUpdated' callbacks, queue the entity for the batch
+  /// callbacks, and mark the entity as modified.
+  void NotifyUpdateEntity(const GenericEntityId& entity);
 
-  /// Call all 'EntityDeleted' callbacks.
-  void NotifyDeleteEntity(const GenericEntityId& entity) const;
+  /// Call all 'EntityDeleted' callbacks, queue the entity for the batch
+  /// callbacks, and mark the entity's file as modified. Call this before
+  /// actually deleting the entity.
+  void NotifyDeleteEntity(const GenericEntityId& entity);
 
   const std::string& version() { return version_; }
 
   /// Config accessor, so you can access config options.
   const SceneLabConfig* config() { return config_; }
 
-  /// GUI accessor, so you can poke into the EditorGui.
+  /// GUI accessor, so you can poke into the EditorGui. Null when headless.
   EditorGui* gui() { return gui_.get(); }
 
+  /// Where Scene Lab is reading input from.
+  EditorInput* editor_input() const { return editor_input_.get(); }
+
+  /// Read input from `input` from now on, e.g. a RecordingEditorInput.
+  void SetEditorInput(std::unique_ptr<EditorInput> input);
+
   MATHFU_DEFINE_CLASS_SIMD_AWARE_NEW_DELETE
 
  private:
+  // Lets scene_lab_benchmarks time the picking math directly.
+  friend class BenchmarkAccess;
+
   /// String which identifies the current version of Scene Lab.
   ///
   /// kVersion is used by Google developers to identify which applications
@@ -194,20 +473,6 @@ class SceneLab {
   static const char kVersion[];
 
   enum InputMode { kMoving, kEditing, kDragging };
-  enum MouseMode {
-    kMoveHorizontal,    // Move along the ground.
-    kMoveVertical,      // Move along a plane perpendicular to the ground and
-                        // perpendicular to the camera.
-    kRotateHorizontal,  // Rotate horizontally--that is, about an axis
-                        // perpendicular to the ground.
-    kRotateVertical,    // Rotate vertically--that is, about an axis parallel to
-                        // the ground that points back towards the camera.
-    kScaleAll,          // Scale on all axes as you drag up and down.
-    kScaleX,            // Scale on the X axis as you drag along the ground.
-    kScaleY,            // Scale on the Y axis as you drag along the ground.
-    kScaleZ,            // Scale on the Z axis as you drag up and down.
-    kMouseModeCount
-  };
 
   // return true if we should be moving the camera and objects slowly.
   bool PreciseMovement() const;
@@ -223,6 +488,15 @@ class SceneLab {
   // returns true if the transform was modified
   bool ModifyTransformBasedOnInput(GenericTransform* transform);
 
+  /// Tell the entity system which entity's transform is being edited: the
+  /// selected entity if we're dragging it, or none. Call this whenever the
+  /// input mode or selected entity changes.
+  void UpdateTransformEdit();
+
+  /// Record that something happened to an entity, for the batch callbacks.
+  /// `event` is one of the kEntity*Event flags in scene_lab.cpp.
+  void QueueEntityEvent(const GenericEntityId& entity, unsigned int event);
+
   /// Find the intersection between a ray and a plane.
   /// Ensure ray_direction and plane_normal are both normalized.
   /// Returns true if it intersects with the plane, and sets the
@@ -250,19 +524,101 @@ class SceneLab {
   /// importing and exporting of entity data.
   void LoadSchemaFiles();
 
+  /// Get a Flatbuffers parser that has already parsed the entity system's
+  /// text schema, for converting entity data to JSON. The parser is cached
+  /// between saves, and the schema is only re-parsed if the text returned by
+  /// GetTextSchema() changes. Returns nullptr if there is no text schema or if
+  /// it could not be parsed.
+  const flatbuffers::Parser* GetTextSchemaParser();
+
+  /// Get the schemas to export JSON with: the text schema parser from
+  /// GetTextSchemaParser(), and the adapter's binary schema if it's usable.
+  /// Either or both may be set to null.
+  void GetJsonExportSchemas(const flatbuffers::Parser** text_schema,
+                            const reflection::Schema** binary_schema);
+
+  /// Serialize all modified entity files, update the file cache, and start
+  /// writing the files to disk (if `to_disk` is true). Files are written on
+  /// the save worker pool if `use_workers` is true, or immediately otherwise.
+  SceneSaveHandle StartSave(bool to_disk, bool use_workers);
+
+  /// Once all of a save's files are written, finish off its report, log it,
+  /// and call its completion callback.
+  void FinishSave(SceneSave* save);
+
+  /// Send progress to the pending save's callbacks, and finish it off if it's
+  /// done. Called once a frame.
+  void UpdatePendingSave();
+
   /// Actually write the binary data for a group of entities to the given file.
-  /// Also converts the Flatbuffers data to JSON if possible (i.e. if schemas
-  /// are laoded) and saves to text.
+  /// Also converts the Flatbuffers data to JSON if possible (i.e. if
+  /// `text_schema_parser` is not null) and saves to text. Outcomes and timings
+  /// are stored in `result` rather than logged.
+  ///
+  /// If `binary_schema` is not null, the JSON is streamed to disk with an
+  /// EntityJsonWriter rather than generated into memory first.
   ///
-  /// Called by SaveScene() when saving to disk.
+  /// Files whose contents on disk are already identical are not rewritten,
+  /// and JSON isn't regenerated if the binary data it came from is unchanged.
+  ///
+  /// Called by SaveScene() when saving to disk. This may be run on a worker
+  /// thread, so it must not touch the entity system adapter, and may only
+  /// touch the file hashes while holding file_hashes_mutex_.
   void WriteEntityFile(const std::string& filename,
-                       const std::vector<uint8_t>& data);
+                       const std::vector<uint8_t>& data,
+                       const flatbuffers::Parser* text_schema_parser,
+                       const reflection::Schema* binary_schema,
+                       EntityFileSaveResult* result);
+
+  /// Write the JSON version of an entity file's data, whose HashBytes() is
+  /// `binary_hash`, skipping it if the JSON file is already up to date. Used
+  /// by WriteEntityFile() and ExportJson(), with the same threading rules.
+  void WriteEntityJsonFile(const std::string& filename, const uint8_t* data,
+                           uint64_t binary_hash,
+                           const flatbuffers::Parser* text_schema_parser,
+                           const reflection::Schema* binary_schema,
+                           EntityFileSaveResult* result);
+
+  /// Returns true if the file at `path` is known to have contents with the
+  /// given hash. The first time a path is checked, or if the file's size or
+  /// modified time has changed since, the existing file (if any) is loaded
+  /// from disk and hashed. Thread-safe.
+  bool FileContentsMatch(const std::string& path, uint64_t hash);
+
+  /// Get the hash of the file at `path`, if we know it and the file hasn't
+  /// changed on disk since. If it has, forget what we knew about it.
+  /// Thread-safe.
+  bool GetKnownFileHash(const std::string& path, uint64_t* hash_out);
+
+  /// Record the hash of what was just written to `path`, along with its size
+  /// and modified time. Thread-safe.
+  void SetFileHash(const std::string& path, uint64_t hash);
+
+  /// Log the per-file results of a save.
+  static void LogSaveReport(const SaveSceneReport& report);
 
   /// Get a pointer to the file extension to use for binary files. Default is
   /// ".bin" but can be overridden in the scene lab config. The output does NOT
   /// include the ".".
   const char* BinaryEntityFileExtension() const;
 
+  /// Set up everything the GUI and headless modes have in common.
+  void InitializeEditor(const SceneLabConfig* config,
+                        std::unique_ptr<EditorInput> input);
+
+  /// GUI state, with the answer to use when there's no GUI.
+  bool GuiInputCaptured() const {
+    return gui_ != nullptr && gui_->InputCaptured();
+  }
+  bool GuiCanDeselectEntity() const {
+    return gui_ == nullptr || gui_->CanDeselectEntity();
+  }
+  bool GuiCanExit() { return gui_ == nullptr || gui_->CanExit(); }
+  bool GuiLockCameraHeight() const {
+    return gui_ != nullptr ? gui_->lock_camera_height()
+                           : config_->camera_movement_parallel_to_ground();
+  }
+
   const SceneLabConfig* config_;
   std::unique_ptr<EntitySystemAdapter> entity_system_adapter_;
 
@@ -270,8 +626,11 @@ class SceneLab {
   fplbase::Renderer* renderer_;
   fplbase::InputSystem* input_system_;
   flatui::FontManager* font_manager_;
+  std::unique_ptr<EditorInput> editor_input_;
   // Which entity are we currently editing?
   GenericEntityId selected_entity_;
+  // Which entity is the entity system told we're dragging, if any?
+  GenericEntityId transform_edit_entity_;
 
   InputMode input_mode_;
   MouseMode mouse_mode_;
@@ -303,6 +662,50 @@ class SceneLab {
   std::vector<EntityCallback> on_create_entity_callbacks_;
   std::vector<EntityCallback> on_update_entity_callbacks_;
   std::vector<EntityCallback> on_delete_entity_callbacks_;
+  std::vector<EntityBatchCallback> on_create_entities_callbacks_;
+  std::vector<EntityBatchCallback> on_update_entities_callbacks_;
+  std::vector<EntityBatchCallback> on_delete_entities_callbacks_;
+
+  // Entity events waiting for DispatchEntityEvents(): each entity in the order
+  // it was first queued, and the combined event flags for each.
+  std::vector<GenericEntityId> queued_entities_;
+  std::unordered_map<GenericEntityId, unsigned int> queued_entity_events_;
+
+  // Parsed text schema, kept around so we don't re-parse it for every file we
+  // export to JSON. See GetTextSchemaParser().
+  std::unique_ptr<flatbuffers::Parser> text_schema_parser_;
+  // The schema text that text_schema_parser_ was created from.
+  std::string text_schema_parser_source_;
+  // Did text_schema_parser_ successfully parse text_schema_parser_source_?
+  bool text_schema_parser_valid_;
+
+  // Worker threads for writing files during SaveScene(), created on first use
+  // if the config asks for them.
+  std::unique_ptr<WorkerPool> save_workers_;
+
+  // Entity files that have changed since they were last saved to disk, or to
+  // the entity system's file cache.
+  std::unordered_set<std::string> files_modified_since_disk_save_;
+  std::unordered_set<std::string> files_modified_since_cache_save_;
+  // Set when we don't know which files changed, so all of them must be saved.
+  bool all_files_modified_since_disk_save_;
+  bool all_files_modified_since_cache_save_;
+  SaveSceneReport last_save_report_;
+  // An asynchronous save that is still writing files, if any.
+  SceneSaveHandle pending_save_;
+
+  // Guards file_hashes_ and json_source_hashes_, which save workers use.
+  std::mutex file_hashes_mutex_;
+  // Hash of the contents of each file we've written or checked on disk, and
+  // its size and modified time then, so we notice if anything else changes it.
+  struct FileHash {
+    uint64_t hash;
+    FileStamp stamp;
+  };
+  std::unordered_map<std::string, FileHash> file_hashes_;
+  // For each JSON file, hash of the binary data it was generated from, using
+  // the current text schema.
+  std::unordered_map<std::string, uint64_t> json_source_hashes_;
 
  protected:
   std::string version_;  // Keep a reference to the version string.
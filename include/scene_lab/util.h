@@ -16,6 +16,8 @@
 #ifndef SCENE_LAB_UTIL_H
 #define SCENE_LAB_UTIL_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include <functional>
 #include <string>
 #include <unordered_map>
@@ -69,6 +71,56 @@ time_t LoadAssetsIfNewer(time_t threshold, const std::string& directory,
                          const std::string& file_extension,
                          const AssetLoader::load_function_t& load_function);
 
+/// The size and last modified time of a file, for noticing when something
+/// else has changed it.
+struct FileStamp {
+  FileStamp() : size(0), modified_time(0) {}
+  uint64_t size;
+  time_t modified_time;
+};
+
+inline bool operator==(const FileStamp& a, const FileStamp& b) {
+  return a.size == b.size && a.modified_time == b.modified_time;
+}
+inline bool operator!=(const FileStamp& a, const FileStamp& b) {
+  return !(a == b);
+}
+
+/// Get the size and last modified time of a file. Returns false if there's
+/// no such file.
+bool GetFileStamp(const std::string& path, FileStamp* stamp_out);
+
+/// Compute a fast 64-bit hash of a block of memory, for quickly checking
+/// whether file contents have changed. This is the XXH64 algorithm, so the
+/// results match other xxHash implementations given the same seed.
+///
+/// Not suitable for anything security related.
+uint64_t HashBytes(const void* data, size_t length, uint64_t seed = 0);
+
+/// Compute the same hash as HashBytes(), for data that arrives in pieces.
+class IncrementalHash {
+ public:
+  explicit IncrementalHash(uint64_t seed = 0);
+
+  /// Add more data to the hash.
+  void Update(const void* data, size_t length);
+
+  /// Get the hash of all data added so far. More data can still be added
+  /// afterwards.
+  uint64_t Finish() const;
+
+ private:
+  static const size_t kStripeSize = 32;
+
+  void ProcessStripe(const uint8_t* stripe);
+
+  uint64_t seed_;
+  uint64_t v1_, v2_, v3_, v4_;
+  uint64_t total_length_;
+  uint8_t buffer_[kStripeSize];
+  size_t buffered_;
+};
+
 }  // namespace scene_lab
 
 #endif  // SCENE_LAB_UTIL_H
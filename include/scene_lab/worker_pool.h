@@ -0,0 +1,77 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SCENE_LAB_WORKER_POOL_H_
+#define SCENE_LAB_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace scene_lab {
+
+/// @file
+/// A small fixed-size pool of worker threads, used by Scene Lab to do file
+/// I/O and other slow work off of the main thread.
+///
+/// Tasks are started in the order they are added, on whichever worker thread
+/// becomes free first. Tasks must not touch the entity system adapter, as
+/// adapters are only ever called from the thread that owns Scene Lab.
+class WorkerPool {
+ public:
+  typedef std::function<void()> Task;
+
+  /// Start up the given number of worker threads (at least one).
+  explicit WorkerPool(int num_threads);
+
+  /// Finish running all queued tasks, then shut down the worker threads.
+  ~WorkerPool();
+
+  /// Queue up a task to be run on a worker thread.
+  void AddTask(const Task& task);
+
+  /// Block until every task that has been added so far has finished running.
+  void WaitForAllTasks();
+
+  /// Returns true if there are no queued or running tasks.
+  bool IsIdle();
+
+  /// How many worker threads are in this pool.
+  int num_threads() const { return static_cast<int>(threads_.size()); }
+
+ private:
+  WorkerPool(const WorkerPool&);
+  WorkerPool& operator=(const WorkerPool&);
+
+  /// Main loop for each worker thread.
+  void RunWorker();
+
+  std::vector<std::thread> threads_;
+  std::deque<Task> tasks_;
+  std::mutex mutex_;
+  // Signaled when a task is added or when we are shutting down.
+  std::condition_variable task_added_;
+  // Signaled when the last queued or running task finishes.
+  std::condition_variable all_tasks_finished_;
+  // Number of tasks that workers have taken off the queue but not finished.
+  int tasks_running_;
+  bool shutting_down_;
+};
+
+}  // namespace scene_lab
+
+#endif  // SCENE_LAB_WORKER_POOL_H_
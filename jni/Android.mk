@@ -56,12 +56,20 @@ LOCAL_SRC_FILES := \
   src/basic_camera.cpp \
   src/editor_controller.cpp \
   src/editor_gui.cpp \
+  src/editor_input.cpp \
+  src/entity_json_writer.cpp \
   src/entity_system_adapter.cpp \
   src/flatbuffer_editor.cpp \
+  src/input_recording.cpp \
+  src/interned_id.cpp \
+  src/profiler.cpp \
+  src/profiling_adapter.cpp \
   src/scene_lab.cpp \
   src/util.cpp \
+  src/worker_pool.cpp \
   src/corgi/corgi_adapter.cpp \
-  src/corgi/edit_options.cpp
+  src/corgi/edit_options.cpp \
+  src/memory/memory_adapter.cpp
 
 SCENE_LAB_SCHEMA_DIR := $(SCENE_LAB_DIR)/schemas
 SCENE_LAB_SCHEMA_INCLUDE_DIRS := \
@@ -71,6 +79,7 @@ SCENE_LAB_SCHEMA_INCLUDE_DIRS := \
 
 SCENE_LAB_SCHEMA_FILES := \
   $(SCENE_LAB_SCHEMA_DIR)/editor_components.fbs \
+  $(SCENE_LAB_SCHEMA_DIR)/editor_input_recording.fbs \
   $(SCENE_LAB_SCHEMA_DIR)/flatbuffer_editor_config.fbs \
   $(SCENE_LAB_SCHEMA_DIR)/scene_lab_config.fbs
 
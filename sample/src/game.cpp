@@ -114,7 +114,10 @@ bool Game::Initialize(const char* const binary_directory) {
 
   entity_factory_->SetFlatbufferSchema(kComponentDefBinarySchema);
   entity_factory_->AddEntityLibrary(kEntityLibraryFile);
-  entity_factory_->LoadEntitiesFromFile(kEntityListFile, &entity_manager_);
+  // Load the level through the adapter rather than the EntityFactory, so that
+  // if it's reloaded after editing, the edits are picked up from Scene Lab's
+  // file cache.
+  corgi_adapter()->LoadEntitiesFromFile(kEntityListFile, nullptr);
 
   input_.SetRelativeMouseMode(true);
   input_.AdvanceFrame(&renderer_.window_size());
@@ -14,12 +14,14 @@
 
 #include "scene_lab/corgi/corgi_adapter.h"
 
+#include <algorithm>
 #include <string>
 #include "corgi_component_library/common_services.h"
 #include "corgi_component_library/meta.h"
 #include "corgi_component_library/physics.h"
 #include "corgi_component_library/rendermesh.h"
 #include "corgi_component_library/transform.h"
+#include "flatbuffers/util.h"
 #include "mathfu/glsl_mappings.h"
 #include "scene_lab/basic_camera.h"
 #include "scene_lab/corgi/edit_options.h"
@@ -39,11 +41,22 @@ using scene_lab::SceneLab;
 using scene_lab::GenericEntityId;
 using scene_lab::GenericComponentId;
 
+// Most buffers SerializeEntities() keeps for reuse, and the largest one it
+// keeps, so one big file or entity doesn't pin its memory until deactivation.
+static const size_t kMaxPooledEntityBuffers = 1024;
+static const size_t kMaxPooledEntityBufferSize = 64 * 1024;
+
 CorgiAdapter::CorgiAdapter(SceneLab* scene_lab,
                            corgi::EntityManager* entity_manager)
     : scene_lab_(scene_lab),
       entity_manager_(entity_manager),
-      entity_cycler_(entity_manager->begin()) {
+      entity_cycler_(entity_manager->begin()),
+      component_mask_words_(0),
+      component_mask_count_(0),
+      component_masks_valid_(false),
+      entity_ids_valid_(false),
+      entity_ids_generation_(kEntityIDsUntracked + 1),
+      entity_deletion_pending_(false) {
   auto services = entity_manager_->GetComponent<CommonServicesComponent>();
   renderer_ = services->renderer();
   entity_factory_ = services->entity_factory();
@@ -72,10 +85,12 @@ CorgiAdapter::CorgiAdapter(SceneLab* scene_lab,
     fplbase::LogInfo("CorgiAdapter: Text schema %s loaded", schema_file_text);
   }
 
-  scene_lab_->gui()->SetShowComponentDataView(
-      GetGenericComponentId(MetaComponent::GetComponentId()), true);
-  scene_lab_->gui()->SetShowComponentDataView(
-      GetGenericComponentId(TransformComponent::GetComponentId()), true);
+  if (!scene_lab_->headless()) {
+    scene_lab_->gui()->SetShowComponentDataView(
+        GetGenericComponentId(MetaComponent::GetComponentId()), true);
+    scene_lab_->gui()->SetShowComponentDataView(
+        GetGenericComponentId(TransformComponent::GetComponentId()), true);
+  }
 
   AddComponentToUpdate(TransformComponent::GetComponentId());
 }
@@ -96,9 +111,18 @@ void CorgiAdapter::AdvanceFrame(double delta_seconds) {
   }
 
   entity_manager_->DeleteMarkedEntities();
+  if (entity_deletion_pending_) {
+    entity_deletion_pending_ = false;
+    InvalidateEntityIDs();
+  }
+  // Components may have created, deleted or renamed entities this frame.
+  ClearEntityRefCache();
 }
 
 void CorgiAdapter::OnActivate() {
+  // The game may have created or deleted entities, or changed their
+  // components, since we were last active.
+  RefreshEntityIDs();
   if (camera_ == nullptr) {
     CreateDefaultCamera();
   }
@@ -115,6 +139,13 @@ void CorgiAdapter::OnActivate() {
 }
 
 void CorgiAdapter::OnDeactivate() {
+  // The game will expect physics to match the transforms.
+  transform_edits_.clear();
+  UpdateStalePhysics();
+
+  // Don't hold on to serialization buffers while the game is running.
+  std::vector<std::vector<uint8_t>>().swap(entity_buffer_pool_);
+
   // Restore previous distance culling setting.
   auto render_mesh_component =
       entity_manager_->GetComponent<RenderMeshComponent>();
@@ -135,9 +166,10 @@ bool CorgiAdapter::EntityExists(const GenericEntityId& id) {
 
 bool CorgiAdapter::GetEntityTransform(const GenericEntityId& id,
                                       GenericTransform* transform) {
-  if (!EntityExists(id)) return false;
+  corgi::EntityRef entity = GetEntityRef(id);
+  if (!entity) return false;
   auto transform_data =
-      entity_manager_->GetComponentData<TransformData>(GetEntityRef(id));
+      entity_manager_->GetComponentData<TransformData>(entity);
 
   if (transform_data == nullptr) {
     return false;
@@ -148,13 +180,27 @@ bool CorgiAdapter::GetEntityTransform(const GenericEntityId& id,
   return true;
 }
 
-bool CorgiAdapter::SetEntityTransform(const GenericEntityId& id,
-                                      const GenericTransform& transform) {
-  if (!EntityExists(id)) return false;
-  auto transform_component =
-      entity_manager_->GetComponent<TransformComponent>();
+// Bring an entity's physics up to date with its transform.
+static void UpdateCorgiPhysics(corgi::EntityManager* entity_manager,
+                               PhysicsComponent* physics,
+                               const corgi::EntityRef& entity) {
+  if (entity_manager->GetComponentData<PhysicsData>(entity)) {
+    physics->UpdatePhysicsFromTransform(entity);
+    // Workaround for an issue with the physics library where modifying
+    // a raycast physics volume causes raycasts to stop working on it.
+    physics->DisablePhysics(entity);
+    physics->EnablePhysics(entity);
+  }
+}
 
-  corgi::EntityRef entity = GetEntityRef(id);
+// Set an entity's transform, adding one if needed, and update its physics to
+// match if `update_physics` is set.
+static bool SetCorgiTransform(corgi::EntityManager* entity_manager,
+                              TransformComponent* transform_component,
+                              PhysicsComponent* physics,
+                              const corgi::EntityRef& entity,
+                              const scene_lab::GenericTransform& transform,
+                              bool update_physics) {
   // Get the transform assigned to this entity, adding one if needed.
   auto transform_data = transform_component->AddEntity(entity);
 
@@ -166,23 +212,121 @@ bool CorgiAdapter::SetEntityTransform(const GenericEntityId& id,
   transform_data->orientation = transform.orientation;
   transform_data->scale = transform.scale;
 
-  if (entity_manager_->GetComponentData<PhysicsData>(entity)) {
-    PhysicsComponent* physics =
-        entity_manager_->GetComponent<PhysicsComponent>();
-    physics->UpdatePhysicsFromTransform(entity);
-    // Workaround for an issue with the physics library where modifying
-    // a raycast physics volume causes raycasts to stop working on it.
-    physics->DisablePhysics(entity);
-    physics->EnablePhysics(entity);
-  }
+  if (update_physics) UpdateCorgiPhysics(entity_manager, physics, entity);
   return true;
 }
 
+bool CorgiAdapter::SetEntityTransform(const GenericEntityId& id,
+                                      const GenericTransform& transform) {
+  corgi::EntityRef entity = GetEntityRef(id);
+  if (!entity) return false;
+  bool had_transform =
+      entity_manager_->GetComponentData<TransformData>(entity) != nullptr;
+  // Physics is brought up to date later for entities being edited.
+  bool editing = transform_edits_.count(id) != 0;
+  bool set = SetCorgiTransform(
+      entity_manager_, entity_manager_->GetComponent<TransformComponent>(),
+      entity_manager_->GetComponent<PhysicsComponent>(), entity, transform,
+      !editing);
+  if (set && editing) stale_physics_.insert(id);
+  // A transform may have been added.
+  if (set && !had_transform) UpdateComponentMask(id, entity);
+  return set;
+}
+
+bool CorgiAdapter::GetEntityTransforms(
+    const GenericEntityId* ids, size_t count,
+    GenericTransformArrays* transforms_output) {
+  // Look up the components once, and each entity only once, rather than
+  // going through GetEntityTransform() for each entity.
+  auto transform_component =
+      entity_manager_->GetComponent<TransformComponent>();
+  const mathfu::vec3_packed kZeros(mathfu::kZeros3f);
+  const mathfu::vec3_packed kOnes(mathfu::kOnes3f);
+  const mathfu::vec4_packed kIdentity(mathfu::vec4(0, 0, 0, 1));
+  transforms_output->resize(count);
+  bool all_found = true;
+  for (size_t i = 0; i < count; i++) {
+    corgi::EntityRef entity = GetEntityRef(ids[i]);
+    const TransformData* transform_data =
+        entity ? transform_component->GetComponentData(entity) : nullptr;
+    if (transform_data == nullptr) {
+      transforms_output->positions[i] = kZeros;
+      transforms_output->orientations[i] = kIdentity;
+      transforms_output->scales[i] = kOnes;
+      all_found = false;
+      continue;
+    }
+    const mathfu::quat& orientation = transform_data->orientation;
+    transforms_output->positions[i] =
+        mathfu::vec3_packed(transform_data->position);
+    transforms_output->orientations[i] = mathfu::vec4_packed(
+        mathfu::vec4(orientation.vector(), orientation.scalar()));
+    transforms_output->scales[i] = mathfu::vec3_packed(transform_data->scale);
+  }
+  return all_found;
+}
+
+bool CorgiAdapter::SetEntityTransforms(
+    const GenericEntityId* ids, size_t count,
+    const GenericTransformArrays& transforms) {
+  auto transform_component =
+      entity_manager_->GetComponent<TransformComponent>();
+  auto physics_component = entity_manager_->GetComponent<PhysicsComponent>();
+  bool all_set = true;
+  for (size_t i = 0; i < count; i++) {
+    corgi::EntityRef entity = GetEntityRef(ids[i]);
+    if (!entity) {
+      all_set = false;
+      continue;
+    }
+    bool had_transform =
+        transform_component->GetComponentData(entity) != nullptr;
+    bool editing = transform_edits_.count(ids[i]) != 0;
+    if (!SetCorgiTransform(entity_manager_, transform_component,
+                           physics_component, entity, transforms.Get(i),
+                           !editing)) {
+      all_set = false;
+      continue;
+    }
+    if (editing) stale_physics_.insert(ids[i]);
+    if (!had_transform) UpdateComponentMask(ids[i], entity);
+  }
+  return all_set;
+}
+
+void CorgiAdapter::BeginTransformEdit(const GenericEntityId& id) {
+  transform_edits_.insert(id);
+}
+
+void CorgiAdapter::EndTransformEdit(const GenericEntityId& id) {
+  transform_edits_.erase(id);
+  if (stale_physics_.erase(id) == 0) return;
+  // Do the full update we put off while the entity was moving.
+  corgi::EntityRef entity = GetEntityRef(id);
+  if (entity) {
+    UpdateCorgiPhysics(entity_manager_,
+                       entity_manager_->GetComponent<PhysicsComponent>(),
+                       entity);
+  }
+}
+
+void CorgiAdapter::UpdateStalePhysics() {
+  if (stale_physics_.empty()) return;
+  auto physics_component = entity_manager_->GetComponent<PhysicsComponent>();
+  for (auto id = stale_physics_.begin(); id != stale_physics_.end(); ++id) {
+    corgi::EntityRef entity = GetEntityRef(*id);
+    if (entity) UpdateCorgiPhysics(entity_manager_, physics_component, entity);
+  }
+  stale_physics_.clear();
+}
+
 bool CorgiAdapter::GetEntityChildren(
     const GenericEntityId& id, std::vector<GenericEntityId>* children_out) {
-  if (!EntityExists(id)) return false;
+  corgi::EntityRef entity = GetEntityRef(id);
+  if (!entity) return false;
   auto transform_data =
-      entity_manager_->GetComponentData<TransformData>(GetEntityRef(id));
+      entity_manager_->GetComponentData<TransformData>(entity);
 
   if (transform_data == nullptr) {
     return false;
@@ -198,9 +342,10 @@ bool CorgiAdapter::GetEntityChildren(
 
 bool CorgiAdapter::GetEntityParent(const GenericEntityId& id,
                                    GenericEntityId* parent_out) {
-  if (!EntityExists(id)) return false;
+  corgi::EntityRef entity = GetEntityRef(id);
+  if (!entity) return false;
   auto transform_data =
-      entity_manager_->GetComponentData<TransformData>(GetEntityRef(id));
+      entity_manager_->GetComponentData<TransformData>(entity);
 
   if (transform_data == nullptr) {
     return false;
@@ -217,8 +362,8 @@ bool CorgiAdapter::GetEntityParent(const GenericEntityId& id,
 
 bool CorgiAdapter::SetEntityParent(const GenericEntityId& child,
                                    const GenericEntityId& parent) {
-  if (!EntityExists(child)) return false;
   corgi::EntityRef child_entity = GetEntityRef(child);
+  if (!child_entity) return false;
   auto transform_component =
       entity_manager_->GetComponent<TransformComponent>();
   if (transform_component->GetComponentData(child_entity) == nullptr)
@@ -233,8 +378,8 @@ bool CorgiAdapter::SetEntityParent(const GenericEntityId& child,
     }
   } else {
     // parent is an entity, check if valid.
-    if (!EntityExists(parent)) return false;
     corgi::EntityRef parent_entity = GetEntityRef(parent);
+    if (!parent_entity) return false;
     if (transform_component->GetComponentData(parent_entity) == nullptr)
       return false;
 
@@ -283,53 +428,102 @@ bool CorgiAdapter::GetViewportSettings(ViewportSettings* viewport_out) {
 
 bool CorgiAdapter::DuplicateEntity(const GenericEntityId& id,
                                    GenericEntityId* new_id) {
+  // A single copy goes exactly where the original is, so unlike
+  // DuplicateEntities() there's nothing to move and no physics to update.
   corgi::EntityRef entity = GetEntityRef(id);
+  if (!entity) return false;
+  std::vector<corgi::EntityRef> entities_created;
+  if (!LoadEntityCopies(entity, 1, &entities_created)) return false;
+  for (size_t i = 0; i < entities_created.size(); i++) {
+    scene_lab_->NotifyCreateEntity(GetEntityId(entities_created[i]));
+  }
+  if (new_id != nullptr) *new_id = GetEntityId(entities_created[0]);
+  return true;
+}
 
-  std::vector<uint8_t> entity_serialized;
+bool CorgiAdapter::LoadEntityCopies(
+    const corgi::EntityRef& entity, size_t count,
+    std::vector<corgi::EntityRef>* entities_created) {
+  std::vector<std::vector<uint8_t>> entity_defs(1);
   if (!entity_factory_->SerializeEntity(entity, entity_manager_,
-                                        &entity_serialized)) {
+                                        &entity_defs[0])) {
     fplbase::LogError("DuplicateEntity: Couldn't serialize entity");
     return false;
   }
-  std::vector<std::vector<uint8_t>> entity_defs;
-  entity_defs.push_back(entity_serialized);
+  // A list of just the one entity, loaded once per copy, rather than a list
+  // holding every copy of it.
   std::vector<uint8_t> entity_list;
   if (!entity_factory_->SerializeEntityList(entity_defs, &entity_list)) {
     fplbase::LogError("DuplicateEntity: Couldn't create entity list");
     return false;
   }
-  std::vector<corgi::EntityRef> entities_created;
-  if (entity_factory_->LoadEntityListFromMemory(
-          entity_list.data(), entity_manager_, &entities_created) > 0) {
-    // We created some new duplicate entities! (most likely exactly one.)  We
-    // need to remove their entity IDs since otherwise they will have
-    // duplicate entity IDs to the one we created.  We also need to make sure
-    // the new entity IDs are marked with the same source file as the old.
-
-    for (size_t i = 0; i < entities_created.size(); i++) {
-      corgi::EntityRef& new_entity = entities_created[i];
-      MetaData* old_editor_data =
-          entity_manager_->GetComponentData<MetaData>(entity);
-      MetaData* editor_data =
-          entity_manager_->GetComponentData<MetaData>(new_entity);
-      if (editor_data != nullptr) {
-        editor_data->entity_id = "";
-        if (old_editor_data != nullptr)
-          editor_data->source_file = old_editor_data->source_file;
-      }
+  InvalidateEntityIDs();
+  std::vector<corgi::EntityRef> entities_loaded;
+  for (size_t i = 0; i < count; i++) {
+    entities_loaded.clear();
+    if (entity_factory_->LoadEntityListFromMemory(
+            entity_list.data(), entity_manager_, &entities_loaded) <= 0) {
+      break;
     }
-    entity_manager_->GetComponent<TransformComponent>()->PostLoadFixup();
-    for (size_t i = 0; i < entities_created.size(); i++) {
-      scene_lab_->NotifyCreateEntity(GetEntityId(entities_created[i]));
+    entities_created->insert(entities_created->end(), entities_loaded.begin(),
+                             entities_loaded.end());
+  }
+  if (entities_created->empty()) return false;
+  // We created some new duplicate entities! We need to remove their entity
+  // IDs since otherwise they will have duplicate entity IDs to the one we
+  // created. We also need to make sure the new entity IDs are marked with the
+  // same source file as the old.
+  MetaData* old_editor_data =
+      entity_manager_->GetComponentData<MetaData>(entity);
+  for (size_t i = 0; i < entities_created->size(); i++) {
+    MetaData* editor_data =
+        entity_manager_->GetComponentData<MetaData>((*entities_created)[i]);
+    if (editor_data != nullptr) {
+      editor_data->entity_id = "";
+      if (old_editor_data != nullptr)
+        editor_data->source_file = old_editor_data->source_file;
     }
-    *new_id = GetEntityId(entities_created[0]);
-    return true;
   }
-  return false;
+  entity_manager_->GetComponent<TransformComponent>()->PostLoadFixup();
+  return true;
+}
+
+bool CorgiAdapter::DuplicateEntities(
+    const GenericEntityId& id, const GenericTransformArrays& offsets,
+    std::vector<GenericEntityId>* new_ids_output) {
+  corgi::EntityRef entity = GetEntityRef(id);
+  if (!entity) return false;
+  if (offsets.size() == 0) return true;
+
+  std::vector<corgi::EntityRef> entities_created;
+  if (!LoadEntityCopies(entity, offsets.size(), &entities_created)) {
+    return false;
+  }
+
+  // Move each copy by its offset from the original.
+  GenericTransform original;
+  if (GetEntityTransform(id, &original)) {
+    auto transform_component =
+        entity_manager_->GetComponent<TransformComponent>();
+    auto physics_component = entity_manager_->GetComponent<PhysicsComponent>();
+    for (size_t i = 0; i < entities_created.size() && i < offsets.size();
+         i++) {
+      SetCorgiTransform(entity_manager_, transform_component,
+                        physics_component, entities_created[i],
+                        original.Offset(offsets.Get(i)), true);
+    }
+  }
+  for (size_t i = 0; i < entities_created.size(); i++) {
+    GenericEntityId new_id = GetEntityId(entities_created[i]);
+    scene_lab_->NotifyCreateEntity(new_id);
+    if (new_ids_output != nullptr) new_ids_output->push_back(new_id);
+  }
+  return entities_created.size() == offsets.size();
 }
 
 bool CorgiAdapter::CreateEntity(GenericEntityId* new_id_output) {
   corgi::EntityRef new_entity = entity_manager_->AllocateNewEntity();
+  InvalidateEntityIDs();
   if (new_entity) {
     if (new_id_output != nullptr) {
       *new_id_output = GetEntityId(new_entity);
@@ -342,9 +536,9 @@ bool CorgiAdapter::CreateEntity(GenericEntityId* new_id_output) {
 
 bool CorgiAdapter::CreateEntityFromPrototype(
     const GenericPrototypeId& prototype, GenericEntityId* new_id_output) {
-  std::string prototype_str = static_cast<std::string>(prototype);
   corgi::EntityRef new_entity = entity_factory_->CreateEntityFromPrototype(
-      prototype_str.c_str(), entity_manager_);
+      EntityIdString(prototype).c_str(), entity_manager_);
+  InvalidateEntityIDs();
   if (new_entity) {
     if (new_id_output != nullptr) {
       *new_id_output = GetEntityId(new_entity);
@@ -356,28 +550,37 @@ bool CorgiAdapter::CreateEntityFromPrototype(
 }
 
 bool CorgiAdapter::DeleteEntity(const GenericEntityId& id) {
-  if (!EntityExists(id)) return false;
   corgi::EntityRef entity = GetEntityRef(id);
+  if (!entity) return false;
   entity_manager_->DeleteEntity(entity);
+  // The entity isn't removed until DeleteMarkedEntities() is called. Forget
+  // its mask now, so a new entity given the same ID doesn't inherit it.
+  entity_deletion_pending_ = true;
+  entity_indices_.erase(id);
   return true;
 }
 
 bool CorgiAdapter::SetEntityHighlighted(const GenericEntityId& id,
                                         bool is_highlighted) {
-  if (!EntityExists(id)) return false;
-  return HighlightEntity(GetEntityRef(id), is_highlighted ? 2.0f : 1.0f);
+  corgi::EntityRef entity = GetEntityRef(id);
+  if (!entity) return false;
+  return HighlightEntity(entity, is_highlighted ? 2.0f : 1.0f);
 }
 
 bool CorgiAdapter::DebugDrawPhysics(const GenericEntityId& id) {
-  if (EntityExists(id)) {
-    corgi::EntityRef entity = GetEntityRef(id);
-    if (entity) {
-      auto physics = entity_manager_->GetComponent<PhysicsComponent>();
-      mathfu::mat4 cam = camera_->GetTransformMatrix();
-      physics->DebugDrawObject(renderer_, cam, entity,
-                               mathfu::vec3(1.0f, 0.5f, 0.5f));
-      return true;
+  corgi::EntityRef entity = GetEntityRef(id);
+  if (entity) {
+    auto physics = entity_manager_->GetComponent<PhysicsComponent>();
+    if (stale_physics_.count(id) != 0 &&
+        entity_manager_->GetComponentData<PhysicsData>(entity)) {
+      // Move the physics shapes so they're drawn in the right place, but
+      // leave the full update until the edit is over.
+      physics->UpdatePhysicsFromTransform(entity);
     }
+    mathfu::mat4 cam = camera_->GetTransformMatrix();
+    physics->DebugDrawObject(renderer_, cam, entity,
+                             mathfu::vec3(1.0f, 0.5f, 0.5f));
+    return true;
   }
   return false;
 }
@@ -387,6 +590,9 @@ bool CorgiAdapter::GetRayIntersection(const mathfu::vec3& start_point,
                                       GenericEntityId* entity_output,
                                       mathfu::vec3* intersection_point_output) {
   if (camera_ == nullptr) return false;
+  // The ray must hit entities where they are now, not where they were when
+  // their transform edits started.
+  UpdateStalePhysics();
 
   mathfu::vec3 intersection_point;
   mathfu::vec3 start = start_point;
@@ -438,12 +644,89 @@ bool CorgiAdapter::CycleEntities(int direction, GenericEntityId* next_entity) {
 }
 
 bool CorgiAdapter::GetAllEntityIDs(std::vector<GenericEntityId>* ids_out) {
-  if (ids_out != nullptr) ids_out->clear();
+  UpdateEntityCache();
+  if (ids_out != nullptr) *ids_out = entity_ids_;
+  return true;
+}
+
+void CorgiAdapter::UpdateEntityCache() {
+  if (entity_ids_valid_) return;
+  // Entities that were in the list last time keep their masks, which have
+  // been kept up to date as their components changed, so only new entities
+  // need every component checked. Deleted entities are simply left out. If
+  // components have been registered since, every mask has to be redone.
+  size_t component_count =
+      static_cast<size_t>(entity_manager_->ComponentCount());
+  if (component_count != component_mask_count_) component_masks_valid_ = false;
+  std::vector<uint64_t> old_masks;
+  std::unordered_map<GenericEntityId, size_t> old_indices;
+  if (component_masks_valid_) {
+    old_masks.swap(component_masks_);
+    old_indices.swap(entity_indices_);
+  }
+  entity_ids_.clear();
+  entity_indices_.clear();
+  component_masks_.clear();
+  // One bit per registered component, rounded up to whole words.
+  component_mask_count_ = component_count;
+  component_mask_words_ = (component_count + 63) / 64;
   for (auto i = entity_manager_->begin(); i != entity_manager_->end(); ++i) {
     corgi::EntityRef entity = i.ToReference();
-    if (ids_out != nullptr) ids_out->push_back(GetEntityId(entity));
+    GenericEntityId id = GetEntityId(entity);
+    size_t index = entity_ids_.size();
+    entity_ids_.push_back(id);
+    entity_indices_[id] = index;
+    auto old_index = old_indices.find(id);
+    if (old_index != old_indices.end()) {
+      const uint64_t* mask =
+          &old_masks[old_index->second * component_mask_words_];
+      component_masks_.insert(component_masks_.end(), mask,
+                              mask + component_mask_words_);
+      // If two entities share an ID, only the first gets the old mask.
+      old_indices.erase(old_index);
+    } else {
+      component_masks_.resize(component_masks_.size() + component_mask_words_);
+      UpdateComponentMask(index, entity);
+    }
+  }
+  component_masks_valid_ = true;
+  entity_ids_valid_ = true;
+}
+
+void CorgiAdapter::UpdateComponentMask(size_t index,
+                                       const corgi::EntityRef& entity) {
+  uint64_t* mask = &component_masks_[index * component_mask_words_];
+  for (size_t word = 0; word < component_mask_words_; word++) mask[word] = 0;
+  size_t count = static_cast<size_t>(entity_manager_->ComponentCount());
+  // Components registered since the masks were made aren't in them; they'll
+  // be picked up when the cache is next rebuilt.
+  count = std::min(count, component_mask_words_ * 64);
+  for (size_t i = 0; i < count; i++) {
+    corgi::ComponentId cid = static_cast<corgi::ComponentId>(i);
+    if (cid != corgi::kInvalidComponent &&
+        entity_manager_->GetComponent(cid)->GetComponentDataAsVoid(entity) !=
+            nullptr) {
+      mask[i / 64] |= uint64_t(1) << (i % 64);
+    }
   }
-  return true;
+}
+
+void CorgiAdapter::UpdateComponentMask(const GenericEntityId& id,
+                                       const corgi::EntityRef& entity) {
+  auto index = entity_indices_.find(id);
+  if (index != entity_indices_.end()) {
+    UpdateComponentMask(index->second, entity);
+  }
+}
+
+void CorgiAdapter::ClearEntityIds() {
+  RefreshEntityIDs();
+  entity_ids_.clear();
+  entity_indices_.clear();
+  component_masks_.clear();
+  transform_edits_.clear();
+  stale_physics_.clear();
+  EntitySystemAdapter::ClearEntityIds();
 }
 
 bool CorgiAdapter::GetAllPrototypeIDs(
@@ -451,14 +734,13 @@ bool CorgiAdapter::GetAllPrototypeIDs(
   auto prototype_data = entity_factory_->prototype_data();
   if (ids_out != nullptr) ids_out->clear();
   for (auto it = prototype_data.begin(); it != prototype_data.end(); ++it) {
-    if (ids_out != nullptr) ids_out->push_back(it->first);
+    if (ids_out != nullptr) ids_out->push_back(EntityIdFromString(it->first));
   }
   return true;
 }
 
 bool CorgiAdapter::GetEntityDescription(const GenericEntityId& id,
                                         std::string* description) {
-  if (!EntityExists(id)) return false;
   corgi::EntityRef entity = GetEntityRef(id);
   if (!entity) return false;
 
@@ -474,7 +756,6 @@ bool CorgiAdapter::GetEntitySourceFile(const GenericEntityId& id,
                                        std::string* source_file) {
   // If the entity is not found, return false, meaning don't save.
   if (source_file != nullptr) *source_file = std::string();
-  if (!EntityExists(id)) return false;
   corgi::EntityRef entity = GetEntityRef(id);
   if (!entity) return false;
 
@@ -508,26 +789,47 @@ bool CorgiAdapter::GetTextSchema(std::string* schema_out) {
 
 bool CorgiAdapter::GetTableObject(const GenericComponentId& id,
                                   const reflection::Object** table_out) {
-  const reflection::Schema* schema;
-  if (!GetSchema(&schema)) return false;
-  // GenericComponentId is the table name.
-  const char* table_name =
-      entity_factory_->ComponentIdToTableName(GetCorgiComponentId(id));
-  if (table_name == nullptr) return false;
-
-  const reflection::Object* obj = schema->objects()->LookupByKey(table_name);
+  corgi::ComponentId cid = GetCorgiComponentId(id);
+  if (cid == corgi::kInvalidComponent) return false;
+  const reflection::Object* obj = component_info_[cid].table_object;
   if (table_out != nullptr) *table_out = obj;
   return (obj != nullptr);
 }
 
+bool CorgiAdapter::GetTableName(const GenericComponentId& id,
+                                std::string* name_out) {
+  corgi::ComponentId cid = GetCorgiComponentId(id);
+  if (cid == corgi::kInvalidComponent ||
+      component_info_[cid].table_object == nullptr) {
+    return false;
+  }
+  if (name_out != nullptr) *name_out = component_info_[cid].table_name;
+  return true;
+}
+
 bool CorgiAdapter::GetEntityComponentList(
     const GenericEntityId& id,
     std::vector<GenericComponentId>* components_out) {
-  if (!EntityExists(id)) return false;
   corgi::EntityRef entity = GetEntityRef(id);
   if (!entity) return false;
 
   if (components_out != nullptr) components_out->clear();
+  UpdateEntityCache();
+  auto index = entity_indices_.find(id);
+  if (index != entity_indices_.end()) {
+    // Read the list straight out of the entity's component mask.
+    const uint64_t* mask =
+        &component_masks_[index->second * component_mask_words_];
+    for (size_t i = 0; i < component_mask_words_ * 64; i++) {
+      if (((mask[i / 64] >> (i % 64)) & 1) != 0 && components_out != nullptr) {
+        components_out->push_back(
+            GetGenericComponentId(static_cast<corgi::ComponentId>(i)));
+      }
+    }
+    return true;
+  }
+  // Not in the cache (e.g. the game created it without telling us), so check
+  // every component.
   for (corgi::ComponentId i = 0; i < entity_manager_->ComponentCount(); i++) {
     if (i != corgi::kInvalidComponent &&
         entity_manager_->GetComponent(i)->GetComponentDataAsVoid(entity) !=
@@ -552,9 +854,32 @@ void CorgiAdapter::GetFullComponentList(
   }
 }
 
+bool CorgiAdapter::GetEntitiesWithComponents(
+    const std::vector<GenericComponentId>& components,
+    std::vector<GenericEntityId>* ids_out) {
+  UpdateEntityCache();
+  ids_out->clear();
+  std::vector<uint64_t> query(component_mask_words_, 0);
+  for (auto c = components.begin(); c != components.end(); ++c) {
+    size_t cid = static_cast<size_t>(GetCorgiComponentId(*c));
+    // Nothing can have a component that doesn't exist.
+    if (cid == corgi::kInvalidComponent || cid >= component_mask_words_ * 64)
+      return true;
+    query[cid / 64] |= uint64_t(1) << (cid % 64);
+  }
+  for (size_t i = 0; i < entity_ids_.size(); i++) {
+    const uint64_t* mask = &component_masks_[i * component_mask_words_];
+    bool has_all = true;
+    for (size_t word = 0; word < component_mask_words_ && has_all; word++) {
+      has_all = (mask[word] & query[word]) == query[word];
+    }
+    if (has_all) ids_out->push_back(entity_ids_[i]);
+  }
+  return true;
+}
+
 bool CorgiAdapter::IsEntityComponentFromPrototype(
     const GenericEntityId& entity_id, const GenericComponentId& component_id) {
-  if (!EntityExists(entity_id)) return false;
   corgi::EntityRef entity = GetEntityRef(entity_id);
   corgi::ComponentId cid = GetCorgiComponentId(component_id);
   if (!entity || cid == corgi::kInvalidComponent) return false;
@@ -568,29 +893,47 @@ bool CorgiAdapter::IsEntityComponentFromPrototype(
 bool CorgiAdapter::SerializeEntities(
     const std::vector<GenericEntityId>& id_list,
     std::vector<uint8_t>* buffer_out) {
+  // Serialize each entity into a buffer borrowed from the pool, so that once
+  // the pool has warmed up, saving doesn't allocate a buffer per entity.
   std::vector<std::vector<uint8_t>> entities_serialized;
+  entities_serialized.reserve(id_list.size());
   for (auto id = id_list.begin(); id != id_list.end(); ++id) {
-    if (!EntityExists(*id)) continue;
     corgi::EntityRef entity = GetEntityRef(*id);
     if (!entity) continue;
-    entities_serialized.push_back(std::vector<uint8_t>());
-    entity_factory_->SerializeEntity(entity, entity_manager_,
-                                     &entities_serialized.back());
-  }
-  if (buffer_out != nullptr) {
-    if (!entity_factory_->SerializeEntityList(entities_serialized,
-                                              buffer_out)) {
-      fplbase::LogError("CorgiAdapter: Couldn't serialize entity list.");
-      return false;
+    if (entity_buffer_pool_.empty()) {
+      entities_serialized.push_back(std::vector<uint8_t>());
+    } else {
+      entities_serialized.push_back(std::move(entity_buffer_pool_.back()));
+      entity_buffer_pool_.pop_back();
+    }
+    std::vector<uint8_t>& buffer = entities_serialized.back();
+    buffer.clear();
+    if (!entity_factory_->SerializeEntity(entity, entity_manager_, &buffer)) {
+      entity_buffer_pool_.push_back(std::move(buffer));
+      entities_serialized.pop_back();
     }
   }
-  return true;
+  bool success = true;
+  if (buffer_out != nullptr &&
+      !entity_factory_->SerializeEntityList(entities_serialized, buffer_out)) {
+    fplbase::LogError("CorgiAdapter: Couldn't serialize entity list.");
+    success = false;
+  }
+  // Give the buffers back to the pool, keeping their capacity, up to its
+  // limits.
+  for (auto b = entities_serialized.begin(); b != entities_serialized.end();
+       ++b) {
+    if (entity_buffer_pool_.size() >= kMaxPooledEntityBuffers) break;
+    if (b->capacity() <= kMaxPooledEntityBufferSize) {
+      entity_buffer_pool_.push_back(std::move(*b));
+    }
+  }
+  return success;
 }
 
 bool CorgiAdapter::SerializeEntityComponent(
     const GenericEntityId& entity_id, const GenericComponentId& component_id,
     flatbuffers::unique_ptr_t* data_out) {
-  if (!EntityExists(entity_id)) return false;
   corgi::EntityRef entity = GetEntityRef(entity_id);
   corgi::ComponentId cid = GetCorgiComponentId(component_id);
   if (!entity || cid == corgi::kInvalidComponent) return false;
@@ -618,20 +961,72 @@ bool CorgiAdapter::DeserializeEntityComponent(
     const GenericEntityId& entity_id, const GenericComponentId& component_id,
     const uint8_t* data) {
   if (data == nullptr) return false;
-  if (!EntityExists(entity_id)) return false;
   corgi::EntityRef entity = GetEntityRef(entity_id);
   corgi::ComponentId cid = GetCorgiComponentId(component_id);
   if (!entity || cid == corgi::kInvalidComponent) return false;
   corgi::ComponentInterface* component = entity_manager_->GetComponent(cid);
   component->AddFromRawData(entity, flatbuffers::GetAnyRoot(data));
+  if (cid == MetaComponent::GetComponentId()) {
+    // This may have changed the entity's ID.
+    InvalidateEntityIDs();
+  } else {
+    UpdateComponentMask(entity_id, entity);
+  }
   return true;
 }
 
 void CorgiAdapter::OverrideFileCache(const std::string& filename,
                                      const std::vector<uint8_t>& data) {
-  // TODO: implement
-  (void)filename;
-  (void)data;
+  UpdateFileCache(filename, std::make_shared<const std::vector<uint8_t>>(data));
+}
+
+void CorgiAdapter::UpdateFileCache(const std::string& filename,
+                                   const SharedFileBuffer& data) {
+  if (data == nullptr || data->empty()) {
+    file_cache_.erase(filename);
+  } else {
+    file_cache_[filename] = data;
+  }
+}
+
+CorgiAdapter::SharedFileBuffer CorgiAdapter::GetCachedFile(
+    const std::string& filename) const {
+  auto cached = file_cache_.find(filename);
+  return cached != file_cache_.end() ? cached->second : SharedFileBuffer();
+}
+
+int CorgiAdapter::LoadEntitiesFromFile(
+    const std::string& filename, std::vector<corgi::EntityRef>* entities_out) {
+  // Hold a reference so the data can't go away while we're loading it.
+  SharedFileBuffer data = GetCachedFile(filename);
+  std::string file_data;
+  const void* entity_list;
+  if (data != nullptr) {
+    entity_list = data->data();
+  } else if (fplbase::LoadFile(filename.c_str(), &file_data)) {
+    entity_list = file_data.c_str();
+  } else {
+    fplbase::LogError("CorgiAdapter: Couldn't load entity file %s",
+                      filename.c_str());
+    return 0;
+  }
+  std::vector<corgi::EntityRef> entities_loaded;
+  InvalidateEntityIDs();
+  int count = entity_factory_->LoadEntityListFromMemory(
+      entity_list, entity_manager_, &entities_loaded);
+  // Remember where the entities came from, so they're saved back there.
+  const std::string source_file = flatbuffers::StripExtension(filename);
+  for (auto e = entities_loaded.begin(); e != entities_loaded.end(); ++e) {
+    auto meta_data = entity_manager_->GetComponentData<MetaData>(*e);
+    if (meta_data != nullptr && meta_data->source_file.empty()) {
+      meta_data->source_file = source_file;
+    }
+  }
+  if (entities_out != nullptr) {
+    entities_out->insert(entities_out->end(), entities_loaded.begin(),
+                         entities_loaded.end());
+  }
+  return count;
 }
 
 bool CorgiAdapter::HighlightEntity(const corgi::EntityRef& entity, float tint) {
@@ -663,31 +1058,60 @@ void CorgiAdapter::CreateDefaultCamera() {
 }
 
 corgi::EntityRef CorgiAdapter::GetEntityRef(const GenericEntityId& id) const {
-  (void)id;
   if (id == kNoEntityId) return corgi::EntityRef();
+  auto cached = entity_refs_.find(id);
+  if (cached != entity_refs_.end()) return cached->second;
   auto meta_component = entity_manager_->GetComponent<MetaComponent>();
-  return meta_component->GetEntityFromDictionary(id);
+  corgi::EntityRef entity =
+      meta_component->GetEntityFromDictionary(EntityIdString(id));
+  if (entity) entity_refs_[id] = entity;
+  return entity;
 }
 
 GenericEntityId CorgiAdapter::GetEntityId(const corgi::EntityRef& ref) const {
   if (!ref) return kNoEntityId;
   auto meta_component = entity_manager_->GetComponent<MetaComponent>();
-  return meta_component->GetEntityID(ref);
+  return EntityIdFromString(meta_component->GetEntityID(ref));
 }
 
 corgi::ComponentId CorgiAdapter::GetCorgiComponentId(
     const GenericComponentId& id) const {
   if (id == kNoComponentId) return corgi::kInvalidComponent;
-  return static_cast<corgi::ComponentId>(atoi(id.c_str()));
+  UpdateComponentTables();
+  auto cid = corgi_component_ids_.find(id);
+  return cid != corgi_component_ids_.end() ? cid->second
+                                           : corgi::kInvalidComponent;
 }
 
 GenericComponentId CorgiAdapter::GetGenericComponentId(
     corgi::ComponentId c) const {
   if (c == corgi::kInvalidComponent) return kNoComponentId;
+  UpdateComponentTables();
+  if (static_cast<size_t>(c) >= component_info_.size()) return kNoComponentId;
+  return component_info_[c].generic_id;
+}
 
-  std::stringstream ss;
-  ss << c;
-  return ss.str();
+void CorgiAdapter::UpdateComponentTables() const {
+  size_t count = static_cast<size_t>(entity_manager_->ComponentCount());
+  if (component_info_.size() >= count) return;
+  const reflection::Schema* schema =
+      schema_data_.length() > 0 ? reflection::GetSchema(schema_data_.c_str())
+                                : nullptr;
+  for (size_t i = component_info_.size(); i < count; i++) {
+    corgi::ComponentId cid = static_cast<corgi::ComponentId>(i);
+    component_info_.push_back(ComponentInfo());
+    if (cid == corgi::kInvalidComponent) continue;
+    ComponentInfo& info = component_info_.back();
+    // GenericComponentId is the component ID number, as a string.
+    info.generic_id = ComponentIdFromString(flatbuffers::NumToString(cid));
+    corgi_component_ids_[info.generic_id] = cid;
+    const char* table_name = entity_factory_->ComponentIdToTableName(cid);
+    if (table_name == nullptr) continue;
+    info.table_name = table_name;
+    if (schema != nullptr) {
+      info.table_object = schema->objects()->LookupByKey(table_name);
+    }
+  }
 }
 
 }  // namespace scene_lab_corgi
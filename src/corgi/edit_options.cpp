@@ -42,10 +42,16 @@ void EditOptionsComponent::SetSceneLabCallbacks(CorgiAdapter* corgi_adapter) {
   assert(scene_lab);
   scene_lab->AddOnEnterEditorCallback([this]() { EditorEnter(); });
   scene_lab->AddOnExitEditorCallback([this]() { EditorExit(); });
-  scene_lab->AddOnCreateEntityCallback(
-      [this](const scene_lab::GenericEntityId& id) {
-        corgi::EntityRef entity = corgi_adapter_->GetEntityRef(id);
-        EntityCreated(entity);
+  // Handle new entities once a frame, rather than as each one is made.
+  scene_lab->AddOnCreateEntitiesCallback(
+      [this](const scene_lab::GenericEntityId* ids, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+          corgi::EntityRef entity = corgi_adapter_->GetEntityRef(ids[i]);
+          if (!entity) continue;
+          EntityCreated(entity);
+          // EntityCreated() may have added a physics component.
+          corgi_adapter_->UpdateComponentMask(ids[i], entity);
+        }
       });
 }
 
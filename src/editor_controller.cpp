@@ -24,12 +24,12 @@ using mathfu::quat;
 namespace scene_lab {
 
 void EditorController::Update() {
+  input_->Update();
   facing_previous_ = facing_current_;
   pointer_previous_ = pointer_current_;
   if (mouse_locked_) {
     // Mouse locked to middle of screen, track movement to change facing.
-    vec2 delta = config_->mouse_sensitivity() *
-                 vec2(input_system_->get_pointers()[0].mousedelta);
+    vec2 delta = config_->mouse_sensitivity() * input_->PointerDelta();
 
     vec3 side_axis = quat::FromAngleAxis(-static_cast<float>(M_PI) / 2.0f,
                                          mathfu::kAxisZ3f) *
@@ -41,12 +41,12 @@ void EditorController::Update() {
     facing_current_ = pitch_adjustment * yaw_adjustment * facing_previous_;
   } else {
     // Mouse not locked, track pointer location for clicking on things.
-    pointer_current_ = vec2(input_system_->get_pointers()[0].mousepos);
+    pointer_current_ = input_->PointerPosition();
   }
 
   for (int i = 0; i < kNumButtons; i++) {
     buttons_previous_[i] = buttons_current_[i];
-    buttons_current_[i] = input_system_->GetPointerButton(i).is_down();
+    buttons_current_[i] = input_->PointerButtonIsDown(i);
   }
 }
 
@@ -20,6 +20,7 @@
 #include "flatbuffers/flatbuffers.h"
 #include "flatbuffers/reflection.h"
 #include "fplbase/flatbuffer_utils.h"
+#include "scene_lab/profiler.h"
 #include "scene_lab/scene_lab.h"
 
 namespace scene_lab {
@@ -59,6 +60,7 @@ EditorGui::EditorGui(const SceneLabConfig* config, SceneLab* scene_lab,
       auto_commit_component_(EntitySystemAdapter::kNoComponentId),
       auto_revert_component_(EntitySystemAdapter::kNoComponentId),
       auto_recreate_component_(EntitySystemAdapter::kNoComponentId),
+      entity_list_generation_(EntitySystemAdapter::kEntityIDsUntracked),
       button_pressed_(kNone),
       edit_window_state_(kNormal),
       edit_view_(kEditEntity),
@@ -231,6 +233,7 @@ void EditorGui::FinishRender() {
 }
 
 void EditorGui::DrawGui(const vec2& virtual_resolution) {
+  SCENE_LAB_PROFILE_ZONE("EditorGui::DrawGui");
   virtual_resolution_ = virtual_resolution;
 
   if (edit_window_state_ == kMaximized)
@@ -264,6 +267,11 @@ void EditorGui::DrawGui(const vec2& virtual_resolution) {
       flatui::kEventWentUp) {
     scene_lab_->SaveScene(true);
   }
+  if (!config_->export_json_on_save() &&
+      TextButton("[Export JSON]", "we:export-json", kButtonSize) &
+          flatui::kEventWentUp) {
+    scene_lab_->ExportJson();
+  }
   if (TextButton("[Exit Scene Lab]", "we:exit", kButtonSize) &
       flatui::kEventWentUp) {
     scene_lab_->RequestExit();
@@ -356,10 +364,14 @@ void EditorGui::CommitComponentData(const GenericComponentId& id) {
   if (component_guis_.find(id) != component_guis_.end()) {
     FlatbufferEditor* editor = component_guis_[id].get();
     if (editor->flatbuffer_modified()) {
+      // The edit may move the entity to a different source file, so the file
+      // it was in before needs to be saved as well as the one it's in after.
+      std::string old_save_file = scene_lab_->GetEntitySaveFile(edit_entity_);
       entity_system_adapter()->DeserializeEntityComponent(
           edit_entity_, id,
           static_cast<const unsigned char*>(editor->flatbuffer()));
-      scene_lab_->set_entities_modified(true);
+      scene_lab_->MarkFileModified(old_save_file);
+      scene_lab_->MarkEntityModified(edit_entity_);
     }
     editor->ClearFlatbufferModifiedFlag();
   }
@@ -547,16 +559,27 @@ void EditorGui::DrawEntityListUI() {
   }
   flatui::EndGroup();  // ws:entity-list-filter
 
-  std::vector<GenericEntityId> entity_list;
-  if (entity_system_adapter()->GetAllEntityIDs(&entity_list)) {
-    for (auto e = entity_list.begin(); e != entity_list.end(); ++e) {
-      const GenericEntityId& entity_id = *e;
-      if (entity_system_adapter()->FilterShowEntityID(entity_id,
-                                                      entity_list_filter_)) {
-        EntityButton(entity_id, config_->gui_button_size());
+  // Only get and filter the entity list again if it may have changed.
+  uint64_t generation = entity_system_adapter()->GetEntityIDsGeneration();
+  if (generation == EntitySystemAdapter::kEntityIDsUntracked ||
+      generation != entity_list_generation_ ||
+      entity_list_filter_ != entity_list_built_filter_) {
+    entity_list_.clear();
+    entity_list_generation_ = generation;
+    entity_list_built_filter_ = entity_list_filter_;
+    std::vector<GenericEntityId> all_entities;
+    if (entity_system_adapter()->GetAllEntityIDs(&all_entities)) {
+      for (auto e = all_entities.begin(); e != all_entities.end(); ++e) {
+        if (entity_system_adapter()->FilterShowEntityID(*e,
+                                                        entity_list_filter_)) {
+          entity_list_.push_back(*e);
+        }
       }
     }
   }
+  for (auto e = entity_list_.begin(); e != entity_list_.end(); ++e) {
+    EntityButton(*e, config_->gui_button_size());
+  }
 
   if (changed_edit_entity_ != EntitySystemAdapter::kNoEntityId) {
     // select new entity
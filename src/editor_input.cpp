@@ -0,0 +1,75 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "scene_lab/editor_input.h"
+
+namespace scene_lab {
+
+void ScriptedEditorInput::SetKey(fplbase::FPL_Keycode key, bool is_down) {
+  if (is_down) {
+    keys_.insert(key);
+  } else {
+    keys_.erase(key);
+  }
+}
+
+void ScriptedEditorInput::SetPointerButton(int button, bool is_down) {
+  if (is_down) {
+    buttons_.insert(button);
+  } else {
+    buttons_.erase(button);
+  }
+}
+
+void ScriptedEditorInput::ReleaseAll() {
+  keys_.clear();
+  buttons_.clear();
+}
+
+void ScriptedEditorInput::SetPointerPosition(const mathfu::vec2& position) {
+  pointer_movement_ += position - pointer_position_;
+  pointer_position_ = position;
+}
+
+void ScriptedEditorInput::MovePointer(const mathfu::vec2& delta) {
+  pointer_movement_ += delta;
+  // Like a real mouse in relative mode, the pointer itself stays put.
+  if (!relative_mouse_mode_) pointer_position_ += delta;
+}
+
+void ScriptedEditorInput::Update() {
+  previous_frame_keys_.swap(frame_keys_);
+  frame_keys_ = keys_;
+  frame_buttons_ = buttons_;
+  pointer_delta_ = pointer_movement_;
+  pointer_movement_ = mathfu::kZeros2f;
+}
+
+bool ScriptedEditorInput::KeyIsDown(fplbase::FPL_Keycode key) const {
+  return frame_keys_.count(key) != 0;
+}
+
+bool ScriptedEditorInput::KeyWentDown(fplbase::FPL_Keycode key) const {
+  return frame_keys_.count(key) != 0 && previous_frame_keys_.count(key) == 0;
+}
+
+bool ScriptedEditorInput::KeyWentUp(fplbase::FPL_Keycode key) const {
+  return frame_keys_.count(key) == 0 && previous_frame_keys_.count(key) != 0;
+}
+
+bool ScriptedEditorInput::PointerButtonIsDown(int button) const {
+  return frame_buttons_.count(button) != 0;
+}
+
+}  // namespace scene_lab
@@ -0,0 +1,441 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "scene_lab/entity_json_writer.h"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include "flatbuffers/util.h"
+#include "fplbase/utilities.h"
+
+namespace scene_lab {
+
+typedef std::chrono::steady_clock ExportClock;
+
+static double SecondsSince(ExportClock::time_point start) {
+  return std::chrono::duration<double>(ExportClock::now() - start).count();
+}
+
+// These match the flatbuffers::IDLOptions defaults that GenerateText() uses.
+static const int kIndentStep = 2;
+static const char kNewLine = '\n';
+
+const size_t EntityJsonWriter::kDefaultChunkSize;
+
+EntityJsonWriter::EntityJsonWriter(const reflection::Schema* schema,
+                                   size_t chunk_size)
+    : schema_(schema),
+      file_(nullptr),
+      chunk_(std::max<size_t>(chunk_size, 1)),
+      chunk_used_(0),
+      file_error_(false),
+      unsupported_data_(false) {}
+
+EntityJsonWriter::Status EntityJsonWriter::WriteFile(const std::string& path,
+                                                     const uint8_t* flatbuffer,
+                                                     uint64_t* hash_out) {
+  // Binary mode, so the output is identical on every platform.
+  file_ = fopen(path.c_str(), "wb");
+  if (file_ == nullptr) return kFileError;
+  Status status = Generate(flatbuffer);
+  if (fclose(file_) != 0 && status == kOk) status = kFileError;
+  file_ = nullptr;
+  if (hash_out != nullptr) *hash_out = hash_.Finish();
+  return status;
+}
+
+EntityJsonWriter::Status EntityJsonWriter::HashText(const uint8_t* flatbuffer,
+                                                    uint64_t* hash_out) {
+  file_ = nullptr;
+  Status status = Generate(flatbuffer);
+  if (hash_out != nullptr) *hash_out = hash_.Finish();
+  return status;
+}
+
+EntityJsonWriter::Status EntityJsonWriter::Generate(const uint8_t* flatbuffer) {
+  hash_ = IncrementalHash();
+  chunk_used_ = 0;
+  file_error_ = false;
+  unsupported_data_ = false;
+  const reflection::Object* root = schema_->root_table();
+  if (root == nullptr) return kUnsupportedData;
+  GenObject(*root, flatbuffers::GetRoot<uint8_t>(flatbuffer), 0);
+  Write(kNewLine);
+  Flush();
+  if (unsupported_data_) return kUnsupportedData;
+  return file_error_ ? kFileError : kOk;
+}
+
+void EntityJsonWriter::GenObject(const reflection::Object& object,
+                                 const uint8_t* data, int indent) {
+  const bool is_struct = object.is_struct();
+  auto table = reinterpret_cast<const flatbuffers::Table*>(data);
+  const std::vector<const reflection::Field*>& fields = SortedFields(object);
+  const reflection::Object* union_object = nullptr;
+  int fields_output = 0;
+  Write('{');
+  for (auto iter = fields.begin(); iter != fields.end(); ++iter) {
+    const reflection::Field& field = **iter;
+    if (!is_struct && !table->CheckField(field.offset())) continue;
+    if (fields_output++) Write(',');
+    Write(kNewLine);
+    WriteIndent(indent + kIndentStep);
+    Write('"');
+    Write(field.name()->str());
+    Write("\": ");
+    GenField(field, data, is_struct, union_object, indent + kIndentStep);
+    if (field.type()->base_type() == reflection::UType) {
+      // The union's value comes in the next field.
+      union_object = nullptr;
+      auto union_enum = schema_->enums()->Get(field.type()->index());
+      int64_t type = table->GetField<uint8_t>(field.offset(), 0);
+      for (flatbuffers::uoffset_t i = 0; i < union_enum->values()->size();
+           i++) {
+        auto value = union_enum->values()->Get(i);
+        if (value->value() == type) {
+          union_object = value->object();
+          break;
+        }
+      }
+      if (union_object == nullptr) unsupported_data_ = true;
+    }
+  }
+  Write(kNewLine);
+  WriteIndent(indent);
+  Write('}');
+}
+
+void EntityJsonWriter::GenField(const reflection::Field& field,
+                                const uint8_t* data, bool is_struct,
+                                const reflection::Object* union_object,
+                                int indent) {
+  const reflection::Type& type = *field.type();
+  auto table = reinterpret_cast<const flatbuffers::Table*>(data);
+  switch (type.base_type()) {
+    case reflection::String:
+      GenString(*table->GetPointer<const flatbuffers::String*>(field.offset()));
+      break;
+    case reflection::Vector:
+      GenVector(type, table->GetPointer<const uint8_t*>(field.offset()),
+                indent);
+      break;
+    case reflection::Obj: {
+      const reflection::Object& object = *schema_->objects()->Get(type.index());
+      const uint8_t* value;
+      if (is_struct) {
+        value = data + field.offset();
+      } else if (object.is_struct()) {
+        value = table->GetStruct<const uint8_t*>(field.offset());
+      } else {
+        value = table->GetPointer<const uint8_t*>(field.offset());
+      }
+      GenObject(object, value, indent);
+      break;
+    }
+    case reflection::Union:
+      if (union_object == nullptr) {
+        unsupported_data_ = true;
+        break;
+      }
+      GenObject(*union_object,
+                table->GetPointer<const uint8_t*>(field.offset()), indent);
+      break;
+    default: {
+      // A scalar. Present fields are stored in place in both tables and
+      // structs, so just find where.
+      const uint8_t* value =
+          is_struct ? data + field.offset()
+                    : data + table->GetOptionalFieldOffset(field.offset());
+      GenScalar(type.base_type(), type.index(), value);
+      break;
+    }
+  }
+}
+
+// Convert a scalar to an int the same way GenerateText() does when looking
+// up enum identifiers.
+template <typename T>
+static int ScalarToEnumInt(const uint8_t* value) {
+  return static_cast<int>(flatbuffers::ReadScalar<T>(value));
+}
+
+template <typename T>
+static std::string ScalarToString(const uint8_t* value) {
+  return flatbuffers::NumToString(flatbuffers::ReadScalar<T>(value));
+}
+
+void EntityJsonWriter::GenScalar(reflection::BaseType base_type,
+                                 int enum_index, const uint8_t* value) {
+  // These C++ types are the ones GenerateText() uses for each base type, so
+  // that NumToString() formats the numbers identically.
+  int as_int = 0;
+  std::string text;
+  switch (base_type) {
+    case reflection::UType:
+    case reflection::Bool:
+    case reflection::UByte:
+      as_int = ScalarToEnumInt<uint8_t>(value);
+      text = ScalarToString<uint8_t>(value);
+      break;
+    case reflection::Byte:
+      as_int = ScalarToEnumInt<int8_t>(value);
+      text = ScalarToString<int8_t>(value);
+      break;
+    case reflection::Short:
+      as_int = ScalarToEnumInt<int16_t>(value);
+      text = ScalarToString<int16_t>(value);
+      break;
+    case reflection::UShort:
+      as_int = ScalarToEnumInt<uint16_t>(value);
+      text = ScalarToString<uint16_t>(value);
+      break;
+    case reflection::Int:
+      as_int = ScalarToEnumInt<int32_t>(value);
+      text = ScalarToString<int32_t>(value);
+      break;
+    case reflection::UInt:
+      as_int = ScalarToEnumInt<uint32_t>(value);
+      text = ScalarToString<uint32_t>(value);
+      break;
+    case reflection::Long:
+      as_int = ScalarToEnumInt<int64_t>(value);
+      text = ScalarToString<int64_t>(value);
+      break;
+    case reflection::ULong:
+      as_int = ScalarToEnumInt<uint64_t>(value);
+      text = ScalarToString<uint64_t>(value);
+      break;
+    // Floating point values are never enums.
+    case reflection::Float:
+      text = ScalarToString<float>(value);
+      break;
+    case reflection::Double:
+      text = ScalarToString<double>(value);
+      break;
+    default:
+      unsupported_data_ = true;
+      return;
+  }
+  if (enum_index >= 0) {
+    // Use the enum identifier, if the value has one.
+    auto values = schema_->enums()->Get(enum_index)->values();
+    for (flatbuffers::uoffset_t i = 0; i < values->size(); i++) {
+      if (values->Get(i)->value() == as_int) {
+        Write('"');
+        Write(values->Get(i)->name()->str());
+        Write('"');
+        return;
+      }
+    }
+  }
+  if (base_type == reflection::Bool) {
+    Write(as_int != 0 ? "true" : "false");
+  } else {
+    Write(text);
+  }
+}
+
+void EntityJsonWriter::GenVector(const reflection::Type& type,
+                                 const uint8_t* vec, int indent) {
+  const reflection::BaseType element_type = type.element();
+  flatbuffers::uoffset_t length =
+      flatbuffers::ReadScalar<flatbuffers::uoffset_t>(vec);
+  const uint8_t* elements = vec + sizeof(flatbuffers::uoffset_t);
+  const reflection::Object* object =
+      element_type == reflection::Obj ? schema_->objects()->Get(type.index())
+                                      : nullptr;
+  size_t element_size;
+  if (object != nullptr && object->is_struct()) {
+    element_size = object->bytesize();
+  } else if (element_type == reflection::String ||
+             element_type == reflection::Obj) {
+    element_size = sizeof(flatbuffers::uoffset_t);
+  } else {
+    element_size = flatbuffers::GetTypeSize(element_type);
+  }
+  Write('[');
+  Write(kNewLine);
+  for (flatbuffers::uoffset_t i = 0; i < length; i++) {
+    if (i) {
+      Write(',');
+      Write(kNewLine);
+    }
+    WriteIndent(indent + kIndentStep);
+    const uint8_t* element = elements + i * element_size;
+    if (object != nullptr) {
+      if (!object->is_struct()) {
+        element += flatbuffers::ReadScalar<flatbuffers::uoffset_t>(element);
+      }
+      GenObject(*object, element, indent + kIndentStep);
+    } else if (element_type == reflection::String) {
+      element += flatbuffers::ReadScalar<flatbuffers::uoffset_t>(element);
+      GenString(*reinterpret_cast<const flatbuffers::String*>(element));
+    } else {
+      GenScalar(element_type, type.index(), element);
+    }
+  }
+  Write(kNewLine);
+  WriteIndent(indent);
+  Write(']');
+}
+
+void EntityJsonWriter::GenString(const flatbuffers::String& str) {
+  Write('"');
+  const char* s = str.c_str();
+  for (flatbuffers::uoffset_t i = 0; i < str.size(); i++) {
+    char c = s[i];
+    switch (c) {
+      case '\n': Write("\\n"); break;
+      case '\t': Write("\\t"); break;
+      case '\r': Write("\\r"); break;
+      case '\b': Write("\\b"); break;
+      case '\f': Write("\\f"); break;
+      case '\"': Write("\\\""); break;
+      case '\\': Write("\\\\"); break;
+      default:
+        if (c >= ' ' && c <= '~') {
+          Write(c);
+        } else {
+          // GenerateText()'s escaping of anything else varies by version.
+          unsupported_data_ = true;
+        }
+        break;
+    }
+  }
+  Write('"');
+}
+
+const std::vector<const reflection::Field*>& EntityJsonWriter::SortedFields(
+    const reflection::Object& object) {
+  auto existing = sorted_fields_.find(&object);
+  if (existing != sorted_fields_.end()) return existing->second;
+  // The schema stores fields sorted by name; ids are in declaration order.
+  std::vector<const reflection::Field*>& fields = sorted_fields_[&object];
+  for (flatbuffers::uoffset_t i = 0; i < object.fields()->size(); i++) {
+    fields.push_back(object.fields()->Get(i));
+  }
+  std::sort(fields.begin(), fields.end(),
+            [](const reflection::Field* a, const reflection::Field* b) {
+              return a->id() < b->id();
+            });
+  return fields;
+}
+
+void EntityJsonWriter::Write(const char* text, size_t length) {
+  while (length > 0) {
+    size_t amount = std::min(length, chunk_.size() - chunk_used_);
+    memcpy(&chunk_[chunk_used_], text, amount);
+    chunk_used_ += amount;
+    text += amount;
+    length -= amount;
+    if (chunk_used_ == chunk_.size()) Flush();
+  }
+}
+
+void EntityJsonWriter::WriteIndent(int indent) {
+  static const char kSpaces[] = "                                ";
+  static const int kMaxSpaces = static_cast<int>(sizeof(kSpaces) - 1);
+  while (indent > 0) {
+    int amount = std::min(indent, kMaxSpaces);
+    Write(kSpaces, amount);
+    indent -= amount;
+  }
+}
+
+void EntityJsonWriter::Flush() {
+  if (chunk_used_ == 0) return;
+  hash_.Update(chunk_.data(), chunk_used_);
+  if (file_ != nullptr && !file_error_ &&
+      fwrite(chunk_.data(), 1, chunk_used_, file_) != chunk_used_) {
+    file_error_ = true;
+  }
+  chunk_used_ = 0;
+}
+
+// Move the complete file at `temp_path` to `path`, replacing it.
+static bool ReplaceFile(const std::string& temp_path, const std::string& path) {
+#ifdef _WIN32
+  // rename() won't replace an existing file on Windows.
+  remove(path.c_str());
+#endif  // _WIN32
+  return rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
+// Move the JSON text just written to `temp_path` into place at `json_path`,
+// unless it turns out to be unchanged.
+static bool FinishJsonFile(const std::string& temp_path,
+                           const std::string& json_path,
+                           const JsonUnchangedCheck& is_unchanged,
+                           EntityJsonExportResult* result) {
+  if (is_unchanged && is_unchanged(result->text_hash)) {
+    // Leave the existing file, and its timestamp, alone.
+    remove(temp_path.c_str());
+    result->unchanged = true;
+    return true;
+  }
+  if (!ReplaceFile(temp_path, json_path)) {
+    remove(temp_path.c_str());
+    return false;
+  }
+  result->written = true;
+  return true;
+}
+
+bool ExportEntityJson(const std::string& json_path, const uint8_t* flatbuffer,
+                      const flatbuffers::Parser* text_schema,
+                      const reflection::Schema* binary_schema,
+                      const JsonUnchangedCheck& is_unchanged,
+                      EntityJsonExportResult* result) {
+  // The text goes to a temporary file first, and is only moved into place
+  // once it's complete, so a failed export never leaves a partial file. This
+  // also means the text is only generated once even if it's unchanged.
+  const std::string temp_path = json_path + ".tmp";
+  ExportClock::time_point start;
+  if (binary_schema != nullptr) {
+    // Stream the text straight to disk rather than building it in memory.
+    EntityJsonWriter writer(binary_schema);
+    start = ExportClock::now();
+    EntityJsonWriter::Status status =
+        writer.WriteFile(temp_path, flatbuffer, &result->text_hash);
+    result->write_seconds = SecondsSince(start);
+    if (status == EntityJsonWriter::kOk) {
+      return FinishJsonFile(temp_path, json_path, is_unchanged, result);
+    }
+    remove(temp_path.c_str());
+    // Otherwise, the data needs GenerateText() to get the text exactly right.
+    if (status != EntityJsonWriter::kUnsupportedData) return false;
+  }
+  if (text_schema == nullptr) return false;
+  start = ExportClock::now();
+  std::string json;
+  GenerateText(*text_schema, flatbuffer, &json);
+  result->text_hash = HashBytes(json.data(), json.size());
+  result->generate_seconds = SecondsSince(start);
+  // The text is already in memory, so check before writing any of it.
+  if (is_unchanged && is_unchanged(result->text_hash)) {
+    result->unchanged = true;
+    return true;
+  }
+  start = ExportClock::now();
+  bool saved = fplbase::SaveFile(temp_path.c_str(), json);
+  result->write_seconds = SecondsSince(start);
+  if (!saved) {
+    remove(temp_path.c_str());
+    return false;
+  }
+  return FinishJsonFile(temp_path, json_path, JsonUnchangedCheck(), result);
+}
+
+}  // namespace scene_lab
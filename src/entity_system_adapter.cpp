@@ -14,11 +14,77 @@
 
 #include "scene_lab/entity_system_adapter.h"
 
+#include <algorithm>
+
 namespace scene_lab {
 
-const GenericEntityId EntitySystemAdapter::kNoEntityId = "";
-const GenericComponentId EntitySystemAdapter::kNoComponentId = "";
+const GenericEntityId EntitySystemAdapter::kNoEntityId = GenericEntityId();
+const GenericComponentId EntitySystemAdapter::kNoComponentId =
+    GenericComponentId();
+const uint64_t EntitySystemAdapter::kEntityIDsUntracked;
 
 EntitySystemAdapter::~EntitySystemAdapter() {}
 
+bool EntitySystemAdapter::DuplicateEntities(
+    const GenericEntityId& id, const GenericTransformArrays& offsets,
+    std::vector<GenericEntityId>* new_ids_output) {
+  GenericTransform original;
+  bool has_transform = GetEntityTransform(id, &original);
+  for (size_t i = 0; i < offsets.size(); i++) {
+    GenericEntityId new_id;
+    if (!DuplicateEntity(id, &new_id)) return false;
+    if (new_ids_output != nullptr) new_ids_output->push_back(new_id);
+    if (has_transform &&
+        !SetEntityTransform(new_id, original.Offset(offsets.Get(i)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool EntitySystemAdapter::GetEntitiesWithComponents(
+    const std::vector<GenericComponentId>& components,
+    std::vector<GenericEntityId>* ids_out) {
+  std::vector<GenericEntityId> all_entities;
+  if (!GetAllEntityIDs(&all_entities)) return false;
+  ids_out->clear();
+  std::vector<GenericComponentId> entity_components;
+  for (auto e = all_entities.begin(); e != all_entities.end(); ++e) {
+    if (!GetEntityComponentList(*e, &entity_components)) continue;
+    bool has_all = true;
+    for (auto c = components.begin(); c != components.end() && has_all; ++c) {
+      has_all = std::find(entity_components.begin(), entity_components.end(),
+                          *c) != entity_components.end();
+    }
+    if (has_all) ids_out->push_back(*e);
+  }
+  return true;
+}
+
+bool EntitySystemAdapter::GetEntityTransforms(
+    const GenericEntityId* ids, size_t count,
+    GenericTransformArrays* transforms_output) {
+  transforms_output->resize(count);
+  bool all_found = true;
+  for (size_t i = 0; i < count; i++) {
+    GenericTransform transform;
+    if (!GetEntityTransform(ids[i], &transform)) {
+      transform = GenericTransform();
+      all_found = false;
+    }
+    transforms_output->Set(i, transform);
+  }
+  return all_found;
+}
+
+bool EntitySystemAdapter::SetEntityTransforms(
+    const GenericEntityId* ids, size_t count,
+    const GenericTransformArrays& transforms) {
+  bool all_set = true;
+  for (size_t i = 0; i < count; i++) {
+    if (!SetEntityTransform(ids[i], transforms.Get(i))) all_set = false;
+  }
+  return all_set;
+}
+
 }  // namespace scene_lab
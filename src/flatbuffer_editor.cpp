@@ -18,6 +18,7 @@
 #include "flatbuffer_editor_config_generated.h"
 #include "fplbase/flatbuffer_utils.h"
 #include "fplbase/utilities.h"
+#include "scene_lab/profiler.h"
 
 namespace scene_lab {
 
@@ -157,6 +158,7 @@ void FlatbufferEditor::Update() {
 }
 
 void FlatbufferEditor::Draw() {
+  SCENE_LAB_PROFILE_ZONE("FlatbufferEditor::Draw");
   set_keyboard_in_use(false);
   if (HasFlatbufferData()) {
     edit_fields_modified_ = false;
@@ -256,6 +258,7 @@ void FlatbufferEditor::CopyTable(const void* src, std::vector<uint8_t>* dest) {
 }
 
 void FlatbufferEditor::CommitEditsToFlatbuffer() {
+  SCENE_LAB_PROFILE_ZONE("FlatbufferEditor::CommitEditsToFlatbuffer");
   bool go_again;
   do {
     go_again = VisitFlatbufferTable(
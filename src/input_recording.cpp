@@ -0,0 +1,262 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "scene_lab/input_recording.h"
+
+#include <algorithm>
+#include "flatbuffers/flatbuffers.h"
+#include "fplbase/flatbuffer_utils.h"
+#include "fplbase/utilities.h"
+#include "scene_lab/editor_controller.h"
+
+namespace scene_lab {
+
+// Bits of RecordedKey::state.
+static const uint8_t kKeyDown = 1 << 0;
+static const uint8_t kKeyWentDown = 1 << 1;
+static const uint8_t kKeyWentUp = 1 << 2;
+
+// Only the buttons EditorController reads are recorded, and they must all fit
+// in RecordedInputFrame::pointer_buttons.
+static const int kRecordedButtons = EditorController::kNumButtons;
+static_assert(kRecordedButtons <= 16, "Too many pointer buttons to record.");
+
+RecordingEditorInput::RecordingEditorInput(std::unique_ptr<EditorInput> input)
+    : wrapped_(std::move(input)), in_frame_(false) {}
+
+void RecordingEditorInput::ClearRecording() {
+  frames_.clear();
+  frame_ = Frame();
+  keys_read_.clear();
+  in_frame_ = false;
+}
+
+bool RecordingEditorInput::SaveRecording(const std::string& filename) const {
+  // Frames are only added to frames_ when the next one starts, so include the
+  // one in progress.
+  std::vector<const Frame*> to_save;
+  to_save.reserve(frames_.size() + 1);
+  for (auto frame = frames_.begin(); frame != frames_.end(); ++frame) {
+    to_save.push_back(&*frame);
+  }
+  if (in_frame_) to_save.push_back(&frame_);
+
+  flatbuffers::FlatBufferBuilder fbb;
+  std::vector<flatbuffers::Offset<RecordedInputFrame>> frames;
+  frames.reserve(to_save.size());
+  for (auto it = to_save.begin(); it != to_save.end(); ++it) {
+    const Frame* frame = *it;
+    // Most frames have no keys down, so leave the vector out entirely.
+    flatbuffers::Offset<flatbuffers::Vector<const RecordedKey*>> keys;
+    if (!frame->keys.empty()) keys = fbb.CreateVectorOfStructs(frame->keys);
+    fplbase::Vec2 position(frame->pointer_position.x,
+                           frame->pointer_position.y);
+    fplbase::Vec2 delta(frame->pointer_delta.x, frame->pointer_delta.y);
+    fplbase::Vec2i window_size(frame->window_size.x, frame->window_size.y);
+    frames.push_back(CreateRecordedInputFrame(
+        fbb, frame->delta_seconds, frame->pointer_buttons, &position, &delta,
+        &window_size, keys));
+  }
+  auto recording = CreateInputRecording(fbb, kInputRecordingVersion,
+                                        fbb.CreateVector(frames));
+  FinishInputRecordingBuffer(fbb, recording);
+
+  std::string data(reinterpret_cast<const char*>(fbb.GetBufferPointer()),
+                   fbb.GetSize());
+  if (!fplbase::SaveFile(filename.c_str(), data)) {
+    fplbase::LogError("Couldn't save input recording to %s",
+                      filename.c_str());
+    return false;
+  }
+  fplbase::LogInfo("Saved %d frames of input to %s",
+                   static_cast<int>(to_save.size()), filename.c_str());
+  return true;
+}
+
+void RecordingEditorInput::Update() {
+  Clock::time_point now = Clock::now();
+  if (in_frame_) {
+    frames_.push_back(frame_);
+    frame_ = Frame();
+    frame_.delta_seconds =
+        std::chrono::duration<float>(now - frame_start_).count();
+  }
+  in_frame_ = true;
+  frame_start_ = now;
+  keys_read_.clear();
+
+  wrapped_->Update();
+  for (int i = 0; i < kRecordedButtons; i++) {
+    if (wrapped_->PointerButtonIsDown(i)) {
+      frame_.pointer_buttons |= static_cast<uint16_t>(1 << i);
+    }
+  }
+  frame_.pointer_position = wrapped_->PointerPosition();
+  frame_.pointer_delta = wrapped_->PointerDelta();
+  frame_.window_size = wrapped_->WindowSize();
+}
+
+uint8_t RecordingEditorInput::ReadKey(fplbase::FPL_Keycode key) const {
+  uint8_t state = 0;
+  if (wrapped_->KeyIsDown(key)) state |= kKeyDown;
+  if (wrapped_->KeyWentDown(key)) state |= kKeyWentDown;
+  if (wrapped_->KeyWentUp(key)) state |= kKeyWentUp;
+  int key_code = static_cast<int>(key);
+  if (in_frame_ && std::find(keys_read_.begin(), keys_read_.end(),
+                             key_code) == keys_read_.end()) {
+    keys_read_.push_back(key_code);
+    if (state != 0) frame_.keys.push_back(RecordedKey(key_code, state));
+  }
+  return state;
+}
+
+bool RecordingEditorInput::KeyIsDown(fplbase::FPL_Keycode key) const {
+  return (ReadKey(key) & kKeyDown) != 0;
+}
+
+bool RecordingEditorInput::KeyWentDown(fplbase::FPL_Keycode key) const {
+  return (ReadKey(key) & kKeyWentDown) != 0;
+}
+
+bool RecordingEditorInput::KeyWentUp(fplbase::FPL_Keycode key) const {
+  return (ReadKey(key) & kKeyWentUp) != 0;
+}
+
+// Pointer state is sampled once a frame in Update(), so what Scene Lab sees
+// is exactly what's recorded.
+bool RecordingEditorInput::PointerButtonIsDown(int button) const {
+  return button >= 0 && button < kRecordedButtons &&
+         (frame_.pointer_buttons & (1 << button)) != 0;
+}
+
+mathfu::vec2 RecordingEditorInput::PointerPosition() const {
+  return frame_.pointer_position;
+}
+
+mathfu::vec2 RecordingEditorInput::PointerDelta() const {
+  return frame_.pointer_delta;
+}
+
+mathfu::vec2i RecordingEditorInput::WindowSize() const {
+  return frame_.window_size;
+}
+
+void RecordingEditorInput::SetRelativeMouseMode(bool relative) {
+  wrapped_->SetRelativeMouseMode(relative);
+}
+
+bool ReplayEditorInput::LoadRecording(const std::string& filename) {
+  std::string data;
+  if (!fplbase::LoadFile(filename.c_str(), &data)) {
+    fplbase::LogError("Couldn't load input recording %s", filename.c_str());
+    return false;
+  }
+  return SetRecording(data);
+}
+
+bool ReplayEditorInput::SetRecording(const std::string& data) {
+  flatbuffers::Verifier verifier(
+      reinterpret_cast<const uint8_t*>(data.c_str()), data.length());
+  if (!VerifyInputRecordingBuffer(verifier)) {
+    fplbase::LogError("Input recording is invalid.");
+    return false;
+  }
+  uint32_t version = GetInputRecording(data.c_str())->version();
+  if (version != kInputRecordingVersion) {
+    fplbase::LogError("Input recording version %u isn't supported.", version);
+    return false;
+  }
+  data_ = data;
+  Rewind();
+  return true;
+}
+
+size_t ReplayEditorInput::frame_count() const {
+  if (data_.empty() || recording()->frames() == nullptr) return 0;
+  return recording()->frames()->size();
+}
+
+double ReplayEditorInput::NextFrameDeltaSeconds() const {
+  if (finished()) return 0;
+  return recording()->frames()->Get(
+      static_cast<flatbuffers::uoffset_t>(next_frame_))->delta_seconds();
+}
+
+void ReplayEditorInput::Rewind() {
+  next_frame_ = 0;
+  frame_ = nullptr;
+  past_end_ = false;
+}
+
+void ReplayEditorInput::Update() {
+  if (finished()) {
+    past_end_ = true;
+    return;
+  }
+  frame_ = recording()->frames()->Get(
+      static_cast<flatbuffers::uoffset_t>(next_frame_));
+  next_frame_++;
+}
+
+uint8_t ReplayEditorInput::KeyState(fplbase::FPL_Keycode key) const {
+  if (frame_ == nullptr || past_end_ || frame_->keys() == nullptr) return 0;
+  auto keys = frame_->keys();
+  for (flatbuffers::uoffset_t i = 0; i < keys->size(); i++) {
+    if (keys->Get(i)->key() == static_cast<int>(key)) {
+      return keys->Get(i)->state();
+    }
+  }
+  return 0;
+}
+
+bool ReplayEditorInput::KeyIsDown(fplbase::FPL_Keycode key) const {
+  return (KeyState(key) & kKeyDown) != 0;
+}
+
+bool ReplayEditorInput::KeyWentDown(fplbase::FPL_Keycode key) const {
+  return (KeyState(key) & kKeyWentDown) != 0;
+}
+
+bool ReplayEditorInput::KeyWentUp(fplbase::FPL_Keycode key) const {
+  return (KeyState(key) & kKeyWentUp) != 0;
+}
+
+bool ReplayEditorInput::PointerButtonIsDown(int button) const {
+  if (frame_ == nullptr || past_end_) return false;
+  return button >= 0 && button < kRecordedButtons &&
+         (frame_->pointer_buttons() & (1 << button)) != 0;
+}
+
+mathfu::vec2 ReplayEditorInput::PointerPosition() const {
+  if (frame_ == nullptr || frame_->pointer_position() == nullptr) {
+    return mathfu::kZeros2f;
+  }
+  return fplbase::LoadVec2(frame_->pointer_position());
+}
+
+mathfu::vec2 ReplayEditorInput::PointerDelta() const {
+  if (frame_ == nullptr || past_end_ || frame_->pointer_delta() == nullptr) {
+    return mathfu::kZeros2f;
+  }
+  return fplbase::LoadVec2(frame_->pointer_delta());
+}
+
+mathfu::vec2i ReplayEditorInput::WindowSize() const {
+  if (frame_ == nullptr || frame_->window_size() == nullptr) {
+    return mathfu::kZeros2i;
+  }
+  return fplbase::LoadVec2i(frame_->window_size());
+}
+
+}  // namespace scene_lab
@@ -0,0 +1,53 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "scene_lab/interned_id.h"
+
+namespace scene_lab {
+
+static const std::string& EmptyString() {
+  static const std::string* empty = new std::string();
+  return *empty;
+}
+
+InternedId InternedIdTable::Intern(const std::string& str) {
+  if (str.empty()) return InternedId();
+  auto inserted = indices_.insert(
+      std::make_pair(str, static_cast<uint32_t>(strings_.size() + 1)));
+  if (inserted.second) strings_.push_back(&inserted.first->first);
+  return InternedId(inserted.first->second, generation_);
+}
+
+InternedId InternedIdTable::Find(const std::string& str) const {
+  auto index = indices_.find(str);
+  return index != indices_.end() ? InternedId(index->second, generation_)
+                                 : InternedId();
+}
+
+const std::string& InternedIdTable::GetString(const InternedId& id) const {
+  if (id.empty() || id.generation_ != generation_ ||
+      id.index_ > strings_.size()) {
+    return EmptyString();
+  }
+  return *strings_[id.index_ - 1];
+}
+
+void InternedIdTable::Clear() {
+  // Swap rather than clear(), so the memory is actually freed.
+  std::unordered_map<std::string, uint32_t>().swap(indices_);
+  std::vector<const std::string*>().swap(strings_);
+  generation_++;
+}
+
+}  // namespace scene_lab
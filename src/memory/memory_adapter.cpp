@@ -0,0 +1,1358 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "scene_lab/memory/memory_adapter.h"
+
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <string>
+#include "flatbuffers/util.h"
+#include "fplbase/utilities.h"
+
+namespace scene_lab_memory {
+
+using scene_lab::GenericEntityId;
+using scene_lab::GenericComponentId;
+using scene_lab::GenericPrototypeId;
+
+static const char kMetaTableName[] = "corgi.MetaDef";
+static const char kTransformTableName[] = "corgi.TransformDef";
+static const char kNewEntityIdPrefix[] = "entity_";
+static const char kGeneratedFilePrefix[] = "generated_";
+static const char kGeneratedPrototypePrefix[] = "prototype_";
+
+static const float kDegreesToRadians = static_cast<float>(M_PI / 180.0);
+static const float kRadiansToDegrees = static_cast<float>(180.0 / M_PI);
+static const float kRayEpsilon = 1e-6f;
+
+typedef flatbuffers::Vector<flatbuffers::Offset<flatbuffers::Table>>
+    TableVector;
+typedef flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>
+    StringVector;
+
+/// A struct of N floats, laid out as FlatBuffers stores it.
+template <int N>
+struct FloatStruct {
+  float values[N];
+};
+
+// A FlatBuffer holding an empty table, so every field has its default value.
+static std::vector<uint8_t> CreateEmptyTable() {
+  flatbuffers::FlatBufferBuilder builder;
+  flatbuffers::uoffset_t start = builder.StartTable();
+  builder.Finish(
+      flatbuffers::Offset<flatbuffers::Table>(builder.EndTable(start, 0)));
+  return std::vector<uint8_t>(builder.GetBufferPointer(),
+                              builder.GetBufferPointer() + builder.GetSize());
+}
+
+// Find the first field of `object` that's a vector of tables, and the type
+// of table it holds.
+static const reflection::Field* FindTableVectorField(
+    const reflection::Schema& schema, const reflection::Object& object,
+    const reflection::Object** element_out) {
+  auto fields = object.fields();
+  for (flatbuffers::uoffset_t i = 0; i < fields->size(); i++) {
+    const reflection::Field* field = fields->Get(i);
+    const reflection::Type& type = *field->type();
+    if (type.base_type() != reflection::Vector ||
+        type.element() != reflection::Obj) {
+      continue;
+    }
+    const reflection::Object* element = schema.objects()->Get(type.index());
+    if (element->is_struct()) continue;
+    *element_out = element;
+    return field;
+  }
+  return nullptr;
+}
+
+// If `field` is a struct made only of floats, return how many; otherwise 0.
+static int FloatStructSize(const reflection::Schema& schema,
+                           const reflection::Field* field) {
+  if (field == nullptr || field->type()->base_type() != reflection::Obj) {
+    return 0;
+  }
+  const reflection::Object* object =
+      schema.objects()->Get(field->type()->index());
+  if (!object->is_struct()) return 0;
+  auto fields = object->fields();
+  for (flatbuffers::uoffset_t i = 0; i < fields->size(); i++) {
+    if (fields->Get(i)->type()->base_type() != reflection::Float) return 0;
+  }
+  return static_cast<int>(fields->size());
+}
+
+// Read a struct of `count` floats from a table. Returns false if the field
+// isn't set or isn't that kind of struct.
+static bool ReadFloats(const reflection::Schema& schema,
+                       const flatbuffers::Table& table,
+                       const reflection::Field* field, int count,
+                       float* values_out) {
+  if (FloatStructSize(schema, field) != count) return false;
+  const uint8_t* data = table.GetStruct<const uint8_t*>(field->offset());
+  if (data == nullptr) return false;
+  for (int i = 0; i < count; i++) {
+    values_out[i] = flatbuffers::ReadScalar<float>(data + i * sizeof(float));
+  }
+  return true;
+}
+
+// Add a struct of N floats to the table being built, if `field` is that kind
+// of struct.
+template <int N>
+static void AddFloats(const reflection::Schema& schema,
+                      const reflection::Field* field, const float (&values)[N],
+                      flatbuffers::FlatBufferBuilder* builder) {
+  if (FloatStructSize(schema, field) != N) return;
+  FloatStruct<N> value;
+  for (int i = 0; i < N; i++) {
+    value.values[i] = flatbuffers::EndianScalar(values[i]);
+  }
+  builder->AddStruct(field->offset(), &value);
+}
+
+// Copy a table into its own FlatBuffer, as its root.
+static void CopyToBuffer(const reflection::Schema& schema,
+                         const reflection::Object& object,
+                         const flatbuffers::Table& table,
+                         std::vector<uint8_t>* buffer_out) {
+  flatbuffers::FlatBufferBuilder builder;
+  builder.Finish(flatbuffers::CopyTable(builder, schema, object, table));
+  buffer_out->assign(builder.GetBufferPointer(),
+                     builder.GetBufferPointer() + builder.GetSize());
+}
+
+// Find where a ray enters an axis-aligned box, using the slab method.
+static bool RayHitsBox(const mathfu::vec3& origin,
+                       const mathfu::vec3& direction,
+                       const mathfu::vec3& box_min,
+                       const mathfu::vec3& box_max, float* distance_out) {
+  float t_near = 0.0f;
+  float t_far = std::numeric_limits<float>::max();
+  for (int axis = 0; axis < 3; axis++) {
+    if (fabsf(direction[axis]) < kRayEpsilon) {
+      // Parallel to this slab, so it must start inside it.
+      if (origin[axis] < box_min[axis] || origin[axis] > box_max[axis]) {
+        return false;
+      }
+      continue;
+    }
+    float t1 = (box_min[axis] - origin[axis]) / direction[axis];
+    float t2 = (box_max[axis] - origin[axis]) / direction[axis];
+    if (t1 > t2) std::swap(t1, t2);
+    t_near = std::max(t_near, t1);
+    t_far = std::min(t_far, t2);
+    if (t_near > t_far) return false;
+  }
+  *distance_out = t_near;
+  return true;
+}
+
+MemoryAdapter::Entity::Entity()
+    : has_transform(false),
+      bounds_min(-0.5f),
+      bounds_max(0.5f),
+      highlighted(false) {}
+
+MemoryAdapter::MemoryAdapter()
+    : schema_(nullptr),
+      entity_list_field_(nullptr),
+      entity_object_(nullptr),
+      component_list_field_(nullptr),
+      instance_object_(nullptr),
+      data_field_(nullptr),
+      data_type_field_(nullptr),
+      meta_type_(kNoComponentType),
+      transform_type_(kNoComponentType),
+      entity_ids_generation_(kEntityIDsUntracked + 1),
+      next_entity_number_(0),
+      cycle_index_(0) {
+  viewport_.vertical_angle = static_cast<float>(M_PI / 4.0);
+  viewport_.aspect_ratio = 16.0f / 9.0f;
+}
+
+bool MemoryAdapter::SetSchema(const std::string& binary_schema,
+                              const std::string& text_schema) {
+  schema_data_ = binary_schema;
+  schema_text_ = text_schema;
+  schema_ = nullptr;
+  entity_list_field_ = nullptr;
+  entity_object_ = nullptr;
+  component_list_field_ = nullptr;
+  instance_object_ = nullptr;
+  data_field_ = nullptr;
+  data_type_field_ = nullptr;
+  component_types_.clear();
+  component_templates_.clear();
+  meta_type_ = kNoComponentType;
+  transform_type_ = kNoComponentType;
+
+  flatbuffers::Verifier verifier(
+      reinterpret_cast<const uint8_t*>(schema_data_.c_str()),
+      schema_data_.length());
+  if (!reflection::VerifySchemaBuffer(verifier)) {
+    fplbase::LogError("MemoryAdapter: Binary schema is invalid.");
+    return false;
+  }
+  const reflection::Schema* schema =
+      reflection::GetSchema(schema_data_.c_str());
+
+  // Root table -> vector of entities -> vector of component instances, each
+  // holding a union of components.
+  if (schema->root_table() != nullptr) {
+    entity_list_field_ = FindTableVectorField(*schema, *schema->root_table(),
+                                              &entity_object_);
+  }
+  if (entity_list_field_ != nullptr) {
+    component_list_field_ =
+        FindTableVectorField(*schema, *entity_object_, &instance_object_);
+  }
+  if (component_list_field_ != nullptr) {
+    auto fields = instance_object_->fields();
+    for (flatbuffers::uoffset_t i = 0; i < fields->size(); i++) {
+      if (fields->Get(i)->type()->base_type() == reflection::Union) {
+        data_field_ = fields->Get(i);
+      }
+    }
+    for (flatbuffers::uoffset_t i = 0;
+         data_field_ != nullptr && i < fields->size(); i++) {
+      const reflection::Type& type = *fields->Get(i)->type();
+      if (type.base_type() == reflection::UType &&
+          type.index() == data_field_->type()->index()) {
+        data_type_field_ = fields->Get(i);
+      }
+    }
+  }
+  if (data_field_ == nullptr || data_type_field_ == nullptr) {
+    fplbase::LogError(
+        "MemoryAdapter: Binary schema doesn't describe an entity list.");
+    return false;
+  }
+
+  auto values = schema->enums()->Get(data_field_->type()->index())->values();
+  for (flatbuffers::uoffset_t i = 0; i < values->size(); i++) {
+    const reflection::EnumVal* value = values->Get(i);
+    if (value->object() == nullptr) continue;  // NONE
+    const std::string table_name = value->object()->name()->str();
+    ComponentType type;
+    type.id = ComponentIdFromString(table_name);
+    type.object = schema->objects()->LookupByKey(table_name.c_str());
+    type.union_type = static_cast<uint8_t>(value->value());
+    if (type.object == nullptr) continue;
+    if (table_name == kMetaTableName) {
+      meta_type_ = static_cast<int>(component_types_.size());
+    } else if (table_name == kTransformTableName) {
+      transform_type_ = static_cast<int>(component_types_.size());
+    }
+    component_types_.push_back(type);
+  }
+  schema_ = schema;
+  return true;
+}
+
+bool MemoryAdapter::LoadSchema(const std::string& binary_schema_file,
+                               const std::string& text_schema_file) {
+  std::string binary_schema;
+  std::string text_schema;
+  if (!fplbase::LoadFile(binary_schema_file.c_str(), &binary_schema)) {
+    fplbase::LogError("MemoryAdapter: Couldn't load binary schema %s",
+                      binary_schema_file.c_str());
+    return false;
+  }
+  if (!text_schema_file.empty() &&
+      !fplbase::LoadFile(text_schema_file.c_str(), &text_schema)) {
+    fplbase::LogError("MemoryAdapter: Couldn't load text schema %s",
+                      text_schema_file.c_str());
+  }
+  return SetSchema(binary_schema, text_schema);
+}
+
+int MemoryAdapter::LoadPrototypesFromMemory(const uint8_t* entity_list,
+                                            size_t size) {
+  std::vector<Entity> loaded;
+  std::vector<std::vector<std::string>> child_ids;
+  if (!ReadEntityList(entity_list, size, &loaded, &child_ids)) return 0;
+  int count = 0;
+  for (auto prototype = loaded.begin(); prototype != loaded.end();
+       ++prototype) {
+    if (prototype->id.empty()) continue;
+    if (prototypes_.find(prototype->id) == prototypes_.end()) {
+      prototype_ids_.push_back(prototype->id);
+    }
+    GenericPrototypeId id = prototype->id;
+    prototypes_[id] = std::move(*prototype);
+    count++;
+  }
+  return count;
+}
+
+int MemoryAdapter::LoadEntitiesFromMemory(
+    const uint8_t* entity_list, size_t size, const std::string& source_file,
+    std::vector<GenericEntityId>* ids_out) {
+  std::vector<Entity> loaded;
+  std::vector<std::vector<std::string>> child_ids;
+  if (!ReadEntityList(entity_list, size, &loaded, &child_ids)) return 0;
+
+  // The IDs the file uses, mapped to the IDs the entities ended up with.
+  std::unordered_map<std::string, GenericEntityId> file_ids;
+  std::vector<GenericEntityId> new_ids;
+  new_ids.reserve(loaded.size());
+  for (auto entity = loaded.begin(); entity != loaded.end(); ++entity) {
+    entity->source_file = source_file;
+    ApplyPrototype(&*entity);
+    const std::string file_id = EntityIdString(entity->id);
+    Entity* added = AddEntity(&*entity);
+    if (!file_id.empty()) file_ids[file_id] = added->id;
+    new_ids.push_back(added->id);
+  }
+
+  // Now every entity is loaded, link up the hierarchy.
+  for (size_t i = 0; i < new_ids.size(); i++) {
+    for (auto child_id = child_ids[i].begin(); child_id != child_ids[i].end();
+         ++child_id) {
+      auto found = file_ids.find(*child_id);
+      if (found == file_ids.end()) continue;
+      Entity* child = GetEntity(found->second);
+      if (child == nullptr || child->parent != kNoEntityId) continue;
+      SetEntityParent(found->second, new_ids[i]);
+    }
+  }
+
+  if (ids_out != nullptr) {
+    ids_out->insert(ids_out->end(), new_ids.begin(), new_ids.end());
+  }
+  return static_cast<int>(new_ids.size());
+}
+
+int MemoryAdapter::LoadEntitiesFromFile(
+    const std::string& filename, std::vector<GenericEntityId>* ids_out) {
+  // Hold a reference so the data can't go away while we're loading it.
+  SharedFileBuffer data;
+  auto cached = file_cache_.find(filename);
+  if (cached != file_cache_.end()) {
+    data = cached->second;
+  } else {
+    std::string contents;
+    if (!fplbase::LoadFile(filename.c_str(), &contents)) {
+      fplbase::LogError("MemoryAdapter: Couldn't load entity file %s",
+                        filename.c_str());
+      return 0;
+    }
+    data = std::make_shared<const std::vector<uint8_t>>(contents.begin(),
+                                                        contents.end());
+  }
+  return LoadEntitiesFromMemory(data->data(), data->size(),
+                                flatbuffers::StripExtension(filename),
+                                ids_out);
+}
+
+int MemoryAdapter::LoadComponentTemplatesFromMemory(
+    const uint8_t* entity_list, size_t size) {
+  std::vector<Entity> loaded;
+  std::vector<std::vector<std::string>> child_ids;
+  if (!ReadEntityList(entity_list, size, &loaded, &child_ids)) return 0;
+  component_templates_.resize(component_types_.size());
+  int count = 0;
+  for (auto entity = loaded.begin(); entity != loaded.end(); ++entity) {
+    for (auto component = entity->components.begin();
+         component != entity->components.end(); ++component) {
+      int type = GetComponentType(component->id);
+      if (type == kNoComponentType) continue;
+      component_templates_[type].push_back(std::move(component->data));
+      count++;
+    }
+  }
+  return count;
+}
+
+int MemoryAdapter::LoadComponentTemplatesFromFile(
+    const std::string& filename) {
+  std::string contents;
+  if (!fplbase::LoadFile(filename.c_str(), &contents)) {
+    fplbase::LogError("MemoryAdapter: Couldn't load entity file %s",
+                      filename.c_str());
+    return 0;
+  }
+  return LoadComponentTemplatesFromMemory(
+      reinterpret_cast<const uint8_t*>(contents.c_str()), contents.size());
+}
+
+bool MemoryAdapter::CreateScene(const SceneOptions& options,
+                                std::vector<GenericEntityId>* ids_out) {
+  std::vector<int> extra_types;
+  if (!GetGeneratedComponentTypes(options, &extra_types)) return false;
+  std::mt19937 random(options.seed);
+  std::uniform_real_distribution<float> position(-options.extent,
+                                                 options.extent);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  size_t file_count = std::max(options.file_count, static_cast<size_t>(1));
+
+  std::vector<GenericEntityId> new_ids;
+  new_ids.reserve(options.entity_count);
+  // How deep each new entity is, and how many children it has.
+  std::vector<size_t> depths;
+  std::vector<size_t> child_counts;
+  depths.reserve(options.entity_count);
+  child_counts.reserve(options.entity_count);
+  // The new entities in each file that can still be given children.
+  std::vector<std::vector<size_t>> open_parents(file_count);
+  for (size_t i = 0; i < options.entity_count; i++) {
+    Entity entity;
+    entity.source_file = kGeneratedFilePrefix +
+                         flatbuffers::NumToString(i % file_count);
+    // Children are parented to an earlier entity in the same file.
+    std::vector<size_t>& open = open_parents[i % file_count];
+    GenericEntityId parent;
+    size_t depth = 0;
+    if (!open.empty() && unit(random) < options.child_fraction) {
+      std::uniform_int_distribution<size_t> pick(0, open.size() - 1);
+      size_t slot = pick(random);
+      size_t parent_index = open[slot];
+      parent = new_ids[parent_index];
+      depth = depths[parent_index] + 1;
+      if (++child_counts[parent_index] == options.max_children) {
+        open[slot] = open.back();
+        open.pop_back();
+      }
+    }
+    float spread = parent == kNoEntityId ? 1.0f : 0.05f;
+    entity.has_transform = true;
+    entity.transform.position =
+        mathfu::vec3(position(random), position(random), position(random)) *
+        spread;
+    entity.transform.orientation = mathfu::quat::FromAngleAxis(
+        unit(random) * static_cast<float>(2.0 * M_PI), mathfu::kAxisZ3f);
+    entity.transform.scale = mathfu::vec3(0.5f + unit(random) * 1.5f);
+    if (options.prototype_fraction > 0 && !prototype_ids_.empty() &&
+        unit(random) < options.prototype_fraction) {
+      std::uniform_int_distribution<size_t> pick(0, prototype_ids_.size() - 1);
+      entity.prototype = prototype_ids_[pick(random)];
+      ApplyPrototype(&entity);
+    } else {
+      AddGeneratedComponents(extra_types, i, options.components_per_entity,
+                             &entity);
+    }
+    Entity* added = AddEntity(&entity);
+    new_ids.push_back(added->id);
+    depths.push_back(depth);
+    child_counts.push_back(0);
+    if (parent != kNoEntityId) SetEntityParent(added->id, parent);
+    if (options.max_depth == 0 || depth < options.max_depth) {
+      open.push_back(i);
+    }
+  }
+
+  if (ids_out != nullptr) {
+    ids_out->insert(ids_out->end(), new_ids.begin(), new_ids.end());
+  }
+  return true;
+}
+
+bool MemoryAdapter::CreatePrototypes(size_t count,
+                                     const SceneOptions& options,
+                                     std::vector<GenericPrototypeId>* ids_out) {
+  std::vector<int> extra_types;
+  if (!GetGeneratedComponentTypes(options, &extra_types)) return false;
+  size_t number = 0;
+  for (size_t i = 0; i < count; i++) {
+    Entity prototype;
+    do {
+      prototype.id = EntityIdFromString(kGeneratedPrototypePrefix +
+                                        flatbuffers::NumToString(number++));
+    } while (prototypes_.find(prototype.id) != prototypes_.end());
+    AddGeneratedComponents(extra_types, i, options.components_per_entity,
+                           &prototype);
+    GenericPrototypeId id = prototype.id;
+    prototype_ids_.push_back(id);
+    prototypes_[id] = std::move(prototype);
+    if (ids_out != nullptr) ids_out->push_back(id);
+  }
+  return true;
+}
+
+bool MemoryAdapter::SerializePrototypes(std::vector<uint8_t>* buffer_out) {
+  std::vector<const Entity*> prototypes;
+  prototypes.reserve(prototype_ids_.size());
+  for (auto id = prototype_ids_.begin(); id != prototype_ids_.end(); ++id) {
+    prototypes.push_back(&prototypes_.find(*id)->second);
+  }
+  return SerializeEntityList(prototypes, buffer_out);
+}
+
+void MemoryAdapter::Clear() {
+  entities_.clear();
+  entity_ids_.clear();
+  cycle_index_ = 0;
+  // Nothing refers to the old entities' IDs now, so free them. The prototypes
+  // are kept, so they're given their IDs again.
+  std::vector<Entity> prototypes;
+  std::vector<std::string> names;
+  std::vector<std::string> prototype_names;
+  for (auto id = prototype_ids_.begin(); id != prototype_ids_.end(); ++id) {
+    prototypes.push_back(std::move(prototypes_[*id]));
+    names.push_back(EntityIdString(*id));
+    prototype_names.push_back(EntityIdString(prototypes.back().prototype));
+  }
+  prototypes_.clear();
+  prototype_ids_.clear();
+  EntitySystemAdapter::ClearEntityIds();
+  for (size_t i = 0; i < prototypes.size(); i++) {
+    GenericPrototypeId id = EntityIdFromString(names[i]);
+    prototypes[i].id = id;
+    prototypes[i].prototype = EntityIdFromString(prototype_names[i]);
+    prototype_ids_.push_back(id);
+    prototypes_[id] = std::move(prototypes[i]);
+  }
+  InvalidateEntityIDs();
+}
+
+bool MemoryAdapter::SetEntityBounds(const GenericEntityId& id,
+                                    const mathfu::vec3& min,
+                                    const mathfu::vec3& max) {
+  Entity* entity = GetEntity(id);
+  if (entity == nullptr) return false;
+  entity->bounds_min = min;
+  entity->bounds_max = max;
+  return true;
+}
+
+bool MemoryAdapter::GetEntityWorldTransform(
+    const GenericEntityId& id, GenericTransform* transform_output) const {
+  const Entity* entity = GetEntity(id);
+  if (entity == nullptr || !entity->has_transform) return false;
+  GenericTransform world = entity->transform;
+  for (const Entity* parent = GetEntity(entity->parent); parent != nullptr;
+       parent = GetEntity(parent->parent)) {
+    if (!parent->has_transform) continue;
+    const GenericTransform& local = parent->transform;
+    world.position =
+        local.position + local.orientation * (local.scale * world.position);
+    world.orientation = local.orientation * world.orientation;
+    world.scale = local.scale * world.scale;
+  }
+  if (transform_output != nullptr) *transform_output = world;
+  return true;
+}
+
+bool MemoryAdapter::IsEntityHighlighted(const GenericEntityId& id) const {
+  const Entity* entity = GetEntity(id);
+  return entity != nullptr && entity->highlighted;
+}
+
+bool MemoryAdapter::EntityExists(const GenericEntityId& id) {
+  return GetEntity(id) != nullptr;
+}
+
+bool MemoryAdapter::GetEntityTransform(const GenericEntityId& id,
+                                       GenericTransform* transform_output) {
+  const Entity* entity = GetEntity(id);
+  if (entity == nullptr || !entity->has_transform) return false;
+  if (transform_output != nullptr) *transform_output = entity->transform;
+  return true;
+}
+
+bool MemoryAdapter::SetEntityTransform(const GenericEntityId& id,
+                                       const GenericTransform& transform) {
+  Entity* entity = GetEntity(id);
+  if (entity == nullptr || !entity->has_transform) return false;
+  entity->transform = transform;
+  return true;
+}
+
+bool MemoryAdapter::GetEntityChildren(
+    const GenericEntityId& id, std::vector<GenericEntityId>* children_out) {
+  const Entity* entity = GetEntity(id);
+  if (entity == nullptr) return false;
+  if (children_out != nullptr) *children_out = entity->children;
+  return true;
+}
+
+bool MemoryAdapter::GetEntityParent(const GenericEntityId& id,
+                                    GenericEntityId* parent_out) {
+  const Entity* entity = GetEntity(id);
+  if (entity == nullptr) return false;
+  if (parent_out != nullptr) *parent_out = entity->parent;
+  return true;
+}
+
+bool MemoryAdapter::SetEntityParent(const GenericEntityId& child,
+                                    const GenericEntityId& parent) {
+  Entity* child_entity = GetEntity(child);
+  if (child_entity == nullptr) return false;
+  if (parent == kNoEntityId) {
+    DetachFromParent(child_entity);
+    return true;
+  }
+  Entity* parent_entity = GetEntity(parent);
+  if (parent_entity == nullptr) return false;
+  // Don't let an entity become its own ancestor.
+  for (const Entity* ancestor = parent_entity; ancestor != nullptr;
+       ancestor = GetEntity(ancestor->parent)) {
+    if (ancestor == child_entity) return false;
+  }
+  DetachFromParent(child_entity);
+  child_entity->parent = parent_entity->id;
+  parent_entity->children.push_back(child_entity->id);
+  return true;
+}
+
+bool MemoryAdapter::GetCamera(GenericCamera* camera) {
+  if (camera != nullptr) *camera = camera_;
+  return true;
+}
+
+bool MemoryAdapter::SetCamera(const GenericCamera& camera) {
+  camera_ = camera;
+  return true;
+}
+
+bool MemoryAdapter::GetViewportSettings(ViewportSettings* viewport) {
+  if (viewport != nullptr) *viewport = viewport_;
+  return true;
+}
+
+bool MemoryAdapter::DuplicateEntity(const GenericEntityId& id,
+                                    GenericEntityId* new_id_output) {
+  const Entity* original = GetEntity(id);
+  if (original == nullptr) return false;
+  Entity copy = *original;
+  copy.id = kNoEntityId;
+  copy.children.clear();
+  copy.highlighted = false;
+  Entity* added = AddEntity(&copy);
+  Entity* parent = GetEntity(added->parent);
+  if (parent != nullptr) parent->children.push_back(added->id);
+  if (new_id_output != nullptr) *new_id_output = added->id;
+  return true;
+}
+
+bool MemoryAdapter::CreateEntity(GenericEntityId* new_id_output) {
+  Entity entity;
+  Entity* added = AddEntity(&entity);
+  if (new_id_output != nullptr) *new_id_output = added->id;
+  return true;
+}
+
+bool MemoryAdapter::CreateEntityFromPrototype(
+    const GenericPrototypeId& prototype, GenericEntityId* new_id_output) {
+  if (prototypes_.find(prototype) == prototypes_.end()) return false;
+  Entity entity;
+  entity.prototype = prototype;
+  ApplyPrototype(&entity);
+  Entity* added = AddEntity(&entity);
+  if (new_id_output != nullptr) *new_id_output = added->id;
+  return true;
+}
+
+bool MemoryAdapter::DeleteEntity(const GenericEntityId& id) {
+  // Copy the ID, in case it refers to something we're about to remove.
+  GenericEntityId key = id;
+  Entity* entity = GetEntity(key);
+  if (entity == nullptr) return false;
+  DetachFromParent(entity);
+  for (auto child_id = entity->children.begin();
+       child_id != entity->children.end(); ++child_id) {
+    Entity* child = GetEntity(*child_id);
+    if (child != nullptr) child->parent = kNoEntityId;
+  }
+  entities_.erase(key);
+  entity_ids_.erase(std::find(entity_ids_.begin(), entity_ids_.end(), key));
+  if (cycle_index_ >= entity_ids_.size()) cycle_index_ = 0;
+  InvalidateEntityIDs();
+  return true;
+}
+
+bool MemoryAdapter::SetEntityHighlighted(const GenericEntityId& id,
+                                         bool is_highlighted) {
+  if (id == kNoEntityId && !is_highlighted) {
+    for (auto entity = entities_.begin(); entity != entities_.end();
+         ++entity) {
+      entity->second.highlighted = false;
+    }
+    return true;
+  }
+  Entity* entity = GetEntity(id);
+  if (entity == nullptr) return false;
+  entity->highlighted = is_highlighted;
+  return true;
+}
+
+bool MemoryAdapter::GetRayIntersection(
+    const mathfu::vec3& start_point, const mathfu::vec3& direction,
+    GenericEntityId* entity_output, mathfu::vec3* intersection_point_output) {
+  GenericEntityId closest;
+  float closest_distance = std::numeric_limits<float>::max();
+  for (auto id = entity_ids_.begin(); id != entity_ids_.end(); ++id) {
+    GenericTransform world;
+    if (!GetEntityWorldTransform(*id, &world)) continue;
+    // Find the world space box around the entity's transformed bounds.
+    const Entity& entity = *GetEntity(*id);
+    mathfu::vec3 box_min, box_max;
+    for (int corner = 0; corner < 8; corner++) {
+      mathfu::vec3 local(
+          (corner & 1) ? entity.bounds_max[0] : entity.bounds_min[0],
+          (corner & 2) ? entity.bounds_max[1] : entity.bounds_min[1],
+          (corner & 4) ? entity.bounds_max[2] : entity.bounds_min[2]);
+      mathfu::vec3 point =
+          world.position + world.orientation * (world.scale * local);
+      box_min = corner == 0 ? point : mathfu::vec3::Min(box_min, point);
+      box_max = corner == 0 ? point : mathfu::vec3::Max(box_max, point);
+    }
+    float distance;
+    if (RayHitsBox(start_point, direction, box_min, box_max, &distance) &&
+        distance < closest_distance) {
+      closest = *id;
+      closest_distance = distance;
+    }
+  }
+  if (closest == kNoEntityId) return false;
+  if (entity_output != nullptr) *entity_output = closest;
+  if (intersection_point_output != nullptr) {
+    *intersection_point_output = start_point + direction * closest_distance;
+  }
+  return true;
+}
+
+bool MemoryAdapter::CycleEntities(int direction,
+                                  GenericEntityId* next_entity) {
+  if (entity_ids_.empty()) return false;
+  if (direction == 0) {
+    // Reset to the beginning.
+    cycle_index_ = 0;
+  } else {
+    int count = static_cast<int>(entity_ids_.size());
+    int index = (static_cast<int>(cycle_index_) + direction % count + count) %
+                count;
+    cycle_index_ = static_cast<size_t>(index);
+  }
+  if (next_entity != nullptr) *next_entity = entity_ids_[cycle_index_];
+  return true;
+}
+
+bool MemoryAdapter::GetAllEntityIDs(std::vector<GenericEntityId>* ids_out) {
+  if (ids_out != nullptr) *ids_out = entity_ids_;
+  return true;
+}
+
+bool MemoryAdapter::GetAllPrototypeIDs(
+    std::vector<GenericPrototypeId>* ids_out) {
+  if (ids_out != nullptr) *ids_out = prototype_ids_;
+  return true;
+}
+
+bool MemoryAdapter::GetEntityName(const GenericEntityId& id,
+                                  std::string* name_out) {
+  if (GetEntity(id) == nullptr) return false;
+  if (name_out != nullptr) *name_out = EntityIdString(id);
+  return true;
+}
+
+bool MemoryAdapter::GetEntityDescription(const GenericEntityId& id,
+                                         std::string* description_out) {
+  const Entity* entity = GetEntity(id);
+  if (entity == nullptr || entity->prototype.empty()) return false;
+  if (description_out != nullptr) {
+    *description_out = EntityIdString(entity->prototype);
+  }
+  return true;
+}
+
+bool MemoryAdapter::GetEntitySourceFile(const GenericEntityId& id,
+                                        std::string* source_file_out) {
+  const Entity* entity = GetEntity(id);
+  if (entity == nullptr) return false;
+  if (source_file_out != nullptr) *source_file_out = entity->source_file;
+  return true;
+}
+
+bool MemoryAdapter::GetSchema(const reflection::Schema** schema_out) {
+  if (schema_ == nullptr) return false;
+  if (schema_out != nullptr) *schema_out = schema_;
+  return true;
+}
+
+bool MemoryAdapter::GetTextSchema(std::string* schema_out) {
+  if (schema_text_.length() > 0) {
+    if (schema_out != nullptr) *schema_out = schema_text_;
+    return true;
+  }
+  return false;
+}
+
+bool MemoryAdapter::GetTableObject(const GenericComponentId& id,
+                                   const reflection::Object** table_out) {
+  int type = GetComponentType(id);
+  if (type == kNoComponentType) return false;
+  if (table_out != nullptr) *table_out = component_types_[type].object;
+  return true;
+}
+
+bool MemoryAdapter::GetTableName(const GenericComponentId& id,
+                                 std::string* name_out) {
+  int type = GetComponentType(id);
+  if (type == kNoComponentType) return false;
+  if (name_out != nullptr) {
+    *name_out = component_types_[type].object->name()->str();
+  }
+  return true;
+}
+
+bool MemoryAdapter::SerializeEntities(const std::vector<GenericEntityId>& ids,
+                                      std::vector<uint8_t>* buffer_out) {
+  std::vector<const Entity*> entities;
+  entities.reserve(ids.size());
+  for (auto id = ids.begin(); id != ids.end(); ++id) {
+    const Entity* entity = GetEntity(*id);
+    if (entity != nullptr) entities.push_back(entity);
+  }
+  return SerializeEntityList(entities, buffer_out);
+}
+
+bool MemoryAdapter::SerializeEntityList(
+    const std::vector<const Entity*>& entities,
+    std::vector<uint8_t>* buffer_out) {
+  if (schema_ == nullptr) return false;
+  builder_.Clear();
+  std::vector<flatbuffers::Offset<flatbuffers::Table>> entity_tables;
+  std::vector<flatbuffers::Offset<flatbuffers::Table>> instances;
+  std::vector<std::pair<uint8_t, flatbuffers::uoffset_t>> components;
+  auto instance_fields =
+      static_cast<flatbuffers::voffset_t>(instance_object_->fields()->size());
+  for (auto e = entities.begin(); e != entities.end(); ++e) {
+    const Entity* entity = *e;
+
+    // Meta data and transform first, then every component that wasn't just
+    // copied from the prototype.
+    components.clear();
+    if (meta_type_ != kNoComponentType) {
+      components.push_back(std::make_pair(
+          component_types_[meta_type_].union_type,
+          WriteMeta(*entity, &builder_)));
+    }
+    if (transform_type_ != kNoComponentType && entity->has_transform) {
+      components.push_back(std::make_pair(
+          component_types_[transform_type_].union_type,
+          WriteTransform(*entity, &builder_)));
+    }
+    for (auto component = entity->components.begin();
+         component != entity->components.end(); ++component) {
+      int type = GetComponentType(component->id);
+      if (component->from_prototype || type == kNoComponentType) continue;
+      components.push_back(std::make_pair(
+          component_types_[type].union_type,
+          WriteComponent(*entity, type, &builder_)));
+    }
+
+    instances.clear();
+    for (auto component = components.begin(); component != components.end();
+         ++component) {
+      flatbuffers::uoffset_t start = builder_.StartTable();
+      builder_.AddElement<uint8_t>(data_type_field_->offset(),
+                                   component->first, 0);
+      builder_.AddOffset(
+          data_field_->offset(),
+          flatbuffers::Offset<flatbuffers::Table>(component->second));
+      instances.push_back(flatbuffers::Offset<flatbuffers::Table>(
+          builder_.EndTable(start, instance_fields)));
+    }
+    auto instance_vector = builder_.CreateVector(instances);
+    flatbuffers::uoffset_t start = builder_.StartTable();
+    builder_.AddOffset(component_list_field_->offset(), instance_vector);
+    entity_tables.push_back(
+        flatbuffers::Offset<flatbuffers::Table>(builder_.EndTable(
+            start, static_cast<flatbuffers::voffset_t>(
+                       entity_object_->fields()->size()))));
+  }
+
+  auto entity_vector = builder_.CreateVector(entity_tables);
+  flatbuffers::uoffset_t start = builder_.StartTable();
+  builder_.AddOffset(entity_list_field_->offset(), entity_vector);
+  flatbuffers::Offset<flatbuffers::Table> root(builder_.EndTable(
+      start, static_cast<flatbuffers::voffset_t>(
+                 schema_->root_table()->fields()->size())));
+  auto file_ident = schema_->file_ident();
+  builder_.Finish(root, file_ident != nullptr && file_ident->size() > 0
+                            ? file_ident->c_str()
+                            : nullptr);
+  if (buffer_out != nullptr) {
+    buffer_out->assign(builder_.GetBufferPointer(),
+                       builder_.GetBufferPointer() + builder_.GetSize());
+  }
+  return true;
+}
+
+void MemoryAdapter::OverrideFileCache(const std::string& filename,
+                                      const std::vector<uint8_t>& data) {
+  UpdateFileCache(filename, std::make_shared<const std::vector<uint8_t>>(data));
+}
+
+void MemoryAdapter::UpdateFileCache(const std::string& filename,
+                                    const SharedFileBuffer& data) {
+  if (data == nullptr || data->empty()) {
+    file_cache_.erase(filename);
+  } else {
+    file_cache_[filename] = data;
+  }
+}
+
+bool MemoryAdapter::GetEntityComponentList(
+    const GenericEntityId& id,
+    std::vector<GenericComponentId>* components_out) {
+  const Entity* entity = GetEntity(id);
+  if (entity == nullptr) return false;
+  if (components_out == nullptr) return true;
+  components_out->clear();
+  if (meta_type_ != kNoComponentType) {
+    components_out->push_back(component_types_[meta_type_].id);
+  }
+  if (transform_type_ != kNoComponentType && entity->has_transform) {
+    components_out->push_back(component_types_[transform_type_].id);
+  }
+  for (auto component = entity->components.begin();
+       component != entity->components.end(); ++component) {
+    components_out->push_back(component->id);
+  }
+  return true;
+}
+
+void MemoryAdapter::GetFullComponentList(
+    std::vector<GenericComponentId>* components_out) {
+  if (components_out == nullptr) return;
+  components_out->clear();
+  for (auto type = component_types_.begin(); type != component_types_.end();
+       ++type) {
+    components_out->push_back(type->id);
+  }
+}
+
+bool MemoryAdapter::IsEntityComponentFromPrototype(
+    const GenericEntityId& entity_id, const GenericComponentId& component) {
+  const Entity* entity = GetEntity(entity_id);
+  if (entity == nullptr) return false;
+  for (auto c = entity->components.begin(); c != entity->components.end();
+       ++c) {
+    if (c->id == component) return c->from_prototype;
+  }
+  return false;
+}
+
+bool MemoryAdapter::SerializeEntityComponent(
+    const GenericEntityId& entity_id, const GenericComponentId& component,
+    flatbuffers::unique_ptr_t* data_out) {
+  const Entity* entity = GetEntity(entity_id);
+  int type = GetComponentType(component);
+  if (entity == nullptr || type == kNoComponentType) return false;
+  flatbuffers::FlatBufferBuilder builder;
+  flatbuffers::uoffset_t table = WriteComponent(*entity, type, &builder);
+  if (table == 0) return false;
+  builder.Finish(flatbuffers::Offset<flatbuffers::Table>(table));
+  if (data_out != nullptr) *data_out = builder.ReleaseBufferPointer();
+  return true;
+}
+
+bool MemoryAdapter::DeserializeEntityComponent(
+    const GenericEntityId& entity_id, const GenericComponentId& component,
+    const uint8_t* data) {
+  Entity* entity = GetEntity(entity_id);
+  int type = GetComponentType(component);
+  if (data == nullptr || entity == nullptr || type == kNoComponentType) {
+    return false;
+  }
+  const flatbuffers::Table& table = *flatbuffers::GetAnyRoot(data);
+  if (type == meta_type_) {
+    Entity meta;
+    ReadMeta(table, &meta);
+    entity->prototype = meta.prototype;
+    if (!meta.id.empty() && meta.id != entity->id &&
+        GetEntity(meta.id) == nullptr) {
+      GenericEntityId old_id = entity->id;
+      RenameEntity(old_id, meta.id);
+    }
+    return true;
+  }
+  if (type == transform_type_) {
+    // Children are changed with SetEntityParent(), not by editing child_ids.
+    std::vector<std::string> child_ids;
+    ReadTransform(table, entity, &child_ids);
+    return true;
+  }
+  Component* stored = nullptr;
+  for (auto c = entity->components.begin(); c != entity->components.end();
+       ++c) {
+    if (c->id == component) stored = &*c;
+  }
+  if (stored == nullptr) {
+    entity->components.push_back(Component());
+    stored = &entity->components.back();
+    stored->id = component_types_[type].id;
+  }
+  CopyToBuffer(*schema_, *component_types_[type].object, table,
+               &stored->data);
+  stored->from_prototype = false;
+  return true;
+}
+
+MemoryAdapter::Entity* MemoryAdapter::GetEntity(const GenericEntityId& id) {
+  auto found = entities_.find(id);
+  return found != entities_.end() ? &found->second : nullptr;
+}
+
+const MemoryAdapter::Entity* MemoryAdapter::GetEntity(
+    const GenericEntityId& id) const {
+  auto found = entities_.find(id);
+  return found != entities_.end() ? &found->second : nullptr;
+}
+
+bool MemoryAdapter::GetGeneratedComponentTypes(
+    const SceneOptions& options, std::vector<int>* types_out) const {
+  if (schema_ == nullptr) return false;
+  types_out->clear();
+  if (options.components.empty()) {
+    // If there are templates, stick to the components they're for, so every
+    // generated component has real data.
+    bool have_templates = false;
+    for (auto t = component_templates_.begin();
+         t != component_templates_.end(); ++t) {
+      if (!t->empty()) have_templates = true;
+    }
+    for (size_t i = 0; i < component_types_.size(); i++) {
+      int type = static_cast<int>(i);
+      if (type != meta_type_ && type != transform_type_ &&
+          (!have_templates || !component_templates_[i].empty())) {
+        types_out->push_back(type);
+      }
+    }
+    return true;
+  }
+  for (auto name = options.components.begin();
+       name != options.components.end(); ++name) {
+    int type = GetComponentType(ComponentIdFromString(*name));
+    if (type == kNoComponentType) {
+      fplbase::LogError("MemoryAdapter: No component %s in the schema",
+                        name->c_str());
+      return false;
+    }
+    // Every entity has these anyway.
+    if (type != meta_type_ && type != transform_type_) {
+      types_out->push_back(type);
+    }
+  }
+  return true;
+}
+
+void MemoryAdapter::AddGeneratedComponents(const std::vector<int>& types,
+                                           size_t first, size_t count,
+                                           Entity* entity) const {
+  if (types.empty()) return;
+  static const std::vector<uint8_t> empty_table = CreateEmptyTable();
+  count = std::min(count, types.size());
+  for (size_t c = 0; c < count; c++) {
+    int type = types[(first + c) % types.size()];
+    Component component;
+    component.id = component_types_[type].id;
+    if (static_cast<size_t>(type) < component_templates_.size() &&
+        !component_templates_[type].empty()) {
+      const std::vector<std::vector<uint8_t>>& templates =
+          component_templates_[type];
+      component.data = templates[first % templates.size()];
+    } else {
+      component.data = empty_table;
+    }
+    entity->components.push_back(std::move(component));
+  }
+}
+
+int MemoryAdapter::GetComponentType(const GenericComponentId& id) const {
+  for (size_t i = 0; i < component_types_.size(); i++) {
+    if (component_types_[i].id == id) return static_cast<int>(i);
+  }
+  return kNoComponentType;
+}
+
+GenericEntityId MemoryAdapter::NewEntityId() {
+  for (;;) {
+    GenericEntityId id = EntityIdFromString(
+        kNewEntityIdPrefix + flatbuffers::NumToString(next_entity_number_++));
+    if (GetEntity(id) == nullptr) return id;
+  }
+}
+
+MemoryAdapter::Entity* MemoryAdapter::AddEntity(Entity* entity) {
+  if (entity->id.empty() || GetEntity(entity->id) != nullptr) {
+    entity->id = NewEntityId();
+  }
+  GenericEntityId id = entity->id;
+  Entity& added = entities_[id];
+  added = std::move(*entity);
+  entity_ids_.push_back(id);
+  InvalidateEntityIDs();
+  return &added;
+}
+
+void MemoryAdapter::RenameEntity(const GenericEntityId& old_id,
+                                 const GenericEntityId& new_id) {
+  auto found = entities_.find(old_id);
+  if (found == entities_.end()) return;
+  Entity entity = std::move(found->second);
+  entities_.erase(found);
+  entity.id = new_id;
+  Entity* parent = GetEntity(entity.parent);
+  if (parent != nullptr) {
+    std::replace(parent->children.begin(), parent->children.end(), old_id,
+                 new_id);
+  }
+  for (auto child_id = entity.children.begin();
+       child_id != entity.children.end(); ++child_id) {
+    Entity* child = GetEntity(*child_id);
+    if (child != nullptr) child->parent = new_id;
+  }
+  entities_[new_id] = std::move(entity);
+  std::replace(entity_ids_.begin(), entity_ids_.end(), old_id, new_id);
+  InvalidateEntityIDs();
+}
+
+void MemoryAdapter::DetachFromParent(Entity* child) {
+  Entity* parent = GetEntity(child->parent);
+  if (parent != nullptr) {
+    std::vector<GenericEntityId>& siblings = parent->children;
+    siblings.erase(std::remove(siblings.begin(), siblings.end(), child->id),
+                   siblings.end());
+  }
+  child->parent = kNoEntityId;
+}
+
+bool MemoryAdapter::ReadEntityList(
+    const uint8_t* entity_list, size_t size, std::vector<Entity>* out,
+    std::vector<std::vector<std::string>>* child_ids_out) {
+  if (schema_ == nullptr || entity_list == nullptr) return false;
+  // Entity files can come from anywhere, e.g. the benchmark's command line, so
+  // check every offset is in bounds before following any of them.
+  if (!flatbuffers::Verify(*schema_, *schema_->root_table(), entity_list,
+                           size)) {
+    fplbase::LogError("MemoryAdapter: Entity list is invalid.");
+    return false;
+  }
+  const flatbuffers::Table* root = flatbuffers::GetAnyRoot(entity_list);
+  const TableVector* entities =
+      root->GetPointer<const TableVector*>(entity_list_field_->offset());
+  if (entities == nullptr) return true;
+  out->reserve(out->size() + entities->size());
+  for (flatbuffers::uoffset_t i = 0; i < entities->size(); i++) {
+    out->push_back(Entity());
+    child_ids_out->push_back(std::vector<std::string>());
+    Entity& entity = out->back();
+    const TableVector* instances = entities->Get(i)->GetPointer<
+        const TableVector*>(component_list_field_->offset());
+    if (instances == nullptr) continue;
+    for (flatbuffers::uoffset_t j = 0; j < instances->size(); j++) {
+      const flatbuffers::Table* instance = instances->Get(j);
+      uint8_t union_type =
+          instance->GetField<uint8_t>(data_type_field_->offset(), 0);
+      const flatbuffers::Table* data =
+          instance->GetPointer<const flatbuffers::Table*>(
+              data_field_->offset());
+      if (data == nullptr) continue;
+      int type = kNoComponentType;
+      for (size_t t = 0; t < component_types_.size(); t++) {
+        if (component_types_[t].union_type == union_type) {
+          type = static_cast<int>(t);
+        }
+      }
+      if (type == kNoComponentType) continue;
+      if (type == meta_type_) {
+        ReadMeta(*data, &entity);
+      } else if (type == transform_type_) {
+        ReadTransform(*data, &entity, &child_ids_out->back());
+      } else {
+        entity.components.push_back(Component());
+        Component& component = entity.components.back();
+        component.id = component_types_[type].id;
+        CopyToBuffer(*schema_, *component_types_[type].object, *data,
+                     &component.data);
+      }
+    }
+  }
+  return true;
+}
+
+void MemoryAdapter::ApplyPrototype(Entity* entity) const {
+  if (entity->prototype.empty()) return;
+  auto found = prototypes_.find(entity->prototype);
+  if (found == prototypes_.end()) return;
+  const Entity& prototype = found->second;
+  if (!entity->has_transform && prototype.has_transform) {
+    entity->has_transform = true;
+    entity->transform = prototype.transform;
+  }
+  for (auto component = prototype.components.begin();
+       component != prototype.components.end(); ++component) {
+    bool has_component = false;
+    for (auto c = entity->components.begin(); c != entity->components.end();
+         ++c) {
+      if (c->id == component->id) has_component = true;
+    }
+    if (has_component) continue;
+    entity->components.push_back(*component);
+    entity->components.back().from_prototype = true;
+  }
+}
+
+void MemoryAdapter::ReadMeta(const flatbuffers::Table& table,
+                             Entity* entity) const {
+  auto fields = component_types_[meta_type_].object->fields();
+  const reflection::Field* entity_id = fields->LookupByKey("entity_id");
+  const reflection::Field* prototype = fields->LookupByKey("prototype");
+  if (entity_id != nullptr &&
+      entity_id->type()->base_type() == reflection::String) {
+    auto str = table.GetPointer<const flatbuffers::String*>(
+        entity_id->offset());
+    if (str != nullptr) entity->id = EntityIdFromString(str->str());
+  }
+  if (prototype != nullptr &&
+      prototype->type()->base_type() == reflection::String) {
+    auto str = table.GetPointer<const flatbuffers::String*>(
+        prototype->offset());
+    entity->prototype =
+        str != nullptr ? EntityIdFromString(str->str()) : kNoEntityId;
+  }
+}
+
+void MemoryAdapter::ReadTransform(const flatbuffers::Table& table,
+                                  Entity* entity,
+                                  std::vector<std::string>* child_ids) const {
+  auto fields = component_types_[transform_type_].object->fields();
+  GenericTransform& transform = entity->transform;
+  entity->has_transform = true;
+  float values[4];
+  if (ReadFloats(*schema_, table, fields->LookupByKey("position"), 3,
+                 values)) {
+    transform.position = mathfu::vec3(values[0], values[1], values[2]);
+  }
+  if (ReadFloats(*schema_, table, fields->LookupByKey("scale"), 3, values)) {
+    transform.scale = mathfu::vec3(values[0], values[1], values[2]);
+  }
+  const reflection::Field* orientation = fields->LookupByKey("orientation");
+  if (ReadFloats(*schema_, table, orientation, 3, values)) {
+    transform.orientation = mathfu::quat::FromEulerAngles(
+        mathfu::vec3(values[0], values[1], values[2]) * kDegreesToRadians);
+  } else if (ReadFloats(*schema_, table, orientation, 4, values)) {
+    transform.orientation =
+        mathfu::quat(values[3], values[0], values[1], values[2]);
+  }
+  const reflection::Field* children = fields->LookupByKey("child_ids");
+  if (children != nullptr &&
+      children->type()->base_type() == reflection::Vector &&
+      children->type()->element() == reflection::String) {
+    auto ids = table.GetPointer<const StringVector*>(children->offset());
+    for (flatbuffers::uoffset_t i = 0; ids != nullptr && i < ids->size();
+         i++) {
+      child_ids->push_back(ids->Get(i)->str());
+    }
+  }
+}
+
+flatbuffers::uoffset_t MemoryAdapter::WriteMeta(
+    const Entity& entity, flatbuffers::FlatBufferBuilder* builder) {
+  const reflection::Object& object = *component_types_[meta_type_].object;
+  const reflection::Field* id_field =
+      object.fields()->LookupByKey("entity_id");
+  const reflection::Field* prototype_field =
+      object.fields()->LookupByKey("prototype");
+  flatbuffers::Offset<flatbuffers::String> id;
+  flatbuffers::Offset<flatbuffers::String> prototype;
+  if (id_field != nullptr &&
+      id_field->type()->base_type() == reflection::String) {
+    id = builder->CreateString(EntityIdString(entity.id));
+  }
+  if (prototype_field != nullptr &&
+      prototype_field->type()->base_type() == reflection::String &&
+      !entity.prototype.empty()) {
+    prototype = builder->CreateString(EntityIdString(entity.prototype));
+  }
+  flatbuffers::uoffset_t start = builder->StartTable();
+  if (id.o != 0) builder->AddOffset(id_field->offset(), id);
+  if (prototype.o != 0) {
+    builder->AddOffset(prototype_field->offset(), prototype);
+  }
+  return builder->EndTable(
+      start, static_cast<flatbuffers::voffset_t>(object.fields()->size()));
+}
+
+flatbuffers::uoffset_t MemoryAdapter::WriteTransform(
+    const Entity& entity, flatbuffers::FlatBufferBuilder* builder) {
+  const reflection::Object& object =
+      *component_types_[transform_type_].object;
+  const GenericTransform& transform = entity.transform;
+  const reflection::Field* children = object.fields()->LookupByKey("child_ids");
+  flatbuffers::Offset<StringVector> child_ids;
+  if (children != nullptr &&
+      children->type()->base_type() == reflection::Vector &&
+      children->type()->element() == reflection::String &&
+      !entity.children.empty()) {
+    std::vector<flatbuffers::Offset<flatbuffers::String>> ids;
+    for (auto child = entity.children.begin(); child != entity.children.end();
+         ++child) {
+      ids.push_back(builder->CreateString(EntityIdString(*child)));
+    }
+    child_ids = builder->CreateVector(ids);
+  }
+
+  flatbuffers::uoffset_t start = builder->StartTable();
+  const float position[3] = {transform.position[0], transform.position[1],
+                             transform.position[2]};
+  const float scale[3] = {transform.scale[0], transform.scale[1],
+                          transform.scale[2]};
+  AddFloats(*schema_, object.fields()->LookupByKey("position"), position,
+            builder);
+  AddFloats(*schema_, object.fields()->LookupByKey("scale"), scale, builder);
+  const reflection::Field* orientation =
+      object.fields()->LookupByKey("orientation");
+  if (FloatStructSize(*schema_, orientation) == 4) {
+    mathfu::vec3 axis = transform.orientation.vector();
+    const float quaternion[4] = {axis[0], axis[1], axis[2],
+                                 transform.orientation.scalar()};
+    AddFloats(*schema_, orientation, quaternion, builder);
+  } else {
+    mathfu::vec3 angles =
+        transform.orientation.ToEulerAngles() * kRadiansToDegrees;
+    const float euler[3] = {angles[0], angles[1], angles[2]};
+    AddFloats(*schema_, orientation, euler, builder);
+  }
+  if (child_ids.o != 0) builder->AddOffset(children->offset(), child_ids);
+  return builder->EndTable(
+      start, static_cast<flatbuffers::voffset_t>(object.fields()->size()));
+}
+
+flatbuffers::uoffset_t MemoryAdapter::WriteComponent(
+    const Entity& entity, int component_type,
+    flatbuffers::FlatBufferBuilder* builder) {
+  if (component_type == meta_type_) return WriteMeta(entity, builder);
+  if (component_type == transform_type_) {
+    return entity.has_transform ? WriteTransform(entity, builder) : 0;
+  }
+  const ComponentType& type = component_types_[component_type];
+  for (auto component = entity.components.begin();
+       component != entity.components.end(); ++component) {
+    if (component->id != type.id) continue;
+    return flatbuffers::CopyTable(
+               *builder, *schema_, *type.object,
+               *flatbuffers::GetAnyRoot(component->data.data())).o;
+  }
+  return 0;
+}
+
+}  // namespace scene_lab_memory
@@ -0,0 +1,262 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "scene_lab/profiler.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "flatbuffers/util.h"
+#include "fplbase/utilities.h"
+
+namespace scene_lab {
+
+std::atomic<bool> Profiler::enabled_(false);
+
+// One recorded zone. The fields are atomic so that GetChromeTrace() can read
+// them while their thread is writing new zones, without any locking; it
+// throws away any zones that might have been overwritten as it read them.
+struct RecordedZone {
+  std::atomic<const char*> name;
+  std::atomic<const char*> category;
+  std::atomic<int64_t> start_ns;
+  std::atomic<int64_t> end_ns;
+};
+
+// A copy of a RecordedZone, taken for writing a trace.
+struct RecordedZoneCopy {
+  const char* name;
+  const char* category;
+  int64_t start_ns;
+  int64_t end_ns;
+};
+
+// The zones recorded by one thread. Only that thread writes zones, so
+// recording one never waits on anything.
+struct ProfilerThreadBuffer {
+  explicit ProfilerThreadBuffer(int thread_id)
+      : written(0), cleared(0), id(thread_id), in_use(true) {}
+
+  RecordedZone zones[Profiler::kZonesPerThread];
+  // How many zones have ever been recorded. Zone i is in zones[i % size].
+  std::atomic<uint64_t> written;
+  // Zones before this one were removed by Profiler::Clear().
+  std::atomic<uint64_t> cleared;
+  // These are protected by ProfilerRegistry::mutex.
+  int id;
+  std::string name;
+  // Does a running thread own this buffer?
+  bool in_use;
+};
+
+// Every thread's buffer. Buffers are kept after their threads exit, so that
+// their zones can still be written out, until a new thread reuses them.
+struct ProfilerRegistry {
+  ProfilerRegistry() : next_id(1) {}
+
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ProfilerThreadBuffer>> buffers;
+  int next_id;
+};
+
+static ProfilerRegistry& GetRegistry() {
+  static ProfilerRegistry registry;
+  return registry;
+}
+
+// The calling thread's buffer, which is handed back when the thread exits.
+struct ProfilerThreadBufferOwner {
+  ProfilerThreadBufferOwner() : buffer(nullptr), registered(false) {}
+  ~ProfilerThreadBufferOwner() {
+    if (buffer == nullptr) return;
+    std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+    buffer->in_use = false;
+  }
+
+  ProfilerThreadBuffer* buffer;
+  // Has this thread asked for a buffer yet? If there wasn't one to spare,
+  // it doesn't ask again.
+  bool registered;
+};
+
+static thread_local ProfilerThreadBufferOwner g_thread_buffer;
+
+// Get the calling thread's buffer, finding one the first time. Returns null
+// if kMaxThreads threads with buffers are all still running.
+static ProfilerThreadBuffer* GetThreadBuffer() {
+  if (g_thread_buffer.registered) return g_thread_buffer.buffer;
+  g_thread_buffer.registered = true;
+  ProfilerRegistry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  ProfilerThreadBuffer* buffer = nullptr;
+  if (registry.buffers.size() < Profiler::kMaxThreads) {
+    registry.buffers.push_back(std::unique_ptr<ProfilerThreadBuffer>(
+        new ProfilerThreadBuffer(registry.next_id++)));
+    buffer = registry.buffers.back().get();
+  } else {
+    // Take over the buffer of the thread that exited first (which has the
+    // lowest ID), dropping its zones.
+    for (auto b = registry.buffers.begin(); b != registry.buffers.end(); ++b) {
+      if (!(*b)->in_use && (buffer == nullptr || (*b)->id < buffer->id)) {
+        buffer = b->get();
+      }
+    }
+    if (buffer == nullptr) return nullptr;
+    buffer->cleared.store(buffer->written.load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+    buffer->id = registry.next_id++;
+    buffer->in_use = true;
+  }
+  buffer->name = "Thread " + flatbuffers::NumToString(buffer->id);
+  g_thread_buffer.buffer = buffer;
+  return buffer;
+}
+
+// Copy the zones still held in `buffer`, oldest first.
+static void CopyZones(const ProfilerThreadBuffer& buffer,
+                      std::vector<RecordedZoneCopy>* zones_out) {
+  const uint64_t size = Profiler::kZonesPerThread;
+  uint64_t end = buffer.written.load(std::memory_order_acquire);
+  uint64_t begin = std::max(buffer.cleared.load(std::memory_order_relaxed),
+                            end > size ? end - size : 0);
+  std::vector<RecordedZoneCopy> zones;
+  zones.reserve(static_cast<size_t>(end - begin));
+  for (uint64_t i = begin; i < end; i++) {
+    const RecordedZone& zone = buffer.zones[i % size];
+    RecordedZoneCopy copy;
+    copy.name = zone.name.load(std::memory_order_relaxed);
+    copy.category = zone.category.load(std::memory_order_relaxed);
+    copy.start_ns = zone.start_ns.load(std::memory_order_relaxed);
+    copy.end_ns = zone.end_ns.load(std::memory_order_relaxed);
+    zones.push_back(copy);
+  }
+  // The thread may have wrapped around and overwritten some of the zones we
+  // just read, up to and including the one it's recording now. Drop them.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t end_after = buffer.written.load(std::memory_order_relaxed);
+  uint64_t first_intact = end_after + 1 > size ? end_after + 1 - size : 0;
+  size_t overwritten =
+      first_intact > begin
+          ? static_cast<size_t>(std::min(first_intact - begin, end - begin))
+          : 0;
+  zones_out->insert(zones_out->end(), zones.begin() + overwritten,
+                    zones.end());
+}
+
+// Append `str` to `json` as a JSON string, with quotes.
+static void AppendJsonString(const char* str, std::string* json) {
+  json->push_back('"');
+  for (const char* c = str; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      json->push_back('\\');
+      json->push_back(*c);
+    } else if (static_cast<unsigned char>(*c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x",
+               static_cast<unsigned>(*c));
+      json->append(escaped);
+    } else {
+      json->push_back(*c);
+    }
+  }
+  json->push_back('"');
+}
+
+// Format a time in nanoseconds as microseconds, as Chrome traces use.
+static void AppendMicroseconds(int64_t ns, std::string* json) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.3f", static_cast<double>(ns) / 1000.0);
+  json->append(text);
+}
+
+void Profiler::SetEnabled(bool enabled) {
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::Clear() {
+  ProfilerRegistry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto b = registry.buffers.begin(); b != registry.buffers.end(); ++b) {
+    ProfilerThreadBuffer& buffer = **b;
+    buffer.cleared.store(buffer.written.load(std::memory_order_acquire),
+                         std::memory_order_relaxed);
+  }
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+  ProfilerThreadBuffer* buffer = GetThreadBuffer();
+  if (buffer == nullptr) return;
+  std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+  buffer->name = name;
+}
+
+void Profiler::RecordZone(const char* name, const char* category,
+                          int64_t start_ns, int64_t end_ns) {
+  ProfilerThreadBuffer* buffer = GetThreadBuffer();
+  if (buffer == nullptr) return;
+  uint64_t index = buffer->written.load(std::memory_order_relaxed);
+  RecordedZone& zone = buffer->zones[index % kZonesPerThread];
+  zone.name.store(name, std::memory_order_relaxed);
+  zone.category.store(category, std::memory_order_relaxed);
+  zone.start_ns.store(start_ns, std::memory_order_relaxed);
+  zone.end_ns.store(end_ns, std::memory_order_relaxed);
+  buffer->written.store(index + 1, std::memory_order_release);
+}
+
+std::string Profiler::GetChromeTrace() {
+  std::string json = "{\"traceEvents\":[";
+  bool first_event = true;
+  std::vector<RecordedZoneCopy> zones;
+  ProfilerRegistry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto b = registry.buffers.begin(); b != registry.buffers.end(); ++b) {
+    const ProfilerThreadBuffer& buffer = **b;
+    std::string tid = flatbuffers::NumToString(buffer.id);
+    if (!first_event) json += ",";
+    first_event = false;
+    json += "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" +
+            tid + ",\"args\":{\"name\":";
+    AppendJsonString(buffer.name.c_str(), &json);
+    json += "}}";
+
+    zones.clear();
+    CopyZones(buffer, &zones);
+    for (auto zone = zones.begin(); zone != zones.end(); ++zone) {
+      json += ",\n{\"name\":";
+      AppendJsonString(zone->name, &json);
+      json += ",\"cat\":";
+      AppendJsonString(zone->category, &json);
+      json += ",\"ph\":\"X\",\"ts\":";
+      AppendMicroseconds(zone->start_ns, &json);
+      json += ",\"dur\":";
+      AppendMicroseconds(zone->end_ns - zone->start_ns, &json);
+      json += ",\"pid\":1,\"tid\":" + tid + "}";
+    }
+  }
+  json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return json;
+}
+
+bool Profiler::WriteChromeTrace(const std::string& filename) {
+  if (!fplbase::SaveFile(filename.c_str(), GetChromeTrace())) {
+    fplbase::LogError("Couldn't save profile to %s", filename.c_str());
+    return false;
+  }
+  fplbase::LogInfo("Saved profile to %s", filename.c_str());
+  return true;
+}
+
+}  // namespace scene_lab
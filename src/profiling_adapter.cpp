@@ -0,0 +1,531 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "scene_lab/profiling_adapter.h"
+
+#include <algorithm>
+#include "flatbuffers/util.h"
+#include "fplbase/utilities.h"
+
+namespace scene_lab {
+
+// In the same order as ProfilingEntitySystemAdapter::Call.
+static const char* const kCallNames[] = {
+    "AdvanceFrame",
+    "Render",
+    "OnActivate",
+    "OnDeactivate",
+    "OnEntityUpdated",
+    "OnEntityCreated",
+    "OnEntityDeleted",
+    "EntityExists",
+    "GetEntityTransform",
+    "SetEntityTransform",
+    "GetEntityTransforms",
+    "SetEntityTransforms",
+    "BeginTransformEdit",
+    "EndTransformEdit",
+    "GetEntityChildren",
+    "GetEntityParent",
+    "SetEntityParent",
+    "GetCamera",
+    "SetCamera",
+    "GetViewportSettings",
+    "DuplicateEntity",
+    "DuplicateEntities",
+    "CreateEntity",
+    "CreateEntityFromPrototype",
+    "DeleteEntity",
+    "SetEntityHighlighted",
+    "DebugDrawPhysics",
+    "GetRayIntersection",
+    "CycleEntities",
+    "GetAllEntityIDs",
+    "RefreshEntityIDs",
+    "RefreshEntityIDList",
+    "GetEntityIDsGeneration",
+    "GetAllPrototypeIDs",
+    "RefreshPrototypeIDs",
+    "GetEntityName",
+    "GetEntityDescription",
+    "FilterShowEntityID",
+    "GetEntitySourceFile",
+    "GetSchema",
+    "GetTextSchema",
+    "GetTableObject",
+    "GetTableName",
+    "SerializeEntities",
+    "OverrideFileCache",
+    "UpdateFileCache",
+    "GetEntityComponentList",
+    "GetFullComponentList",
+    "GetEntitiesWithComponents",
+    "IsEntityComponentFromPrototype",
+    "SerializeEntityComponent",
+    "DeserializeEntityComponent",
+    "ClearEntityIds",
+};
+static_assert(sizeof(kCallNames) / sizeof(kCallNames[0]) ==
+                  ProfilingEntitySystemAdapter::kCallCount,
+              "kCallNames must have a name for every Call.");
+
+static const double kMicrosecondsPerSecond = 1000000.0;
+
+ProfilingEntitySystemAdapter::CallStats::CallStats()
+    : count(0), total_seconds(0), min_seconds(0), max_seconds(0) {
+  std::fill(frame_histogram, frame_histogram + kHistogramBuckets, 0);
+}
+
+ProfilingEntitySystemAdapter::ProfilingEntitySystemAdapter(
+    std::unique_ptr<EntitySystemAdapter> wrapped)
+    : wrapped_(std::move(wrapped)) {
+  ResetStats();
+}
+
+const char* ProfilingEntitySystemAdapter::CallName(Call call) {
+  int index = static_cast<int>(call);
+  return index >= 0 && index < kCallCount ? kCallNames[index] : "";
+}
+
+double ProfilingEntitySystemAdapter::HistogramBucketLimit(int bucket) {
+  // Bucket 0 is under 1us, bucket 1 under 2us, bucket 2 under 4us, etc.
+  return static_cast<double>(1 << bucket) / kMicrosecondsPerSecond;
+}
+
+void ProfilingEntitySystemAdapter::ResetStats() {
+  for (int i = 0; i < kCallCount; i++) {
+    stats_[i] = CallStats();
+    frame_seconds_[i] = 0;
+    frame_called_[i] = false;
+  }
+  frame_count_ = 0;
+  in_frame_ = false;
+}
+
+void ProfilingEntitySystemAdapter::RecordCall(Call call, double seconds) {
+  CallStats& stats = stats_[call];
+  if (stats.count == 0 || seconds < stats.min_seconds) {
+    stats.min_seconds = seconds;
+  }
+  if (seconds > stats.max_seconds) stats.max_seconds = seconds;
+  stats.count++;
+  stats.total_seconds += seconds;
+  frame_seconds_[call] += seconds;
+  frame_called_[call] = true;
+}
+
+void ProfilingEntitySystemAdapter::EndFrame() {
+  // Calls made before the first frame started don't make up a whole frame,
+  // so leave them out of the histograms.
+  if (in_frame_) {
+    for (int i = 0; i < kCallCount; i++) {
+      if (!frame_called_[i]) continue;
+      int bucket = 0;
+      while (bucket < kHistogramBuckets - 1 &&
+             frame_seconds_[i] >= HistogramBucketLimit(bucket)) {
+        bucket++;
+      }
+      stats_[i].frame_histogram[bucket]++;
+    }
+    frame_count_++;
+  }
+  std::fill(frame_seconds_, frame_seconds_ + kCallCount, 0);
+  std::fill(frame_called_, frame_called_ + kCallCount, false);
+  in_frame_ = true;
+}
+
+// Get the calls that have been made, slowest total first.
+static std::vector<ProfilingEntitySystemAdapter::Call> CallsMade(
+    const ProfilingEntitySystemAdapter& profiler) {
+  typedef ProfilingEntitySystemAdapter::Call Call;
+  std::vector<Call> calls;
+  for (int i = 0; i < ProfilingEntitySystemAdapter::kCallCount; i++) {
+    Call call = static_cast<Call>(i);
+    if (profiler.stats(call).count > 0) calls.push_back(call);
+  }
+  std::stable_sort(calls.begin(), calls.end(),
+                   [&profiler](Call a, Call b) {
+                     return profiler.stats(a).total_seconds >
+                            profiler.stats(b).total_seconds;
+                   });
+  return calls;
+}
+
+void ProfilingEntitySystemAdapter::LogStats() const {
+  fplbase::LogInfo("Entity system adapter calls over %llu frames:",
+                   static_cast<unsigned long long>(frame_count_));
+  std::vector<Call> calls = CallsMade(*this);
+  for (auto call = calls.begin(); call != calls.end(); ++call) {
+    const CallStats& stats = stats_[*call];
+    fplbase::LogInfo(
+        "  %s: %llu calls, %.3f ms total, %.3f/%.3f/%.3f us min/mean/max",
+        CallName(*call), static_cast<unsigned long long>(stats.count),
+        stats.total_seconds * 1000.0,
+        stats.min_seconds * kMicrosecondsPerSecond,
+        stats.total_seconds * kMicrosecondsPerSecond / stats.count,
+        stats.max_seconds * kMicrosecondsPerSecond);
+  }
+}
+
+bool ProfilingEntitySystemAdapter::WriteStatsFile(
+    const std::string& filename) const {
+  std::string csv = "call,count,total_us,min_us,mean_us,max_us";
+  for (int i = 0; i < kHistogramBuckets; i++) {
+    // The last bucket holds everything over the previous bucket's limit.
+    bool last = i == kHistogramBuckets - 1;
+    csv += (last ? ",frames_over_" : ",frames_under_") +
+           flatbuffers::NumToString(HistogramBucketLimit(last ? i - 1 : i) *
+                                    kMicrosecondsPerSecond) +
+           "us";
+  }
+  csv += "\n";
+  std::vector<Call> calls = CallsMade(*this);
+  for (auto call = calls.begin(); call != calls.end(); ++call) {
+    const CallStats& stats = stats_[*call];
+    csv += std::string(CallName(*call)) + "," +
+           flatbuffers::NumToString(stats.count) + "," +
+           flatbuffers::NumToString(stats.total_seconds *
+                                    kMicrosecondsPerSecond) +
+           "," +
+           flatbuffers::NumToString(stats.min_seconds *
+                                    kMicrosecondsPerSecond) +
+           "," +
+           flatbuffers::NumToString(stats.total_seconds *
+                                    kMicrosecondsPerSecond / stats.count) +
+           "," +
+           flatbuffers::NumToString(stats.max_seconds *
+                                    kMicrosecondsPerSecond);
+    for (int i = 0; i < kHistogramBuckets; i++) {
+      csv += "," + flatbuffers::NumToString(stats.frame_histogram[i]);
+    }
+    csv += "\n";
+  }
+  if (!fplbase::SaveFile(filename.c_str(), csv)) {
+    fplbase::LogError("Couldn't write adapter profile to '%s'.",
+                      filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+void ProfilingEntitySystemAdapter::AdvanceFrame(double delta_seconds) {
+  EndFrame();
+  ScopedCall timer(this, kAdvanceFrame);
+  wrapped_->AdvanceFrame(delta_seconds);
+}
+
+void ProfilingEntitySystemAdapter::Render() {
+  ScopedCall timer(this, kRender);
+  wrapped_->Render();
+}
+
+void ProfilingEntitySystemAdapter::OnActivate() {
+  ScopedCall timer(this, kOnActivate);
+  wrapped_->OnActivate();
+}
+
+void ProfilingEntitySystemAdapter::OnDeactivate() {
+  ScopedCall timer(this, kOnDeactivate);
+  wrapped_->OnDeactivate();
+}
+
+void ProfilingEntitySystemAdapter::OnEntityUpdated(const GenericEntityId& id) {
+  ScopedCall timer(this, kOnEntityUpdated);
+  wrapped_->OnEntityUpdated(id);
+}
+
+void ProfilingEntitySystemAdapter::OnEntityCreated(const GenericEntityId& id) {
+  ScopedCall timer(this, kOnEntityCreated);
+  wrapped_->OnEntityCreated(id);
+}
+
+void ProfilingEntitySystemAdapter::OnEntityDeleted(const GenericEntityId& id) {
+  ScopedCall timer(this, kOnEntityDeleted);
+  wrapped_->OnEntityDeleted(id);
+}
+
+bool ProfilingEntitySystemAdapter::EntityExists(const GenericEntityId& id) {
+  ScopedCall timer(this, kEntityExists);
+  return wrapped_->EntityExists(id);
+}
+
+bool ProfilingEntitySystemAdapter::GetEntityTransform(
+    const GenericEntityId& id, GenericTransform* transform_output) {
+  ScopedCall timer(this, kGetEntityTransform);
+  return wrapped_->GetEntityTransform(id, transform_output);
+}
+
+bool ProfilingEntitySystemAdapter::SetEntityTransform(
+    const GenericEntityId& id, const GenericTransform& transform) {
+  ScopedCall timer(this, kSetEntityTransform);
+  return wrapped_->SetEntityTransform(id, transform);
+}
+
+bool ProfilingEntitySystemAdapter::GetEntityTransforms(
+    const GenericEntityId* ids, size_t count,
+    GenericTransformArrays* transforms_output) {
+  ScopedCall timer(this, kGetEntityTransforms);
+  return wrapped_->GetEntityTransforms(ids, count, transforms_output);
+}
+
+bool ProfilingEntitySystemAdapter::SetEntityTransforms(
+    const GenericEntityId* ids, size_t count,
+    const GenericTransformArrays& transforms) {
+  ScopedCall timer(this, kSetEntityTransforms);
+  return wrapped_->SetEntityTransforms(ids, count, transforms);
+}
+
+void ProfilingEntitySystemAdapter::BeginTransformEdit(
+    const GenericEntityId& id) {
+  ScopedCall timer(this, kBeginTransformEdit);
+  wrapped_->BeginTransformEdit(id);
+}
+
+void ProfilingEntitySystemAdapter::EndTransformEdit(const GenericEntityId& id) {
+  ScopedCall timer(this, kEndTransformEdit);
+  wrapped_->EndTransformEdit(id);
+}
+
+bool ProfilingEntitySystemAdapter::GetEntityChildren(
+    const GenericEntityId& id, std::vector<GenericEntityId>* children_out) {
+  ScopedCall timer(this, kGetEntityChildren);
+  return wrapped_->GetEntityChildren(id, children_out);
+}
+
+bool ProfilingEntitySystemAdapter::GetEntityParent(
+    const GenericEntityId& id, GenericEntityId* parent_out) {
+  ScopedCall timer(this, kGetEntityParent);
+  return wrapped_->GetEntityParent(id, parent_out);
+}
+
+bool ProfilingEntitySystemAdapter::SetEntityParent(
+    const GenericEntityId& child, const GenericEntityId& parent) {
+  ScopedCall timer(this, kSetEntityParent);
+  return wrapped_->SetEntityParent(child, parent);
+}
+
+bool ProfilingEntitySystemAdapter::GetCamera(GenericCamera* camera) {
+  ScopedCall timer(this, kGetCamera);
+  return wrapped_->GetCamera(camera);
+}
+
+bool ProfilingEntitySystemAdapter::SetCamera(const GenericCamera& camera) {
+  ScopedCall timer(this, kSetCamera);
+  return wrapped_->SetCamera(camera);
+}
+
+bool ProfilingEntitySystemAdapter::GetViewportSettings(
+    ViewportSettings* viewport) {
+  ScopedCall timer(this, kGetViewportSettings);
+  return wrapped_->GetViewportSettings(viewport);
+}
+
+bool ProfilingEntitySystemAdapter::DuplicateEntity(
+    const GenericEntityId& id, GenericEntityId* new_id_output) {
+  ScopedCall timer(this, kDuplicateEntity);
+  return wrapped_->DuplicateEntity(id, new_id_output);
+}
+
+bool ProfilingEntitySystemAdapter::DuplicateEntities(
+    const GenericEntityId& id, const GenericTransformArrays& offsets,
+    std::vector<GenericEntityId>* new_ids_output) {
+  ScopedCall timer(this, kDuplicateEntities);
+  return wrapped_->DuplicateEntities(id, offsets, new_ids_output);
+}
+
+bool ProfilingEntitySystemAdapter::CreateEntity(
+    GenericEntityId* new_id_output) {
+  ScopedCall timer(this, kCreateEntity);
+  return wrapped_->CreateEntity(new_id_output);
+}
+
+bool ProfilingEntitySystemAdapter::CreateEntityFromPrototype(
+    const GenericPrototypeId& prototype, GenericEntityId* new_id_output) {
+  ScopedCall timer(this, kCreateEntityFromPrototype);
+  return wrapped_->CreateEntityFromPrototype(prototype, new_id_output);
+}
+
+bool ProfilingEntitySystemAdapter::DeleteEntity(const GenericEntityId& id) {
+  ScopedCall timer(this, kDeleteEntity);
+  return wrapped_->DeleteEntity(id);
+}
+
+bool ProfilingEntitySystemAdapter::SetEntityHighlighted(
+    const GenericEntityId& id, bool is_highlighted) {
+  ScopedCall timer(this, kSetEntityHighlighted);
+  return wrapped_->SetEntityHighlighted(id, is_highlighted);
+}
+
+bool ProfilingEntitySystemAdapter::DebugDrawPhysics(const GenericEntityId& id) {
+  ScopedCall timer(this, kDebugDrawPhysics);
+  return wrapped_->DebugDrawPhysics(id);
+}
+
+bool ProfilingEntitySystemAdapter::GetRayIntersection(
+    const mathfu::vec3& start_point, const mathfu::vec3& direction_normalized,
+    GenericEntityId* entity_output, mathfu::vec3* intersection_point_output) {
+  ScopedCall timer(this, kGetRayIntersection);
+  return wrapped_->GetRayIntersection(start_point, direction_normalized,
+                                      entity_output, intersection_point_output);
+}
+
+bool ProfilingEntitySystemAdapter::CycleEntities(int direction,
+                                                 GenericEntityId* next_entity) {
+  ScopedCall timer(this, kCycleEntities);
+  return wrapped_->CycleEntities(direction, next_entity);
+}
+
+bool ProfilingEntitySystemAdapter::GetAllEntityIDs(
+    std::vector<GenericEntityId>* ids_out) {
+  ScopedCall timer(this, kGetAllEntityIDs);
+  return wrapped_->GetAllEntityIDs(ids_out);
+}
+
+void ProfilingEntitySystemAdapter::RefreshEntityIDs() {
+  ScopedCall timer(this, kRefreshEntityIDs);
+  wrapped_->RefreshEntityIDs();
+}
+
+void ProfilingEntitySystemAdapter::RefreshEntityIDList() {
+  ScopedCall timer(this, kRefreshEntityIDList);
+  wrapped_->RefreshEntityIDList();
+}
+
+uint64_t ProfilingEntitySystemAdapter::GetEntityIDsGeneration() {
+  ScopedCall timer(this, kGetEntityIDsGeneration);
+  return wrapped_->GetEntityIDsGeneration();
+}
+
+bool ProfilingEntitySystemAdapter::GetAllPrototypeIDs(
+    std::vector<GenericPrototypeId>* ids_out) {
+  ScopedCall timer(this, kGetAllPrototypeIDs);
+  return wrapped_->GetAllPrototypeIDs(ids_out);
+}
+
+void ProfilingEntitySystemAdapter::RefreshPrototypeIDs() {
+  ScopedCall timer(this, kRefreshPrototypeIDs);
+  wrapped_->RefreshPrototypeIDs();
+}
+
+bool ProfilingEntitySystemAdapter::GetEntityName(const GenericEntityId& id,
+                                                 std::string* name_out) {
+  ScopedCall timer(this, kGetEntityName);
+  return wrapped_->GetEntityName(id, name_out);
+}
+
+bool ProfilingEntitySystemAdapter::GetEntityDescription(
+    const GenericEntityId& id, std::string* description_out) {
+  ScopedCall timer(this, kGetEntityDescription);
+  return wrapped_->GetEntityDescription(id, description_out);
+}
+
+bool ProfilingEntitySystemAdapter::FilterShowEntityID(
+    const GenericEntityId& id, const std::string& filter) {
+  ScopedCall timer(this, kFilterShowEntityID);
+  return wrapped_->FilterShowEntityID(id, filter);
+}
+
+bool ProfilingEntitySystemAdapter::GetEntitySourceFile(
+    const GenericEntityId& id, std::string* source_file_out) {
+  ScopedCall timer(this, kGetEntitySourceFile);
+  return wrapped_->GetEntitySourceFile(id, source_file_out);
+}
+
+bool ProfilingEntitySystemAdapter::GetSchema(
+    const reflection::Schema** schema_out) {
+  ScopedCall timer(this, kGetSchema);
+  return wrapped_->GetSchema(schema_out);
+}
+
+bool ProfilingEntitySystemAdapter::GetTextSchema(std::string* schema_out) {
+  ScopedCall timer(this, kGetTextSchema);
+  return wrapped_->GetTextSchema(schema_out);
+}
+
+bool ProfilingEntitySystemAdapter::GetTableObject(
+    const GenericComponentId& id, const reflection::Object** table_out) {
+  ScopedCall timer(this, kGetTableObject);
+  return wrapped_->GetTableObject(id, table_out);
+}
+
+bool ProfilingEntitySystemAdapter::GetTableName(const GenericComponentId& id,
+                                                std::string* name_out) {
+  ScopedCall timer(this, kGetTableName);
+  return wrapped_->GetTableName(id, name_out);
+}
+
+bool ProfilingEntitySystemAdapter::SerializeEntities(
+    const std::vector<GenericEntityId>& id, std::vector<uint8_t>* buffer_out) {
+  ScopedCall timer(this, kSerializeEntities);
+  return wrapped_->SerializeEntities(id, buffer_out);
+}
+
+void ProfilingEntitySystemAdapter::OverrideFileCache(
+    const std::string& filename, const std::vector<uint8_t>& data) {
+  ScopedCall timer(this, kOverrideFileCache);
+  wrapped_->OverrideFileCache(filename, data);
+}
+
+void ProfilingEntitySystemAdapter::UpdateFileCache(
+    const std::string& filename, const SharedFileBuffer& data) {
+  ScopedCall timer(this, kUpdateFileCache);
+  wrapped_->UpdateFileCache(filename, data);
+}
+
+bool ProfilingEntitySystemAdapter::GetEntityComponentList(
+    const GenericEntityId& id,
+    std::vector<GenericComponentId>* components_out) {
+  ScopedCall timer(this, kGetEntityComponentList);
+  return wrapped_->GetEntityComponentList(id, components_out);
+}
+
+void ProfilingEntitySystemAdapter::GetFullComponentList(
+    std::vector<GenericComponentId>* components_out) {
+  ScopedCall timer(this, kGetFullComponentList);
+  wrapped_->GetFullComponentList(components_out);
+}
+
+bool ProfilingEntitySystemAdapter::GetEntitiesWithComponents(
+    const std::vector<GenericComponentId>& components,
+    std::vector<GenericEntityId>* ids_out) {
+  ScopedCall timer(this, kGetEntitiesWithComponents);
+  return wrapped_->GetEntitiesWithComponents(components, ids_out);
+}
+
+bool ProfilingEntitySystemAdapter::IsEntityComponentFromPrototype(
+    const GenericEntityId& entity, const GenericComponentId& component) {
+  ScopedCall timer(this, kIsEntityComponentFromPrototype);
+  return wrapped_->IsEntityComponentFromPrototype(entity, component);
+}
+
+bool ProfilingEntitySystemAdapter::SerializeEntityComponent(
+    const GenericEntityId& entity_id, const GenericComponentId& component,
+    flatbuffers::unique_ptr_t* data_out) {
+  ScopedCall timer(this, kSerializeEntityComponent);
+  return wrapped_->SerializeEntityComponent(entity_id, component, data_out);
+}
+
+bool ProfilingEntitySystemAdapter::DeserializeEntityComponent(
+    const GenericEntityId& entity_id, const GenericComponentId& component,
+    const uint8_t* data) {
+  ScopedCall timer(this, kDeserializeEntityComponent);
+  return wrapped_->DeserializeEntityComponent(entity_id, component, data);
+}
+
+void ProfilingEntitySystemAdapter::ClearEntityIds() {
+  ScopedCall timer(this, kClearEntityIds);
+  wrapped_->ClearEntityIds();
+}
+
+}  // namespace scene_lab
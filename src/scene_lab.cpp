@@ -15,6 +15,7 @@
 #include "scene_lab/scene_lab.h"
 
 #include <math.h>
+#include <chrono>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -25,6 +26,9 @@
 #include "fplbase/utilities.h"
 #include "mathfu/utilities.h"
 #include "scene_lab/basic_camera.h"
+#include "scene_lab/entity_json_writer.h"
+#include "scene_lab/profiler.h"
+#include "scene_lab/util.h"
 
 namespace scene_lab {
 
@@ -39,40 +43,112 @@ static const char kDefaultBinaryEntityFileExtension[] = "bin";
 
 static const char kDefaultEntityFile[] = "entities_default";
 
+// Flags for what happened to an entity since the last DispatchEntityEvents().
+// An entity can be deleted and then created again with the same ID, so a
+// deletion and creation may both be queued.
+static const unsigned int kEntityCreatedEvent = 1 << 0;
+static const unsigned int kEntityUpdatedEvent = 1 << 1;
+static const unsigned int kEntityDeletedEvent = 1 << 2;
+
+// Call each of `callbacks` with `entities`, if there are any.
+static void CallEntityBatchCallbacks(
+    const std::vector<EntityBatchCallback>& callbacks,
+    const std::vector<GenericEntityId>& entities) {
+  if (entities.empty()) return;
+  for (auto iter = callbacks.begin(); iter != callbacks.end(); ++iter) {
+    (*iter)(entities.data(), entities.size());
+  }
+}
+
+typedef std::chrono::steady_clock SaveClock;
+
+static double SecondsSince(SaveClock::time_point start) {
+  return std::chrono::duration<double>(SaveClock::now() - start).count();
+}
+
 // String which identifies the current version of Scene Lab. See the comment on
 // kVersion in scene_lab.h for more information on how this is used.
 const char SceneLab::kVersion[] = "Scene Lab 1.1.1";
 
+SceneLab::~SceneLab() {
+  // The workers' tasks use file_hashes_ and friends, which are destroyed
+  // before save_workers_ would be.
+  WaitForPendingSave();
+  save_workers_.reset();
+}
+
 void SceneLab::Initialize(const SceneLabConfig* config,
                           fplbase::AssetManager* asset_manager,
                           fplbase::InputSystem* input,
                           fplbase::Renderer* renderer,
                           flatui::FontManager* font_manager) {
-  version_ = kVersion;
-  config_ = config;
   font_manager_ = font_manager;
 
   asset_manager_ = asset_manager;
   renderer_ = renderer;
   input_system_ = input;
 
-  if (config_->gui_font() != nullptr) {
-    font_manager_->Open(config_->gui_font()->c_str());
+  if (config->gui_font() != nullptr) {
+    font_manager_->Open(config->gui_font()->c_str());
   }
 
+  InitializeEditor(config, std::unique_ptr<EditorInput>(
+                               new FplbaseEditorInput(input, renderer)));
+  gui_.reset(new EditorGui(config_, this, asset_manager_, input_system_,
+                           renderer_, font_manager_));
+}
+
+void SceneLab::InitializeHeadless(const SceneLabConfig* config,
+                                  std::unique_ptr<EditorInput> input) {
+  font_manager_ = nullptr;
+  asset_manager_ = nullptr;
+  renderer_ = nullptr;
+  input_system_ = nullptr;
+  InitializeEditor(config, std::move(input));
+  gui_.reset();
+}
+
+void SceneLab::InitializeEditor(const SceneLabConfig* config,
+                                std::unique_ptr<EditorInput> input) {
+  version_ = kVersion;
+  config_ = config;
+  editor_input_ = std::move(input);
+
   horizontal_forward_ = mathfu::kAxisY3f;
   horizontal_right_ = mathfu::kAxisX3f;
-  controller_.reset(new EditorController(config_, input_system_));
+  controller_.reset(new EditorController(config_, editor_input_.get()));
   input_mode_ = kMoving;
   mouse_mode_ = kMoveHorizontal;
-  gui_.reset(new EditorGui(config_, this, asset_manager_, input_system_,
-                           renderer_, font_manager_));
   initial_camera_set_ = false;
+  text_schema_parser_.reset();
+  text_schema_parser_source_.clear();
+  text_schema_parser_valid_ = false;
+  files_modified_since_disk_save_.clear();
+  files_modified_since_cache_save_.clear();
+  all_files_modified_since_disk_save_ = false;
+  all_files_modified_since_cache_save_ = false;
+}
+
+void SceneLab::SetEditorInput(std::unique_ptr<EditorInput> input) {
+  controller_->set_input(input.get());
+  editor_input_ = std::move(input);
 }
 
 void SceneLab::SetEntitySystemAdapter(
     std::unique_ptr<EntitySystemAdapter> adapter) {
+  // Any save in progress is using the old adapter's schema.
+  WaitForPendingSave();
   entity_system_adapter_ = std::move(adapter);
+  // The new adapter may have a different schema, so parse it again when next
+  // needed.
+  text_schema_parser_.reset();
+  text_schema_parser_source_.clear();
+  text_schema_parser_valid_ = false;
+  // Nothing has been edited in the new adapter's world yet.
+  files_modified_since_disk_save_.clear();
+  files_modified_since_cache_save_.clear();
+  all_files_modified_since_disk_save_ = false;
+  all_files_modified_since_cache_save_ = false;
 }
 
 // Project `v` onto `unit`. That is, return the vector colinear with `unit`
@@ -82,6 +158,14 @@ static inline vec3 ProjectOntoUnitVector(const vec3& v, const vec3& unit) {
 }
 
 void SceneLab::AdvanceFrame(double time_delta_seconds) {
+  SCENE_LAB_PROFILE_ZONE("SceneLab::AdvanceFrame");
+
+  // With no GUI there's no Render() call to update the controller in, so do
+  // it here, before reading this frame's input.
+  if (headless()) controller_->Update();
+
+  UpdatePendingSave();
+
   GenericCamera camera;
   entity_system_adapter()->GetCamera(&camera);
 
@@ -108,13 +192,13 @@ void SceneLab::AdvanceFrame(double time_delta_seconds) {
 
     entity_system_adapter()->SetCamera(camera);
 
-    if (!gui_->InputCaptured() &&
+    if (!GuiInputCaptured() &&
         controller_->ButtonWentDown(config_->toggle_mode_button())) {
       input_mode_ = kEditing;
       controller_->UnlockMouse();
     }
   } else if (input_mode_ == kEditing) {
-    if (!gui_->InputCaptured() &&
+    if (!GuiInputCaptured() &&
         controller_->ButtonWentDown(config_->toggle_mode_button())) {
       controller_->SetFacing(camera.facing);
       controller_->LockMouse();
@@ -125,21 +209,22 @@ void SceneLab::AdvanceFrame(double time_delta_seconds) {
       input_mode_ = kEditing;
     }
 
-    if (!gui_->InputCaptured() &&
+    if (!GuiInputCaptured() &&
         controller_->ButtonWentDown(config_->toggle_mode_button())) {
       controller_->SetFacing(camera.facing);
       controller_->LockMouse();
       input_mode_ = kMoving;
     }
   }
+  UpdateTransformEdit();
 
   GenericEntityId next_entity = EntitySystemAdapter::kNoEntityId;
-  if (gui_->CanDeselectEntity()) {
-    if (!gui_->InputCaptured() &&
+  if (GuiCanDeselectEntity()) {
+    if (!GuiInputCaptured() &&
         controller_->KeyWentDown(fplbase::FPLK_RIGHTBRACKET)) {
       entity_system_adapter()->CycleEntities(1, &next_entity);
     }
-    if (!gui_->InputCaptured() &&
+    if (!GuiInputCaptured() &&
         controller_->KeyWentDown(fplbase::FPLK_LEFTBRACKET)) {
       entity_system_adapter()->CycleEntities(-1, &next_entity);
     }
@@ -151,7 +236,7 @@ void SceneLab::AdvanceFrame(double time_delta_seconds) {
 
   GenericEntityId clicked_entity = EntitySystemAdapter::kNoEntityId;
 
-  if (!gui_->InputCaptured() && gui_->CanDeselectEntity() &&
+  if (!GuiInputCaptured() && GuiCanDeselectEntity() &&
       controller_->ButtonWentDown(config_->interact_button())) {
     // Use position of the mouse pointer for the ray cast.
     vec3 start, dir;
@@ -165,8 +250,8 @@ void SceneLab::AdvanceFrame(double time_delta_seconds) {
       if (entity_system_adapter()->GetViewportSettings(&viewport)) {
         mathfu::vec2 pointer = controller_->GetPointer();
         if (controller_->ScreenPointToWorldRay(camera, viewport, pointer,
-                                               renderer_->window_size(), &start,
-                                               &dir)) {
+                                               editor_input_->WindowSize(),
+                                               &start, &dir)) {
           got_ray = true;
         }
       }
@@ -197,14 +282,13 @@ void SceneLab::AdvanceFrame(double time_delta_seconds) {
     if (entity_system_adapter()->GetEntityTransform(selected_entity_,
                                                     &transform)) {
       if (ModifyTransformBasedOnInput(&transform)) {
-        set_entities_modified(true);
         entity_system_adapter()->SetEntityTransform(selected_entity_,
                                                     transform);
         NotifyUpdateEntity(selected_entity_);
       }
     }
 
-    if (!gui_->InputCaptured() &&
+    if (!GuiInputCaptured() &&
         (controller_->KeyWentDown(fplbase::FPLK_INSERT) ||
          controller_->KeyWentDown(fplbase::FPLK_v))) {
       GenericEntityId new_entity;
@@ -214,7 +298,7 @@ void SceneLab::AdvanceFrame(double time_delta_seconds) {
         NotifyUpdateEntity(new_entity);
       }
     }
-    if (!gui_->InputCaptured() &&
+    if (!GuiInputCaptured() &&
         (controller_->KeyWentDown(fplbase::FPLK_DELETE) ||
          controller_->KeyWentDown(fplbase::FPLK_x))) {
       NotifyDeleteEntity(selected_entity_);
@@ -240,7 +324,7 @@ void SceneLab::AdvanceFrame(double time_delta_seconds) {
       vec3 mouse_ray_origin;
       vec3 mouse_ray_dir;
       controller_->ScreenPointToWorldRay(camera, viewport, pointer,
-                                         renderer_->window_size(),
+                                         editor_input_->WindowSize(),
                                          &mouse_ray_origin, &mouse_ray_dir);
 
       if (mouse_mode_ == kScaleX || mouse_mode_ == kScaleY ||
@@ -268,26 +352,30 @@ void SceneLab::AdvanceFrame(double time_delta_seconds) {
         drag_orig_scale_ = transform.scale;
 
         input_mode_ = kDragging;
+        UpdateTransformEdit();
       }
     }
   }
 
-  if (input_mode_ != kDragging) {
+  // Headless, the mouse mode is only changed by set_mouse_mode().
+  if (!headless() && input_mode_ != kDragging) {
     // If not dragging, then see if we changed the mouse mode.
     unsigned int mode_idx = gui_->mouse_mode_index();
     if (mode_idx < kMouseModeCount) {
       mouse_mode_ = static_cast<MouseMode>(mode_idx);
     }
-  } else {
+  } else if (!headless()) {
     // If we are still dragging, don't allow the mouse mode to be changed.
     gui_->set_mouse_mode_index(mouse_mode_);
   }
 
-  if (exit_requested_ && gui_->CanExit()) {
+  if (exit_requested_ && GuiCanExit()) {
     exit_ready_ = !entities_modified_;
   } else {
     exit_ready_ = false;
   }
+
+  DispatchEntityEvents();
 }
 
 void SceneLab::SelectEntity(const GenericEntityId& entity_id) {
@@ -304,6 +392,21 @@ void SceneLab::SelectEntity(const GenericEntityId& entity_id) {
     selected_entity_ = entity_id;
     entity_system_adapter()->SetEntityHighlighted(selected_entity_, true);
   }
+  UpdateTransformEdit();
+}
+
+void SceneLab::UpdateTransformEdit() {
+  GenericEntityId editing = input_mode_ == kDragging
+                                ? selected_entity_
+                                : EntitySystemAdapter::kNoEntityId;
+  if (editing == transform_edit_entity_) return;
+  if (transform_edit_entity_ != EntitySystemAdapter::kNoEntityId) {
+    entity_system_adapter()->EndTransformEdit(transform_edit_entity_);
+  }
+  transform_edit_entity_ = editing;
+  if (transform_edit_entity_ != EntitySystemAdapter::kNoEntityId) {
+    entity_system_adapter()->BeginTransformEdit(transform_edit_entity_);
+  }
 }
 
 void SceneLab::MoveEntityToCamera(const GenericEntityId& id) {
@@ -315,10 +418,14 @@ void SceneLab::MoveEntityToCamera(const GenericEntityId& id) {
         camera.position + camera.facing * config_->entity_spawn_distance();
     if (transform.position.z < 0) transform.position.z = 0;
     entity_system_adapter()->SetEntityTransform(id, transform);
+    MarkEntityModified(id);
   }
 }
 
 void SceneLab::Render(fplbase::Renderer* /*renderer*/) {
+  SCENE_LAB_PROFILE_ZONE("SceneLab::Render");
+  if (headless()) return;
+
   // Render any editor-specific things
   gui_->SetEditEntity(selected_entity_);
   if (selected_entity_ != EntitySystemAdapter::kNoEntityId &&
@@ -362,28 +469,103 @@ void SceneLab::NotifyExitEditor() const {
   }
 }
 
-void SceneLab::NotifyCreateEntity(const GenericEntityId& entity) const {
+void SceneLab::NotifyCreateEntity(const GenericEntityId& entity) {
+  MarkEntityModified(entity);
   entity_system_adapter()->OnEntityCreated(entity);
   for (auto iter = on_create_entity_callbacks_.begin();
        iter != on_create_entity_callbacks_.end(); ++iter) {
     (*iter)(entity);
   }
+  QueueEntityEvent(entity, kEntityCreatedEvent);
 }
 
-void SceneLab::NotifyUpdateEntity(const GenericEntityId& entity) const {
+void SceneLab::NotifyUpdateEntity(const GenericEntityId& entity) {
+  MarkEntityModified(entity);
   entity_system_adapter()->OnEntityUpdated(entity);
   for (auto iter = on_update_entity_callbacks_.begin();
        iter != on_update_entity_callbacks_.end(); ++iter) {
     (*iter)(entity);
   }
+  QueueEntityEvent(entity, kEntityUpdatedEvent);
 }
 
-void SceneLab::NotifyDeleteEntity(const GenericEntityId& entity) const {
+void SceneLab::NotifyDeleteEntity(const GenericEntityId& entity) {
+  // The entity still exists at this point, so we can find its file.
+  MarkEntityModified(entity);
   entity_system_adapter()->OnEntityDeleted(entity);
   for (auto iter = on_delete_entity_callbacks_.begin();
        iter != on_delete_entity_callbacks_.end(); ++iter) {
     (*iter)(entity);
   }
+  QueueEntityEvent(entity, kEntityDeletedEvent);
+}
+
+void SceneLab::QueueEntityEvent(const GenericEntityId& entity,
+                                unsigned int event) {
+  auto inserted = queued_entity_events_.insert(std::make_pair(entity, 0u));
+  if (inserted.second) queued_entities_.push_back(entity);
+  unsigned int& events = inserted.first->second;
+  if (event == kEntityCreatedEvent) {
+    // Listeners will look at the whole entity, so earlier updates don't
+    // matter.
+    events = (events & kEntityDeletedEvent) | kEntityCreatedEvent;
+  } else if (event == kEntityUpdatedEvent) {
+    // Updates to entities created this frame are covered by the creation.
+    if (events == 0) events = kEntityUpdatedEvent;
+  } else if (event == kEntityDeletedEvent) {
+    // If the entity was created this frame, listeners need never hear of it.
+    // Otherwise only the deletion matters.
+    events = (events == kEntityCreatedEvent) ? 0 : kEntityDeletedEvent;
+  }
+}
+
+void SceneLab::DispatchEntityEvents() {
+  if (queued_entities_.empty()) return;
+
+  // Take the queue first, so that callbacks can queue more events for next
+  // time.
+  std::vector<GenericEntityId> entities;
+  std::unordered_map<GenericEntityId, unsigned int> events;
+  entities.swap(queued_entities_);
+  events.swap(queued_entity_events_);
+
+  std::vector<GenericEntityId> created, updated, deleted;
+  for (auto entity = entities.begin(); entity != entities.end(); ++entity) {
+    unsigned int entity_events = events[*entity];
+    if (entity_events & kEntityDeletedEvent) deleted.push_back(*entity);
+    if (entity_events & kEntityCreatedEvent) created.push_back(*entity);
+    if (entity_events & kEntityUpdatedEvent) updated.push_back(*entity);
+  }
+  CallEntityBatchCallbacks(on_delete_entities_callbacks_, deleted);
+  CallEntityBatchCallbacks(on_create_entities_callbacks_, created);
+  CallEntityBatchCallbacks(on_update_entities_callbacks_, updated);
+}
+
+std::string SceneLab::GetEntitySaveFile(const GenericEntityId& entity) {
+  std::string filename;
+  if (!entity_system_adapter()->GetEntitySourceFile(entity, &filename)) {
+    return std::string();
+  }
+  // Blank filename indicates save to a default file.
+  if (filename.length() == 0) filename = kDefaultEntityFile;
+  return filename;
+}
+
+void SceneLab::MarkEntityModified(const GenericEntityId& entity) {
+  MarkFileModified(GetEntitySaveFile(entity));
+}
+
+void SceneLab::MarkFileModified(const std::string& filename) {
+  entities_modified_ = true;
+  if (filename.length() == 0) return;
+  files_modified_since_disk_save_.insert(filename);
+  files_modified_since_cache_save_.insert(filename);
+}
+
+void SceneLab::MarkAllFilesModified() {
+  entities_modified_ = true;
+  all_files_modified_since_disk_save_ = true;
+  all_files_modified_since_cache_save_ = true;
 }
 
 void SceneLab::Activate() {
@@ -395,7 +577,7 @@ void SceneLab::Activate() {
 
   NotifyEnterEditor();
 
-  gui_->Activate();
+  if (!headless()) gui_->Activate();
 
   // De-select all entities.
   SelectEntity(EntitySystemAdapter::kNoEntityId);
@@ -417,66 +599,353 @@ void SceneLab::Deactivate() {
   // De-select all entities.
   SelectEntity(EntitySystemAdapter::kNoEntityId);
 
+  // Don't let the game carry on while files are still half-written.
+  WaitForPendingSave();
   SaveScene(false);
 
+  // Let listeners catch up before the game takes over again.
+  DispatchEntityEvents();
+
   entity_system_adapter()->OnDeactivate();
 
-  gui_->Deactivate();
+  if (!headless()) gui_->Deactivate();
 
   NotifyExitEditor();
 }
 
 bool SceneLab::SaveScene(bool to_disk) {
-  // Get a list of all filenames in the world.
-  std::vector<GenericEntityId> entity_ids;
-  if (!entity_system_adapter()->GetAllEntityIDs(&entity_ids)) {
-    fplbase::LogInfo("Scene Lab: Couldn't get entity IDs.");
-    return false;
+  SCENE_LAB_PROFILE_ZONE("SceneLab::SaveScene");
+  // Use the worker pool (if configured), but wait for it to finish.
+  SceneSaveHandle save =
+      StartSave(to_disk, to_disk && config_->save_worker_threads() > 0);
+  if (!save->done()) {
+    if (save_workers_ != nullptr) save_workers_->WaitForAllTasks();
+    FinishSave(save.get());
+  }
+  return save->report().success;
+}
+
+SceneSaveHandle SceneLab::SaveSceneAsync(
+    bool to_disk, const SaveProgressCallback& on_progress,
+    const SaveCompleteCallback& on_complete) {
+  SceneSaveHandle save = StartSave(to_disk, true);
+  save->on_progress_ = on_progress;
+  save->on_complete_ = on_complete;
+  if (save->done()) {
+    // Nothing needed writing, or we couldn't even get started.
+    if (on_complete) on_complete(save->report());
+  } else {
+    pending_save_ = save;
+  }
+  return save;
+}
+
+void SceneLab::WaitForPendingSave() {
+  if (pending_save_ == nullptr) return;
+  save_workers_->WaitForAllTasks();
+  UpdatePendingSave();
+}
+
+void SceneLab::UpdatePendingSave() {
+  if (pending_save_ == nullptr) return;
+  // Hold a reference, as the callbacks may start another save.
+  SceneSaveHandle save = pending_save_;
+  size_t finished = save->files_finished();
+  if (finished != save->files_reported_) {
+    save->files_reported_ = finished;
+    if (save->on_progress_) save->on_progress_(finished, save->files_total());
+  }
+  if (finished == save->files_total()) {
+    pending_save_.reset();
+    FinishSave(save.get());
+    if (save->on_complete_) save->on_complete_(save->report());
   }
+}
+
+SceneSaveHandle SceneLab::StartSave(bool to_disk, bool use_workers) {
+  SCENE_LAB_PROFILE_ZONE("SceneLab::StartSave");
+  // Never have two saves writing the same files at once.
+  WaitForPendingSave();
+
+  SceneSaveHandle save(new SceneSave());
+  SaveSceneReport& report = save->report_;
+  report.to_disk = to_disk;
+  save->start_time_ = SaveClock::now();
+
   // Deselect the selected entity.
   GenericEntityId prev_selected = selected_entity_;
   if (prev_selected != EntitySystemAdapter::kNoEntityId)
     SelectEntity(EntitySystemAdapter::kNoEntityId);
 
-  // Divide up entity IDs by filename.
+  // Saving to disk also updates the file cache, so it clears both sets.
+  std::unordered_set<std::string>& modified_files =
+      to_disk ? files_modified_since_disk_save_
+              : files_modified_since_cache_save_;
+  bool& all_files_modified = to_disk ? all_files_modified_since_disk_save_
+                                     : all_files_modified_since_cache_save_;
+  const bool saving_all_files = all_files_modified;
+  std::vector<GenericEntityId> entity_ids;
+  bool nothing_to_save = !saving_all_files && modified_files.empty();
+  // Don't miss entities the game created or deleted without telling us.
+  if (!nothing_to_save) entity_system_adapter()->RefreshEntityIDList();
+  if (nothing_to_save ||
+      !entity_system_adapter()->GetAllEntityIDs(&entity_ids)) {
+    if (nothing_to_save) {
+      // Nothing has changed since the last save, so there's nothing to do.
+      report.success = true;
+      set_entities_modified(false);
+    } else {
+      fplbase::LogInfo("Scene Lab: Couldn't get entity IDs.");
+    }
+    if (prev_selected != EntitySystemAdapter::kNoEntityId)
+      SelectEntity(prev_selected);
+    last_save_report_ = report;
+    save->done_ = true;
+    return save;
+  }
+
+  // Divide up entity IDs by filename, keeping only the modified files.
+  // Modified files that no longer have any entities in them are still saved,
+  // as empty entity lists.
   std::unordered_map<std::string, std::vector<GenericEntityId>> ids_by_file;
+  for (auto f = modified_files.begin(); f != modified_files.end(); ++f) {
+    ids_by_file[*f] = std::vector<GenericEntityId>();
+  }
+  std::unordered_set<std::string> skipped_files;
   for (auto e = entity_ids.begin(); e != entity_ids.end(); ++e) {
-    std::string filename;
-    if (entity_system_adapter()->GetEntitySourceFile(*e, &filename)) {
-      if (filename.length() == 0) {
-        // Blank filename indicates save to a default file.
-        filename = kDefaultEntityFile;
-      }
-      auto file = ids_by_file.find(filename);
-      if (file == ids_by_file.end()) {
-        ids_by_file[filename] = std::vector<GenericEntityId>();
-        file = ids_by_file.find(filename);
+    std::string filename = GetEntitySaveFile(*e);
+    if (filename.length() == 0) continue;
+    auto file = ids_by_file.find(filename);
+    if (file == ids_by_file.end()) {
+      if (!saving_all_files) {
+        skipped_files.insert(filename);
+        continue;
       }
-      file->second.push_back(*e);
+      file = ids_by_file.insert(std::make_pair(
+                                    filename, std::vector<GenericEntityId>()))
+                 .first;
     }
+    file->second.push_back(*e);
   }
-  // Save entities in each file.
+  report.files_skipped = skipped_files.size();
+
+  // Serialize everything up front, so the files we write are a consistent
+  // snapshot even if entities are edited while they're being written.
+  report.files.resize(ids_by_file.size());
+  save->buffers_.resize(ids_by_file.size());
+  size_t file_index = 0;
   for (auto iter = ids_by_file.begin(); iter != ids_by_file.end(); ++iter) {
     const std::string& filename = iter->first;
-    if (filename.length() == 0) {
-      // Skip blank filename.
+    EntityFileSaveResult& result = report.files[file_index];
+    SharedFileBuffer& buffer = save->buffers_[file_index];
+    file_index++;
+    result.filename = filename;
+    result.entity_count = iter->second.size();
+    SaveClock::time_point serialize_start = SaveClock::now();
+    std::vector<uint8_t> output;
+    result.serialized =
+        entity_system_adapter()->SerializeEntities(iter->second, &output);
+    result.serialize_seconds = SecondsSince(serialize_start);
+    if (!result.serialized) {
+      result.error = "Couldn't serialize entities.";
       continue;
     }
-    std::vector<uint8_t> output;
-    if (entity_system_adapter()->SerializeEntities(iter->second, &output)) {
-      if (to_disk) {
-        // Write "output" to disk. Also write the JSON version.
-        WriteEntityFile(filename, output);
-      }
-      entity_system_adapter()->OverrideFileCache(
-          filename + "." + BinaryEntityFileExtension(), output);
+    // The file cache and the file writers share this one buffer.
+    buffer = std::make_shared<const std::vector<uint8_t>>(std::move(output));
+    entity_system_adapter()->UpdateFileCache(
+        filename + "." + BinaryEntityFileExtension(), buffer);
+  }
+
+  // The snapshot now holds these files' contents, so any edits from here on
+  // mark them as modified again. Files that fail to save are marked again in
+  // FinishSave().
+  all_files_modified = false;
+  if (to_disk && saving_all_files) all_files_modified_since_cache_save_ = false;
+  for (auto file = report.files.begin(); file != report.files.end(); ++file) {
+    if (file->serialized) {
+      modified_files.erase(file->filename);
+      if (to_disk) files_modified_since_cache_save_.erase(file->filename);
+    } else {
+      modified_files.insert(file->filename);
     }
   }
   set_entities_modified(false);
-
   if (prev_selected != EntitySystemAdapter::kNoEntityId)
     SelectEntity(prev_selected);
-  return true;
+
+  if (!to_disk) {
+    FinishSave(save.get());
+    return save;
+  }
+
+  // If we're exporting JSON, parse the text schema (if it's changed) once for
+  // all of the files. Otherwise ExportJson() can be called later.
+  const flatbuffers::Parser* text_schema_parser = nullptr;
+  const reflection::Schema* binary_schema = nullptr;
+  if (config_->export_json_on_save()) {
+    GetJsonExportSchemas(&text_schema_parser, &binary_schema);
+  }
+  WorkerPool* workers = nullptr;
+  if (use_workers) {
+    int num_threads = std::max(config_->save_worker_threads(), 1);
+    if (save_workers_ == nullptr || save_workers_->num_threads() != num_threads)
+      save_workers_.reset(new WorkerPool(num_threads));
+    workers = save_workers_.get();
+    report.worker_threads = workers->num_threads();
+  }
+  // Write the binary and JSON files. Worker tasks hold a reference to the save
+  // so the buffers outlive them; they only ever touch their own file's result.
+  for (size_t i = 0; i < report.files.size(); i++) {
+    if (!report.files[i].serialized) {
+      save->files_finished_++;
+      continue;
+    }
+    if (workers != nullptr) {
+      workers->AddTask(
+          [this, save, text_schema_parser, binary_schema, i]() {
+            EntityFileSaveResult* result = &save->report_.files[i];
+            WriteEntityFile(result->filename, *save->buffers_[i],
+                            text_schema_parser, binary_schema, result);
+            save->files_finished_++;
+          });
+    } else {
+      EntityFileSaveResult* result = &report.files[i];
+      WriteEntityFile(result->filename, *save->buffers_[i],
+                      text_schema_parser, binary_schema, result);
+      save->files_finished_++;
+    }
+  }
+  if (workers == nullptr) FinishSave(save.get());
+  return save;
+}
+
+// Fill in a report's totals from its per-file results.
+static void TallySaveReport(SaveSceneReport* report) {
+  report->success = true;
+  for (auto file = report->files.begin(); file != report->files.end();
+       ++file) {
+    report->writes_done +=
+        (file->binary_written ? 1 : 0) + (file->json_written ? 1 : 0);
+    report->writes_skipped +=
+        (file->binary_unchanged ? 1 : 0) + (file->json_unchanged ? 1 : 0);
+    if (!file->error.empty()) report->success = false;
+  }
+}
+
+void SceneLab::FinishSave(SceneSave* save) {
+  SaveSceneReport& report = save->report_;
+  report.total_seconds = SecondsSince(save->start_time_);
+  TallySaveReport(&report);
+  for (auto file = report.files.begin(); file != report.files.end(); ++file) {
+    if (file->error.empty()) continue;
+    // Try this file again next time.
+    files_modified_since_disk_save_.insert(file->filename);
+    entities_modified_ = true;
+  }
+  save->buffers_.clear();
+  save->done_ = true;
+  LogSaveReport(report);
+  last_save_report_ = report;
+}
+
+bool SceneLab::ExportJson() {
+  // Don't read files that a save is still writing.
+  WaitForPendingSave();
+  std::vector<GenericEntityId> entity_ids;
+  entity_system_adapter()->RefreshEntityIDList();
+  if (!entity_system_adapter()->GetAllEntityIDs(&entity_ids)) {
+    fplbase::LogInfo("Scene Lab: Couldn't get entity IDs.");
+    return false;
+  }
+  std::unordered_set<std::string> filenames;
+  for (auto e = entity_ids.begin(); e != entity_ids.end(); ++e) {
+    std::string filename = GetEntitySaveFile(*e);
+    if (filename.length() != 0) filenames.insert(filename);
+  }
+  const flatbuffers::Parser* text_schema_parser;
+  const reflection::Schema* binary_schema;
+  GetJsonExportSchemas(&text_schema_parser, &binary_schema);
+  if (text_schema_parser == nullptr && binary_schema == nullptr) {
+    fplbase::LogError("Scene Lab: No schema loaded, can't export JSON.");
+    return false;
+  }
+
+  SaveSceneReport report;
+  report.to_disk = true;
+  SaveClock::time_point start = SaveClock::now();
+  for (auto f = filenames.begin(); f != filenames.end(); ++f) {
+    EntityFileSaveResult result;
+    result.filename = *f;
+    // The entity data comes from the binary file, which we don't rewrite.
+    result.serialized = true;
+    report.files.push_back(result);
+  }
+  auto export_file = [this, text_schema_parser, binary_schema](
+      EntityFileSaveResult* result) {
+    std::string binary_path =
+        result->filename + "." + BinaryEntityFileExtension();
+    std::string contents;
+    if (!fplbase::LoadFile(binary_path.c_str(), &contents)) {
+      result->error = "Couldn't load binary file '" + binary_path + "'.";
+      return;
+    }
+    WriteEntityJsonFile(result->filename,
+                        reinterpret_cast<const uint8_t*>(contents.data()),
+                        HashBytes(contents.data(), contents.size()),
+                        text_schema_parser, binary_schema, result);
+  };
+  if (config_->save_worker_threads() > 0) {
+    if (save_workers_ == nullptr ||
+        save_workers_->num_threads() != config_->save_worker_threads()) {
+      save_workers_.reset(new WorkerPool(config_->save_worker_threads()));
+    }
+    report.worker_threads = save_workers_->num_threads();
+    for (size_t i = 0; i < report.files.size(); i++) {
+      EntityFileSaveResult* result = &report.files[i];
+      save_workers_->AddTask([export_file, result]() { export_file(result); });
+    }
+    save_workers_->WaitForAllTasks();
+  } else {
+    for (size_t i = 0; i < report.files.size(); i++) {
+      export_file(&report.files[i]);
+    }
+  }
+  report.total_seconds = SecondsSince(start);
+  TallySaveReport(&report);
+  LogSaveReport(report);
+  return report.success;
+}
+
+void SceneLab::LogSaveReport(const SaveSceneReport& report) {
+  for (auto file = report.files.begin(); file != report.files.end(); ++file) {
+    if (!file->serialized) {
+      fplbase::LogError("Couldn't serialize entities for file '%s'.",
+                        file->filename.c_str());
+      continue;
+    }
+    if (!report.to_disk) continue;
+    if (file->binary_written) {
+      fplbase::LogInfo("Save (binary) to file '%s' successful.",
+                       file->filename.c_str());
+    }
+    if (file->json_written) {
+      fplbase::LogInfo("Save (JSON) to file '%s' successful",
+                       file->filename.c_str());
+    }
+    if (!file->error.empty()) {
+      fplbase::LogError("Save to file '%s' failed: %s", file->filename.c_str(),
+                        file->error.c_str());
+    }
+  }
+  if (report.to_disk) {
+    fplbase::LogInfo(
+        "Scene Lab: saved %d entity file(s) in %.3fs (%d workers), skipped "
+        "%d unmodified; %d file write(s), %d identical on disk.",
+        static_cast<int>(report.files.size()), report.total_seconds,
+        report.worker_threads, static_cast<int>(report.files_skipped),
+        static_cast<int>(report.writes_done),
+        static_cast<int>(report.writes_skipped));
+  }
 }
 
 const char* SceneLab::BinaryEntityFileExtension() const {
@@ -487,64 +956,191 @@ const char* SceneLab::BinaryEntityFileExtension() const {
   }
 }
 
-void SceneLab::WriteEntityFile(const std::string& filename,
-                               const std::vector<uint8_t>& file_contents) {
-  if (fplbase::SaveFile((filename + "." + BinaryEntityFileExtension()).c_str(),
-                        file_contents.data(), file_contents.size())) {
-    fplbase::LogInfo("Save (binary) to file '%s' successful.",
-                     filename.c_str());
-  } else {
-    fplbase::LogError("Save (binary) to file '%s' failed.", filename.c_str());
+void SceneLab::GetJsonExportSchemas(const flatbuffers::Parser** text_schema,
+                                    const reflection::Schema** binary_schema) {
+  *text_schema = GetTextSchemaParser();
+  // With the binary schema too, JSON can be streamed straight to disk.
+  if (!entity_system_adapter()->GetSchema(binary_schema)) {
+    *binary_schema = nullptr;
   }
-  // Now save to JSON file.
-  // First load and parse the flatbuffer schema, then generate text.
+#if defined(__ANDROID__)
+  // EntityJsonWriter writes with stdio, which doesn't resolve paths the way
+  // fplbase::SaveFile() does on Android, so always build the text in memory.
+  *binary_schema = nullptr;
+#endif  // defined(__ANDROID__)
+}
+
+const flatbuffers::Parser* SceneLab::GetTextSchemaParser() {
   std::string schema_text;
-  if (entity_system_adapter()->GetTextSchema(&schema_text)) {
-    // Make a list of include paths that parser.Parse can parse.
-    // char** with nullptr termination.
-    std::unique_ptr<const char*> include_paths;
-    size_t num_paths = config_->schema_include_paths()->size();
-    include_paths.reset(new const char*[num_paths + 1]);
-    for (size_t i = 0; i < num_paths; i++) {
-      flatbuffers::uoffset_t index = static_cast<flatbuffers::uoffset_t>(i);
-      include_paths.get()[i] =
-          config_->schema_include_paths()->Get(index)->c_str();
-    }
-    include_paths.get()[num_paths] = nullptr;
-    flatbuffers::Parser parser;
-    if (parser.Parse(schema_text.c_str(), include_paths.get(),
-                     config_->schema_file_text()->c_str())) {
-      std::string json;
-      parser.opts.strict_json = true;
-      GenerateText(parser, file_contents.data(), &json);
-      std::string json_path =
-          (config_->json_output_directory()
-               ? flatbuffers::ConCatPathFileName(
-                     config_->json_output_directory()->str(), filename)
-               : filename) +
-          ".json";
-      if (fplbase::SaveFile(json_path.c_str(), json)) {
-        fplbase::LogInfo("Save (JSON) to file '%s' successful",
-                         json_path.c_str());
-      } else {
-        fplbase::LogError("Save (JSON) to file '%s' failed.",
-                          json_path.c_str());
-      }
+  if (!entity_system_adapter()->GetTextSchema(&schema_text)) {
+    fplbase::LogError("No text schema loaded, can't save JSON file.");
+    return nullptr;
+  }
+  if (text_schema_parser_ != nullptr &&
+      schema_text == text_schema_parser_source_) {
+    // Schema hasn't changed since we last parsed it.
+    return text_schema_parser_valid_ ? text_schema_parser_.get() : nullptr;
+  }
+  // Make a list of include paths that parser.Parse can parse.
+  // char** with nullptr termination.
+  std::vector<const char*> include_paths;
+  auto config_paths = config_->schema_include_paths();
+  if (config_paths != nullptr) {
+    for (flatbuffers::uoffset_t i = 0; i < config_paths->size(); i++) {
+      include_paths.push_back(config_paths->Get(i)->c_str());
+    }
+  }
+  include_paths.push_back(nullptr);
+
+  {
+    // JSON generated with the old schema may differ from the new schema's.
+    std::lock_guard<std::mutex> lock(file_hashes_mutex_);
+    json_source_hashes_.clear();
+  }
+  text_schema_parser_.reset(new flatbuffers::Parser());
+  text_schema_parser_source_.swap(schema_text);
+  text_schema_parser_valid_ = text_schema_parser_->Parse(
+      text_schema_parser_source_.c_str(), include_paths.data(),
+      config_->schema_file_text()->c_str());
+  if (!text_schema_parser_valid_) {
+    fplbase::LogError("Couldn't parse schema file: %s",
+                      text_schema_parser_->error_.c_str());
+    return nullptr;
+  }
+  text_schema_parser_->opts.strict_json = true;
+  return text_schema_parser_.get();
+}
+
+void SceneLab::WriteEntityFile(const std::string& filename,
+                               const std::vector<uint8_t>& file_contents,
+                               const flatbuffers::Parser* text_schema_parser,
+                               const reflection::Schema* binary_schema,
+                               EntityFileSaveResult* result) {
+  SCENE_LAB_PROFILE_ZONE("SceneLab::WriteEntityFile");
+  std::string binary_path = filename + "." + BinaryEntityFileExtension();
+  SaveClock::time_point start = SaveClock::now();
+  uint64_t binary_hash = HashBytes(file_contents.data(), file_contents.size());
+  if (FileContentsMatch(binary_path, binary_hash)) {
+    result->binary_unchanged = true;
+  } else {
+    result->binary_written = fplbase::SaveFile(
+        binary_path.c_str(), file_contents.data(), file_contents.size());
+    if (result->binary_written) {
+      SetFileHash(binary_path, binary_hash);
     } else {
-      fplbase::LogError("Couldn't parse schema file: %s",
-                        parser.error_.c_str());
+      result->error = "Couldn't write binary file '" + binary_path + "'.";
+      // We don't know what's in the file now.
+      std::lock_guard<std::mutex> lock(file_hashes_mutex_);
+      file_hashes_.erase(binary_path);
+    }
+  }
+  result->binary_write_seconds = SecondsSince(start);
+  // Now save to JSON file, using the already-parsed schema to generate text.
+  if (text_schema_parser == nullptr && binary_schema == nullptr) return;
+  WriteEntityJsonFile(filename, file_contents.data(), binary_hash,
+                      text_schema_parser, binary_schema, result);
+}
+
+void SceneLab::WriteEntityJsonFile(
+    const std::string& filename, const uint8_t* data, uint64_t binary_hash,
+    const flatbuffers::Parser* text_schema_parser,
+    const reflection::Schema* binary_schema, EntityFileSaveResult* result) {
+  std::string json_path =
+      (config_->json_output_directory()
+           ? flatbuffers::ConCatPathFileName(
+                 config_->json_output_directory()->str(), filename)
+           : filename) +
+      ".json";
+  bool json_source_known;
+  // This forgets what the JSON was generated from if the file has been
+  // changed by something else since.
+  uint64_t json_hash;
+  GetKnownFileHash(json_path, &json_hash);
+  {
+    // If the JSON file was last generated from this exact binary data, it
+    // can't have changed, so don't bother generating it again.
+    std::lock_guard<std::mutex> lock(file_hashes_mutex_);
+    auto source = json_source_hashes_.find(json_path);
+    if (source != json_source_hashes_.end() && source->second == binary_hash) {
+      result->json_unchanged = true;
+      return;
     }
+    json_source_known = source != json_source_hashes_.end();
+  }
+  // If we know what the existing file was generated from, and it wasn't this,
+  // it's going to change; otherwise check before overwriting it.
+  JsonUnchangedCheck is_unchanged;
+  if (!json_source_known) {
+    is_unchanged = [this, &json_path](uint64_t text_hash) {
+      return FileContentsMatch(json_path, text_hash);
+    };
+  }
+  EntityJsonExportResult json_result;
+  ExportEntityJson(json_path, data, text_schema_parser, binary_schema,
+                   is_unchanged, &json_result);
+  result->json_written = json_result.written;
+  result->json_unchanged = json_result.unchanged;
+  result->json_generate_seconds = json_result.generate_seconds;
+  result->json_write_seconds = json_result.write_seconds;
+  if (result->json_written) SetFileHash(json_path, json_result.text_hash);
+  std::lock_guard<std::mutex> lock(file_hashes_mutex_);
+  if (result->json_written || result->json_unchanged) {
+    json_source_hashes_[json_path] = binary_hash;
   } else {
-    fplbase::LogError("No text schema loaded, can't save JSON file.");
+    if (!result->error.empty()) result->error += " ";
+    result->error += "Couldn't write JSON file '" + json_path + "'.";
+    file_hashes_.erase(json_path);
+    json_source_hashes_.erase(json_path);
   }
 }
 
+bool SceneLab::FileContentsMatch(const std::string& path, uint64_t hash) {
+  uint64_t known_hash;
+  if (GetKnownFileHash(path, &known_hash)) return known_hash == hash;
+  // First time we've seen this file, or it's been changed by something else,
+  // so see what's on disk. Don't hold the lock while loading; other workers
+  // are loading other files.
+  std::string contents;
+  if (!fplbase::LoadFile(path.c_str(), &contents)) return false;
+  uint64_t disk_hash = HashBytes(contents.data(), contents.size());
+  SetFileHash(path, disk_hash);
+  return disk_hash == hash;
+}
+
+bool SceneLab::GetKnownFileHash(const std::string& path, uint64_t* hash_out) {
+  FileStamp stamp;
+  bool exists = GetFileStamp(path, &stamp);
+  std::lock_guard<std::mutex> lock(file_hashes_mutex_);
+  auto existing = file_hashes_.find(path);
+  if (existing == file_hashes_.end()) return false;
+  if (!exists || existing->second.stamp != stamp) {
+    file_hashes_.erase(existing);
+    json_source_hashes_.erase(path);
+    return false;
+  }
+  *hash_out = existing->second.hash;
+  return true;
+}
+
+void SceneLab::SetFileHash(const std::string& path, uint64_t hash) {
+  FileStamp stamp;
+  bool exists = GetFileStamp(path, &stamp);
+  std::lock_guard<std::mutex> lock(file_hashes_mutex_);
+  if (!exists) {
+    file_hashes_.erase(path);
+    return;
+  }
+  FileHash& file_hash = file_hashes_[path];
+  file_hash.hash = hash;
+  file_hash.stamp = stamp;
+}
+
 bool SceneLab::PreciseMovement() const {
   // When the shift key is held, use more precise movement.
   // TODO: would be better if we used precise movement by default, and
   //       transitioned to fast movement after the key has been held for
   //       a while.
-  return (!gui_->InputCaptured() &&
+  return (!GuiInputCaptured() &&
           (controller_->KeyIsDown(fplbase::FPLK_LSHIFT) ||
            controller_->KeyIsDown(fplbase::FPLK_RSHIFT)));
 }
@@ -598,7 +1194,7 @@ bool SceneLab::ProjectPointToPlane(const vec3& point_to_project,
 }
 
 vec3 SceneLab::GetMovement() const {
-  if (gui_->InputCaptured()) return mathfu::kZeros3f;
+  if (GuiInputCaptured()) return mathfu::kZeros3f;
   // Get a movement vector to move the user forward, up, or right.
   // Movement is always relative to the camera facing, but parallel to
   // ground.
@@ -626,7 +1222,7 @@ vec3 SceneLab::GetMovement() const {
   if (controller_->KeyIsDown(fplbase::FPLK_a)) {
     right_speed -= move_speed;
   }
-  if (gui_->lock_camera_height()) {
+  if (GuiLockCameraHeight()) {
     // Camera movement is locked to the horizontal plane, so we need to have
     // a way for the user to move up and down.
     if (controller_->KeyIsDown(fplbase::FPLK_r)) {
@@ -657,7 +1253,7 @@ bool SceneLab::ModifyTransformBasedOnInput(GenericTransform* transform) {
       vec3 mouse_ray_origin;
       vec3 mouse_ray_dir;
       if (controller_->ScreenPointToWorldRay(
-              camera, viewport, pointer, renderer_->window_size(),
+              camera, viewport, pointer, editor_input_->WindowSize(),
               &mouse_ray_origin, &mouse_ray_dir)) {
         vec3 intersect;
 
@@ -733,7 +1329,7 @@ bool SceneLab::ModifyTransformBasedOnInput(GenericTransform* transform) {
     }
   } else {
     // Not dragging, use keyboard keys instead.
-    if (gui_->InputCaptured()) return false;
+    if (GuiInputCaptured()) return false;
 
     // IJKL = move x/y axis
     float fwd_speed = 0, right_speed = 0, up_speed = 0;
@@ -831,10 +1427,10 @@ bool SceneLab::ModifyTransformBasedOnInput(GenericTransform* transform) {
 
 void SceneLab::RequestExit() {
   if (input_mode_ != kDragging) {
-    if (gui_->CanDeselectEntity()) {
+    if (GuiCanDeselectEntity()) {
       exit_requested_ = true;
       exit_ready_ = false;
-      if (gui_->CanExit()) {
+      if (GuiCanExit()) {
         exit_ready_ = true;
       } else {
         if (input_mode_ != kEditing) {
@@ -847,7 +1443,9 @@ void SceneLab::RequestExit() {
 
 void SceneLab::AbortExit() { exit_requested_ = false; }
 
-bool SceneLab::IsReadyToExit() { return exit_requested_ && exit_ready_; }
+bool SceneLab::IsReadyToExit() {
+  return exit_requested_ && exit_ready_ && pending_save_ == nullptr;
+}
 
 void SceneLab::AddOnEnterEditorCallback(EditorCallback callback) {
   on_enter_editor_callbacks_.push_back(callback);
@@ -869,4 +1467,16 @@ void SceneLab::AddOnDeleteEntityCallback(EntityCallback callback) {
   on_delete_entity_callbacks_.push_back(callback);
 }
 
+void SceneLab::AddOnCreateEntitiesCallback(EntityBatchCallback callback) {
+  on_create_entities_callbacks_.push_back(callback);
+}
+
+void SceneLab::AddOnUpdateEntitiesCallback(EntityBatchCallback callback) {
+  on_update_entities_callbacks_.push_back(callback);
+}
+
+void SceneLab::AddOnDeleteEntitiesCallback(EntityBatchCallback callback) {
+  on_delete_entities_callbacks_.push_back(callback);
+}
+
 }  // namespace editor
@@ -17,6 +17,7 @@
 #include "fplbase/utilities.h"
 
 #include <sys/stat.h>
+#include <string.h>
 #include <cassert>
 #include <fstream>
 #if defined(__ANDROID__)
@@ -125,6 +126,14 @@ std::unordered_map<std::string, time_t> ScanDirectory(
 
 static time_t LatestTime(time_t a, time_t b) { return (a > b) ? a : b; }
 
+bool GetFileStamp(const std::string& path, FileStamp* stamp_out) {
+  struct stat attrib;
+  if (stat(path.c_str(), &attrib) != 0) return false;
+  stamp_out->size = static_cast<uint64_t>(attrib.st_size);
+  stamp_out->modified_time = attrib.st_mtime;
+  return true;
+}
+
 time_t LoadAssetsIfNewer(time_t threshold,
                          const std::vector<AssetLoader>& asset_loaders) {
   time_t max_time = 0;
@@ -155,4 +164,125 @@ time_t LoadAssetsIfNewer(time_t threshold, const std::string& directory,
   return max_time;  // Only non-zero if we actually loaded anything.
 }
 
+// Constants and helpers for HashBytes (XXH64).
+static const uint64_t kHashPrime1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t kHashPrime2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t kHashPrime3 = 0x165667B19E3779F9ULL;
+static const uint64_t kHashPrime4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t kHashPrime5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t RotateLeft(uint64_t x, int bits) {
+  return (x << bits) | (x >> (64 - bits));
+}
+
+// Read little-endian values regardless of the platform's byte order.
+static inline uint64_t ReadLE64(const uint8_t* p) {
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; i--) value = (value << 8) | p[i];
+  return value;
+}
+
+static inline uint32_t ReadLE32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static inline uint64_t HashRound(uint64_t acc, uint64_t input) {
+  acc += input * kHashPrime2;
+  acc = RotateLeft(acc, 31);
+  return acc * kHashPrime1;
+}
+
+static inline uint64_t HashMergeRound(uint64_t acc, uint64_t value) {
+  acc ^= HashRound(0, value);
+  return acc * kHashPrime1 + kHashPrime4;
+}
+
+IncrementalHash::IncrementalHash(uint64_t seed)
+    : seed_(seed),
+      v1_(seed + kHashPrime1 + kHashPrime2),
+      v2_(seed + kHashPrime2),
+      v3_(seed),
+      v4_(seed - kHashPrime1),
+      total_length_(0),
+      buffered_(0) {}
+
+void IncrementalHash::Update(const void* data, size_t length) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  const uint8_t* end = p + length;
+  total_length_ += length;
+  if (buffered_ + length < kStripeSize) {
+    memcpy(buffer_ + buffered_, p, length);
+    buffered_ += length;
+    return;
+  }
+  if (buffered_ > 0) {
+    // Finish off the partial stripe left over from last time.
+    size_t fill = kStripeSize - buffered_;
+    memcpy(buffer_ + buffered_, p, fill);
+    ProcessStripe(buffer_);
+    p += fill;
+    buffered_ = 0;
+  }
+  while (p + kStripeSize <= end) {
+    ProcessStripe(p);
+    p += kStripeSize;
+  }
+  buffered_ = static_cast<size_t>(end - p);
+  memcpy(buffer_, p, buffered_);
+}
+
+void IncrementalHash::ProcessStripe(const uint8_t* p) {
+  v1_ = HashRound(v1_, ReadLE64(p));
+  v2_ = HashRound(v2_, ReadLE64(p + 8));
+  v3_ = HashRound(v3_, ReadLE64(p + 16));
+  v4_ = HashRound(v4_, ReadLE64(p + 24));
+}
+
+uint64_t IncrementalHash::Finish() const {
+  uint64_t hash;
+  if (total_length_ >= kStripeSize) {
+    hash = RotateLeft(v1_, 1) + RotateLeft(v2_, 7) + RotateLeft(v3_, 12) +
+           RotateLeft(v4_, 18);
+    hash = HashMergeRound(hash, v1_);
+    hash = HashMergeRound(hash, v2_);
+    hash = HashMergeRound(hash, v3_);
+    hash = HashMergeRound(hash, v4_);
+  } else {
+    hash = seed_ + kHashPrime5;
+  }
+  hash += total_length_;
+  const uint8_t* p = buffer_;
+  const uint8_t* end = buffer_ + buffered_;
+  while (p + 8 <= end) {
+    hash ^= HashRound(0, ReadLE64(p));
+    hash = RotateLeft(hash, 27) * kHashPrime1 + kHashPrime4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    hash ^= static_cast<uint64_t>(ReadLE32(p)) * kHashPrime1;
+    hash = RotateLeft(hash, 23) * kHashPrime2 + kHashPrime3;
+    p += 4;
+  }
+  while (p < end) {
+    hash ^= static_cast<uint64_t>(*p) * kHashPrime5;
+    hash = RotateLeft(hash, 11) * kHashPrime1;
+    p++;
+  }
+  // Final avalanche.
+  hash ^= hash >> 33;
+  hash *= kHashPrime2;
+  hash ^= hash >> 29;
+  hash *= kHashPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+uint64_t HashBytes(const void* data, size_t length, uint64_t seed) {
+  IncrementalHash hash(seed);
+  hash.Update(data, length);
+  return hash.Finish();
+}
+
 }  // namespace scene_lab
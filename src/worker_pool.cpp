@@ -0,0 +1,81 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "scene_lab/worker_pool.h"
+
+namespace scene_lab {
+
+WorkerPool::WorkerPool(int num_threads)
+    : tasks_running_(0), shutting_down_(false) {
+  if (num_threads < 1) num_threads = 1;
+  for (int i = 0; i < num_threads; i++) {
+    threads_.push_back(std::thread([this]() { RunWorker(); }));
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  task_added_.notify_all();
+  for (auto thread = threads_.begin(); thread != threads_.end(); ++thread) {
+    thread->join();
+  }
+}
+
+void WorkerPool::AddTask(const Task& task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(task);
+  }
+  task_added_.notify_one();
+}
+
+void WorkerPool::WaitForAllTasks() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  all_tasks_finished_.wait(
+      lock, [this]() { return tasks_.empty() && tasks_running_ == 0; });
+}
+
+bool WorkerPool::IsIdle() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tasks_.empty() && tasks_running_ == 0;
+}
+
+void WorkerPool::RunWorker() {
+  for (;;) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_added_.wait(lock,
+                       [this]() { return shutting_down_ || !tasks_.empty(); });
+      // Even when shutting down, drain the queue so nothing is left half-done.
+      if (tasks_.empty()) return;
+      task = tasks_.front();
+      tasks_.pop_front();
+      tasks_running_++;
+    }
+    task();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_running_--;
+      if (tasks_.empty() && tasks_running_ == 0) {
+        all_tasks_finished_.notify_all();
+      }
+    }
+  }
+}
+
+}  // namespace scene_lab
@@ -0,0 +1,201 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Generates made up scenes of any size, for stress testing Scene Lab and your
+// game with more entities than you'd want to place by hand. The entity files
+// are written just as SceneLab::SaveScene() writes them, using MemoryAdapter,
+// along with an entity library of prototypes for them to use.
+//
+// Usage:
+//   scene_lab_generate_scene [--entities N] [--files N]
+//                            [--components_per_entity N] [--component NAME]...
+//                            [--child_fraction F] [--max_depth N]
+//                            [--max_children N] [--prototypes N]
+//                            [--prototype_fraction F] [--template FILE]...
+//                            [--extent F] [--seed N] [--ext EXT]
+//                            [--library FILE] [--output_dir DIR]
+//                            BINARY_SCHEMA
+//
+// BINARY_SCHEMA is the .bfbs of your entity files, laid out like the
+// sample's components.fbs. The entities are spread across --files files
+// named generated_0.EXT, generated_1.EXT, etc. in --output_dir. Each has
+// --components_per_entity components besides its meta data and transform,
+// taken in turn from the --component tables given, or from every component
+// in the schema. Roughly --child_fraction of them are children of another
+// entity in the same file, at most --max_depth levels deep and with at most
+// --max_children children each (0 for no limit).
+//
+// Give one or more --template entity files, e.g. from your game, to copy each
+// component's data from entities that have it. Without templates, every
+// component has all its fields at their defaults (a mesh with no mesh, a
+// physics body with no shapes), which makes the scene far cheaper to save,
+// load and render than a real one. With templates, and no --component given,
+// only the components found in the templates are used.
+//
+// If --prototypes is nonzero, that many prototypes are written to --library
+// (default entity_prototypes.bin in --output_dir), and roughly
+// --prototype_fraction of the entities are made from one of them.
+//
+// To get JSON versions of the files, run scene_lab_json_export on them.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "flatbuffers/util.h"
+#include "scene_lab/memory/memory_adapter.h"
+
+using scene_lab::GenericEntityId;
+using scene_lab_memory::MemoryAdapter;
+
+static const char kDefaultBinaryEntityFileExtension[] = "bin";
+static const char kDefaultEntityLibraryFile[] = "entity_prototypes.bin";
+
+static void PrintUsage(const char* program) {
+  fprintf(stderr,
+          "Usage: %s [--entities N] [--files N] [--components_per_entity N] "
+          "[--component NAME]... [--child_fraction F] [--max_depth N] "
+          "[--max_children N] [--prototypes N] [--prototype_fraction F] "
+          "[--template FILE]... [--extent F] [--seed N] [--ext EXT] "
+          "[--library FILE] [--output_dir DIR] BINARY_SCHEMA\n",
+          program);
+}
+
+static bool WriteFile(const std::string& path,
+                      const std::vector<uint8_t>& data) {
+  std::string contents(reinterpret_cast<const char*>(data.data()),
+                       data.size());
+  if (!flatbuffers::SaveFile(path.c_str(), contents, true)) {
+    fprintf(stderr, "Couldn't write '%s'.\n", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  MemoryAdapter::SceneOptions options;
+  options.entity_count = 10000;
+  size_t prototype_count = 0;
+  std::string extension = kDefaultBinaryEntityFileExtension;
+  std::string library_file;
+  std::string output_dir;
+  std::vector<std::string> template_files;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--entities") == 0 && i + 1 < argc) {
+      options.entity_count = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+      options.file_count = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--components_per_entity") == 0 &&
+               i + 1 < argc) {
+      options.components_per_entity = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--component") == 0 && i + 1 < argc) {
+      options.components.push_back(argv[++i]);
+    } else if (strcmp(argv[i], "--child_fraction") == 0 && i + 1 < argc) {
+      options.child_fraction = static_cast<float>(atof(argv[++i]));
+    } else if (strcmp(argv[i], "--max_depth") == 0 && i + 1 < argc) {
+      options.max_depth = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--max_children") == 0 && i + 1 < argc) {
+      options.max_children = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--prototypes") == 0 && i + 1 < argc) {
+      prototype_count = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--prototype_fraction") == 0 && i + 1 < argc) {
+      options.prototype_fraction = static_cast<float>(atof(argv[++i]));
+    } else if (strcmp(argv[i], "--template") == 0 && i + 1 < argc) {
+      template_files.push_back(argv[++i]);
+    } else if (strcmp(argv[i], "--extent") == 0 && i + 1 < argc) {
+      options.extent = static_cast<float>(atof(argv[++i]));
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      options.seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--ext") == 0 && i + 1 < argc) {
+      extension = argv[++i];
+    } else if (strcmp(argv[i], "--library") == 0 && i + 1 < argc) {
+      library_file = argv[++i];
+    } else if (strcmp(argv[i], "--output_dir") == 0 && i + 1 < argc) {
+      output_dir = argv[++i];
+    } else if (argv[i][0] == '-') {
+      PrintUsage(argv[0]);
+      return 1;
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  if (args.size() != 1) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  if (library_file.empty()) {
+    library_file =
+        flatbuffers::ConCatPathFileName(output_dir, kDefaultEntityLibraryFile);
+  }
+
+  MemoryAdapter adapter;
+  if (!adapter.LoadSchema(args[0], "")) {
+    fprintf(stderr, "Couldn't use '%s' as the entity schema.\n",
+            args[0].c_str());
+    return 1;
+  }
+  for (auto file = template_files.begin(); file != template_files.end();
+       ++file) {
+    if (adapter.LoadComponentTemplatesFromFile(*file) == 0) {
+      fprintf(stderr, "Couldn't read any components from '%s'.\n",
+              file->c_str());
+      return 1;
+    }
+  }
+
+  // Make the prototypes first, so that entities can use them.
+  if (prototype_count > 0) {
+    std::vector<uint8_t> library;
+    if (!adapter.CreatePrototypes(prototype_count, options, nullptr) ||
+        !adapter.SerializePrototypes(&library) ||
+        !WriteFile(library_file, library)) {
+      return 1;
+    }
+    printf("Wrote %d prototypes to %s\n", static_cast<int>(prototype_count),
+           library_file.c_str());
+  }
+
+  std::vector<GenericEntityId> ids;
+  if (!adapter.CreateScene(options, &ids)) return 1;
+
+  // Divide up the entities by file, keeping them in the order they were
+  // made so parents come before their children.
+  std::vector<std::string> filenames;
+  std::unordered_map<std::string, std::vector<GenericEntityId>> ids_by_file;
+  for (auto id = ids.begin(); id != ids.end(); ++id) {
+    std::string filename;
+    adapter.GetEntitySourceFile(*id, &filename);
+    std::vector<GenericEntityId>& file_ids = ids_by_file[filename];
+    if (file_ids.empty()) filenames.push_back(filename);
+    file_ids.push_back(*id);
+  }
+
+  std::vector<uint8_t> entity_list;
+  for (auto filename = filenames.begin(); filename != filenames.end();
+       ++filename) {
+    std::string path = flatbuffers::ConCatPathFileName(
+        output_dir, *filename + "." + extension);
+    if (!adapter.SerializeEntities(ids_by_file[*filename], &entity_list) ||
+        !WriteFile(path, entity_list)) {
+      return 1;
+    }
+  }
+  printf("Wrote %d entities to %d files in %s\n", static_cast<int>(ids.size()),
+         static_cast<int>(filenames.size()),
+         output_dir.empty() ? "." : output_dir.c_str());
+  return 0;
+}
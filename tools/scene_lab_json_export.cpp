@@ -0,0 +1,194 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Converts binary entity files saved by Scene Lab into JSON, the same way
+// SceneLab::SaveScene() does when export_json_on_save is set. Run it from the
+// directory your game loads assets from, so that relative paths in the Scene
+// Lab config resolve the same way they do in the game.
+//
+// Usage:
+//   scene_lab_json_export [--threads N] [--output_dir DIR]
+//                         CONFIG_FILE INPUT_DIR...
+//
+// CONFIG_FILE is your binary SceneLabConfig. Every entity file in each
+// INPUT_DIR (with the config's binary_entity_file_ext) is converted, and the
+// JSON is written into --output_dir, or the config's json_output_directory,
+// or next to the binary file.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "flatbuffers/idl.h"
+#include "flatbuffers/reflection.h"
+#include "flatbuffers/util.h"
+#include "scene_lab/entity_json_writer.h"
+#include "scene_lab/util.h"
+#include "scene_lab/worker_pool.h"
+#include "scene_lab_config_generated.h"
+
+static const char kDefaultBinaryEntityFileExtension[] = "bin";
+
+static void PrintUsage(const char* program) {
+  fprintf(stderr,
+          "Usage: %s [--threads N] [--output_dir DIR] CONFIG_FILE "
+          "INPUT_DIR...\n",
+          program);
+}
+
+int main(int argc, char** argv) {
+  int num_threads = 4;
+  std::string output_dir;
+  bool output_dir_set = false;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      num_threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--output_dir") == 0 && i + 1 < argc) {
+      output_dir = argv[++i];
+      output_dir_set = true;
+    } else if (argv[i][0] == '-') {
+      PrintUsage(argv[0]);
+      return 1;
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  if (args.size() < 2) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::string config_source;
+  if (!flatbuffers::LoadFile(args[0].c_str(), true, &config_source)) {
+    fprintf(stderr, "Couldn't load config file '%s'.\n", args[0].c_str());
+    return 1;
+  }
+  const scene_lab::SceneLabConfig* config =
+      scene_lab::GetSceneLabConfig(config_source.c_str());
+  const char* binary_ext = config->binary_entity_file_ext() != nullptr
+                               ? config->binary_entity_file_ext()->c_str()
+                               : kDefaultBinaryEntityFileExtension;
+  if (!output_dir_set && config->json_output_directory() != nullptr) {
+    output_dir = config->json_output_directory()->str();
+  }
+
+  // Load whichever schemas the config gives us. Streaming with the binary
+  // schema is faster; the text schema is the fallback for unusual data.
+  std::unique_ptr<flatbuffers::Parser> text_schema;
+  if (config->schema_file_text() != nullptr) {
+    std::string schema_source;
+    if (!flatbuffers::LoadFile(config->schema_file_text()->c_str(), false,
+                               &schema_source)) {
+      fprintf(stderr, "Couldn't load text schema '%s'.\n",
+              config->schema_file_text()->c_str());
+      return 1;
+    }
+    std::vector<const char*> include_paths;
+    auto config_paths = config->schema_include_paths();
+    if (config_paths != nullptr) {
+      for (flatbuffers::uoffset_t i = 0; i < config_paths->size(); i++) {
+        include_paths.push_back(config_paths->Get(i)->c_str());
+      }
+    }
+    include_paths.push_back(nullptr);
+    text_schema.reset(new flatbuffers::Parser());
+    if (!text_schema->Parse(schema_source.c_str(), include_paths.data(),
+                            config->schema_file_text()->c_str())) {
+      fprintf(stderr, "Couldn't parse schema file: %s\n",
+              text_schema->error_.c_str());
+      return 1;
+    }
+    text_schema->opts.strict_json = true;
+  }
+  std::string binary_schema_source;
+  const reflection::Schema* binary_schema = nullptr;
+  if (config->schema_file_binary() != nullptr &&
+      flatbuffers::LoadFile(config->schema_file_binary()->c_str(), true,
+                            &binary_schema_source)) {
+    binary_schema = reflection::GetSchema(binary_schema_source.c_str());
+  }
+  if (text_schema == nullptr && binary_schema == nullptr) {
+    fprintf(stderr, "No schema could be loaded from the config.\n");
+    return 1;
+  }
+
+  // Collect the entity files, minus their extensions.
+  std::vector<std::string> entity_files;
+  std::string ext_suffix = std::string(".") + binary_ext;
+  for (size_t i = 1; i < args.size(); i++) {
+    auto files = scene_lab::ScanDirectory(args[i], ext_suffix);
+    for (auto f = files.begin(); f != files.end(); ++f) {
+      entity_files.push_back(
+          f->first.substr(0, f->first.length() - ext_suffix.length()));
+    }
+  }
+
+  std::atomic<int> written(0), unchanged(0), failed(0);
+  const flatbuffers::Parser* parser = text_schema.get();
+  auto export_file = [&](const std::string& filename) {
+    std::string binary_path = filename + ext_suffix;
+    std::string json_path =
+        (output_dir.length() != 0
+             ? flatbuffers::ConCatPathFileName(output_dir, filename)
+             : filename) +
+        ".json";
+    std::string contents;
+    if (!flatbuffers::LoadFile(binary_path.c_str(), true, &contents)) {
+      fprintf(stderr, "Couldn't load binary file '%s'.\n",
+              binary_path.c_str());
+      failed++;
+      return;
+    }
+    // Leave files that are already up to date alone, so their timestamps
+    // don't change.
+    scene_lab::JsonUnchangedCheck is_unchanged = [&json_path](
+        uint64_t text_hash) {
+      std::string existing;
+      return flatbuffers::LoadFile(json_path.c_str(), false, &existing) &&
+             scene_lab::HashBytes(existing.data(), existing.size()) ==
+                 text_hash;
+    };
+    scene_lab::EntityJsonExportResult result;
+    if (!scene_lab::ExportEntityJson(
+            json_path, reinterpret_cast<const uint8_t*>(contents.data()),
+            parser, binary_schema, is_unchanged, &result)) {
+      fprintf(stderr, "Couldn't write JSON file '%s'.\n", json_path.c_str());
+      failed++;
+    } else if (result.unchanged) {
+      unchanged++;
+    } else {
+      written++;
+    }
+  };
+  if (num_threads > 0) {
+    scene_lab::WorkerPool workers(num_threads);
+    for (auto f = entity_files.begin(); f != entity_files.end(); ++f) {
+      const std::string* filename = &*f;
+      workers.AddTask([&export_file, filename]() { export_file(*filename); });
+    }
+    workers.WaitForAllTasks();
+  } else {
+    for (auto f = entity_files.begin(); f != entity_files.end(); ++f) {
+      export_file(*f);
+    }
+  }
+
+  printf("%d JSON files written, %d unchanged, %d failed.\n", written.load(),
+         unchanged.load(), failed.load());
+  return failed == 0 ? 0 : 1;
+}